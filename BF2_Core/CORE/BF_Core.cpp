@@ -1,8 +1,17 @@
 #include "BF_Core.h"
 #include "../Utils/BF_Error.h"
+#include "../Utils/BF_Consts.h"
+#include "../Utils/BF_Profiler.h"
+#include "../Utils/BF_Memory.h"
+#include "../Utils/BF_MemTrack.h"
 
-Core::Core() : m_exit(false)
+#include <algorithm>
+#include <cmath>
+
+Core::Core() : m_seconds(0.0), m_milliseconds(0), m_accumulator(0.0), m_exit(false)
 {
+	m_frameStats.setBudget(kFrameBudgetMs);
+	m_frameStats.setReportInterval(kFrameReportInterval);
 }
 
 Core::~Core()
@@ -11,53 +20,157 @@ Core::~Core()
 
 void Core::init()
 {
+	//Profiler first so everything after can be timed
+	prof::Init();
+
+	mem::SetMemoryBudget(mem::Tag::Graphics, kGraphicsMemoryBudget);
+	mem::SetMemoryBudget(mem::Tag::Scene, kSceneMemoryBudget);
+	mem::SetMemoryBudget(mem::Tag::Assets, kAssetsMemoryBudget);
+
+	//File loads go through the IO service so they never block the frame
+	m_ioService.init(kIOWorkerThreads);
+
 	//Setup Graphics module
-	m_pGraphics = std::make_unique<Graphics>();
-	
-	if (!m_pGraphics)
 	{
-		panicF("Failed to create the Graphics module");
-	}
+		mem::TagScope tag(mem::Tag::Graphics);
 
-	m_pGraphics->init();
+		m_pGraphics = std::make_unique<Graphics>();
 
-	//Setup Scene Module
-	m_pScene = std::make_unique<Scene>();
+		if (!m_pGraphics)
+		{
+			panicF("Failed to create the Graphics module");
+		}
+
+		m_pGraphics->init(m_ioService);
+	}
 
-	if (!m_pScene)
+	//Setup Scene Module
 	{
-		panicF("Failed to create the Scene module");
+		mem::TagScope tag(mem::Tag::Scene);
+
+		m_pScene = std::make_unique<Scene>();
+
+		if (!m_pScene)
+		{
+			panicF("Failed to create the Scene module");
+		}
+
+		m_pScene->init();
 	}
 
-	m_pScene->init();
+	//Pace frames against the same timer the frame is measured with
+	m_frameLimiter.init([this]() { return m_pGraphics->queryTimer(); }, kTargetFrameTime);
 }
 
 void Core::shutdown()
 {
+	m_frameLimiter.shutdown();
+
 	//Shutdown Graphics module
 	m_pGraphics->shutdown();
 
 	//Shutdown Scene Module
 	m_pScene->shutdown();
+
+	m_ioService.shutdown();
+
+	//Anything a subsystem still holds once it's gone is a leak
+	m_pGraphics.reset();
+	m_pScene.reset();
+
+	mem::ReportMemory();
+	mem::ReportLeaks();
+
+	//Dump the capture
+	if (kProfilerCaptureOnExit)
+	{
+		prof::ExportChromeTrace(kProfilerTraceFile);
+	}
+	prof::Shutdown();
 }
 
 void Core::run()
 {
+	double lastFrameStart = m_pGraphics->queryTimer();
+
 	//Main Loop
 	while (!m_exit) {
 
+		BF_PROFILE_ZONE("Core::frame");
+
+		//Recycle per-frame temporaries from the frame before last
+		mem::GetFrameAllocator().beginFrame();
+		mem::BeginMemoryFrame();
+
 		const double t0s = m_pGraphics->queryTimer();
 
-		m_pScene->update();
+		//Bank the real time since last frame - clamped so a long stall
+		//(breakpoint, window drag) doesn't queue up a burst of steps
+		m_accumulator += std::min(t0s - lastFrameStart, kMaxFrameDelta);
+		lastFrameStart = t0s;
+
+		//Hand finished file reads to their owners
+		{
+			BF_PROFILE_ZONE("IOService::pump");
+			m_ioService.pump();
+		}
+
+		{
+			BF_PROFILE_ZONE("Scene::update");
+			mem::TagScope tag(mem::Tag::Scene);
 
-		m_pGraphics->frame();
+			//Simulate at a fixed rate, independent of the render rate
+			uint32_t steps = 0;
+			while (m_accumulator >= kFixedTimestep && steps < kMaxSimStepsPerFrame) {
+				m_pScene->update();
+				m_accumulator -= kFixedTimestep;
+				steps++;
+			}
+
+			//Still behind after the cap - drop the backlog rather than spiral
+			if (m_accumulator >= kFixedTimestep) {
+				m_accumulator = std::fmod(m_accumulator, kFixedTimestep);
+			}
+
+			//Render between the last two steps
+			m_pScene->interpolate(static_cast<float>(m_accumulator / kFixedTimestep));
+		}
+
+		{
+			BF_PROFILE_ZONE("Graphics::frame");
+			mem::TagScope tag(mem::Tag::Graphics);
+			m_pGraphics->frame();
+		}
 
 		//update timers
 		const double t1s = m_pGraphics->queryTimer();
 		m_seconds = t1s - t0s;
-		m_milliseconds = static_cast<uint64_t>(m_seconds * 1000.0);
+		m_milliseconds = static_cast<int64_t>(m_seconds * 1000.0);
+
+		m_frameStats.addFrame(m_seconds);
 
 		//check exit conditions...
 		m_exit |= m_pGraphics->getExitFlag();
+
+		//Sleep off the rest of the frame instead of spinning the loop
+		{
+			BF_PROFILE_ZONE("Core::limiter");
+			m_frameLimiter.wait();
+		}
 	}
 }
+
+FrameStats& Core::getFrameStats()
+{
+	return m_frameStats;
+}
+
+void Core::setFrameRateLimit(double fps)
+{
+	m_frameLimiter.setTargetFrameTime(fps > 0.0 ? 1.0 / fps : 0.0);
+}
+
+IOService& Core::getIOService()
+{
+	return m_ioService;
+}
@@ -3,6 +3,9 @@
 #include <memory>
 #include "BF_Graphics.h"
 #include "BF_Scene.h"
+#include "../Utils/BF_FrameStats.h"
+#include "../Utils/BF_FrameLimiter.h"
+#include "../Utils/BF_AsyncIO.h"
 
 class Core {
 public:
@@ -17,16 +20,31 @@ public:
 
 	void run();
 
+	//Frame budget, hitch and report configuration
+	FrameStats& getFrameStats();
+
+	//Cap the frame rate, 0 for unlimited
+	void setFrameRateLimit(double fps);
+
+	IOService& getIOService();
+
 private:
 
 	//Engine Components
 	std::unique_ptr<Graphics>	m_pGraphics;
 	std::unique_ptr<Scene>		m_pScene;
+	IOService					m_ioService;
 
 	//Timer
 	double m_seconds;
 	int64_t m_milliseconds;
 
+	//Unsimulated time carried between frames
+	double m_accumulator;
+
+	FrameStats m_frameStats;
+	FrameLimiter m_frameLimiter;
+
 	//Exit flag
 	bool m_exit;
 };
\ No newline at end of file
@@ -2,7 +2,6 @@
 #include "../Utils/BF_Consts.h"
 #include "../Utils/BF_Error.h"
 #include "../Utils/BF_Memory.h"
-#include "../Utils/BF_Vertex_Pos3Col3Uv2.h"
 
 #pragma comment(lib, "vulkan-1")
 
@@ -13,7 +12,7 @@
 #include <array>
 #include <algorithm>
 
-Graphics::Graphics() : m_exit(false), m_instance(nullptr),
+Graphics::Graphics() : m_exit(false), m_instance(nullptr), m_defaultSampler(VK_NULL_HANDLE), m_io(nullptr),
 #ifdef _DEBUG
 	m_enableValidationLayers(true)
 #else
@@ -22,8 +21,10 @@ Graphics::Graphics() : m_exit(false), m_instance(nullptr),
 {
 }
 
-void Graphics::init()
+void Graphics::init(IOService& io)
 {
+	m_io = &io;
+
 	//init the window
 	m_pWindow = std::make_unique<Window>();
 	if (!m_pWindow)
@@ -45,6 +46,14 @@ void Graphics::shutdown()
 
 void Graphics::frame()
 {
+	//read back GPU timings from earlier frames
+	m_gpuProfiler.collect();
+
+	//swap in any shaders edited since last frame
+	m_shaders.update();
+
+	//retire finished uploads, evict and stream in by this frame's demand
+	m_textures.update();
 
 	//check for exit conditions
 	m_exit |= m_pWindow->shouldClose();
@@ -55,6 +64,26 @@ const double Graphics::queryTimer() const
 	return m_pWindow->queryTime();
 }
 
+GpuProfiler& Graphics::getGpuProfiler()
+{
+	return m_gpuProfiler;
+}
+
+TextureStreamer& Graphics::getTextureStreamer()
+{
+	return m_textures;
+}
+
+SamplerCache& Graphics::getSamplerCache()
+{
+	return m_samplers;
+}
+
+const VkHostAllocator& Graphics::getHostAllocator() const
+{
+	return m_hostAllocator;
+}
+
 const bool Graphics::getExitFlag() const
 {
 	return m_exit;
@@ -104,33 +133,71 @@ int Graphics::vulkanSetup()
 	//	m_deviceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 	//}
 
+	//driver host allocations go through engine pools, must outlive the instance
+	m_hostAllocator.init();
+
 	//start creating the objects
 	CHECK_RET(createVkInstance());
 	CHECK_RET(createVkDebugMsgr());
 	CHECK_RET(createVkSurface());
 	CHECK_RET(pickVkPhysicalDevice());
 	CHECK_RET(createVkLogicalDevice());
+	CHECK_RET(m_gpuProfiler.init(m_physDevice, m_device, findQueueFamilies(m_physDevice).graphicsFamily.value(), m_hostAllocator.getCallbacks()));
+	CHECK_RET(m_textures.init(m_physDevice, m_device, m_hostAllocator.getCallbacks(), findQueueFamilies(m_physDevice).graphicsFamily.value(), m_graphicsQueue, *m_io));
+	CHECK_RET(m_shaders.init(m_device, m_hostAllocator.getCallbacks(), kShaderDirectory, kShaderPak, kShaderHotReload));
+	m_layouts.init(m_device, m_hostAllocator.getCallbacks());
+	m_samplers.init(m_physDevice, m_device, m_hostAllocator.getCallbacks());
 	CHECK_RET(createSwapchain());
 	CHECK_RET(createDefaultRenderPass());
+	CHECK_RET(createDepthResources());
+	CHECK_RET(createFramebuffers());
 	CHECK_RET(createDefaultDescriptorSetLayout());
-	CHECK_RET(createDefaultPipeline());
+	if (getDefaultPipeline(kShaderDefaultFeatures) == VK_NULL_HANDLE) return 0;
+
+	//edited shaders rebuild every default permutation in place
+	m_shaders.addDependency({ "vert.spv", "frag.spv",
+		shader::PermutationName("vert.spv", vertex::GetShaderDefines(VertexFormat::Pos4sNrm2sUv2h)),
+		shader::PermutationName("frag.spv", shader::FeatureDefines(kShaderAlphaTest)) },
+		[this]() { rebuildDefaultPipeline(); });
+
+	//not vital - without it occlusion culling is skipped
+	if (m_depthPyramid.init(m_physDevice, m_device, m_hostAllocator.getCallbacks(), m_shaders, m_layouts, m_samplers)) {
+		m_depthPyramid.resize(m_depthImage.view, m_depthImage.extent);
+	}
 
 	return 1;
 }
 
 int Graphics::vulkanShutdown()
 {
+	m_depthPyramid.shutdown();
+	m_textures.shutdown();
+
 	CHECK_RET(cleanupSwapchain());
 
-	vkDestroyDescriptorSetLayout(m_device, m_defaultLayout, nullptr);
+	//every descriptor set and pipeline layout, then the samplers baked into them
+	m_layouts.shutdown();
+	m_samplers.shutdown();
+
+#if _DEBUG
+	m_gpuProfiler.report();
+#endif
+	m_gpuProfiler.shutdown();
+
+	m_shaders.shutdown();
+
+	vkDestroyDevice(m_device, m_hostAllocator.getCallbacks());
 
-	vkDestroyDevice(m_device, nullptr);
+	vkDestroySurfaceKHR(m_instance, m_surface, m_hostAllocator.getCallbacks());
 
-	vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+	destroyDebugUtilsMessengerEXT(m_hostAllocator.getCallbacks());
 
-	destroyDebugUtilsMessengerEXT(nullptr);
+	vkDestroyInstance(m_instance, m_hostAllocator.getCallbacks());
 
-	vkDestroyInstance(m_instance, nullptr);
+#if _DEBUG
+	m_hostAllocator.report();
+#endif
+	m_hostAllocator.shutdown();
 
 	return 1;
 }
@@ -174,7 +241,7 @@ int Graphics::createVkInstance()
 
 	//Create instance and check for errors
 	VkResult res;
-	res = vkCreateInstance(&createInfo, nullptr, &m_instance);
+	res = vkCreateInstance(&createInfo, m_hostAllocator.getCallbacks(), &m_instance);
 
 	if (res != VK_SUCCESS) {
 		panicF("failed to create vulkan instance! - VkResult %i", res);
@@ -206,7 +273,7 @@ int Graphics::createVkDebugMsgr()
 	createInfo.pfnUserCallback = debugCallback;
 	createInfo.pUserData = nullptr; // Optional
 
-	VkResult res = createDebugUtilsMessengerEXT(&createInfo, nullptr);
+	VkResult res = createDebugUtilsMessengerEXT(&createInfo, m_hostAllocator.getCallbacks());
 	if (res != VK_SUCCESS) {
 		errorF("failed to set up debug messenger! - VkResult %i", res);
 		//not vital error just yet
@@ -218,7 +285,7 @@ int Graphics::createVkDebugMsgr()
 int Graphics::createVkSurface()
 {
 	//glfw handles multiplat surface creation
-	VkResult res = glfwCreateWindowSurface(m_instance, m_pWindow->getGLFWwindow(), nullptr, &m_surface);
+	VkResult res = glfwCreateWindowSurface(m_instance, m_pWindow->getGLFWwindow(), m_hostAllocator.getCallbacks(), &m_surface);
 	if (res != VK_SUCCESS) {
 		panicF("failed to create window surface! - VkResult %i");
 		return 0;
@@ -285,6 +352,14 @@ int Graphics::createVkLogicalDevice()
 	//request anistropy
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+	//optional - lets MeshletCuller draw every meshlet with one indirect call
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(m_physDevice, &supportedFeatures);
+	deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+
+	//optional - TextureStreamer uploads BCn textures as they are, failing them without it
+	deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
 	//Create the logical device
 	VkDeviceCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -307,7 +382,7 @@ int Graphics::createVkLogicalDevice()
 	}
 
 	//Create!
-	if (vkCreateDevice(m_physDevice, &createInfo, nullptr, &m_device) != VK_SUCCESS) {
+	if (vkCreateDevice(m_physDevice, &createInfo, m_hostAllocator.getCallbacks(), &m_device) != VK_SUCCESS) {
 		panicF("failed to create logical device!");
 		return 0;
 	}
@@ -377,7 +452,7 @@ int Graphics::createSwapchain()
 	//here's where you have to reference the dead one
 	createInfo.oldSwapchain = VK_NULL_HANDLE;
 
-	if (vkCreateSwapchainKHR(m_device, &createInfo, nullptr, &m_swapchain.m_swapChain) != VK_SUCCESS) {
+	if (vkCreateSwapchainKHR(m_device, &createInfo, m_hostAllocator.getCallbacks(), &m_swapchain.m_swapChain) != VK_SUCCESS) {
 		panicF("failed to create swap chain!");
 		return 0;
 	}
@@ -431,26 +506,28 @@ int Graphics::createDefaultRenderPass()
 	VkSubpassDependency dependency = {};
 	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
 	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
 	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
-	//Depth
-	VkAttachmentDescription depthAttachment = {};
-	depthAttachment.format = findSupportedFormat(
+	//Depth - stored and left readable, the depth pyramid is built from it
+	m_depthFormat = findSupportedFormat(
 		m_physDevice,
 		{ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
 		VK_IMAGE_TILING_OPTIMAL,
-		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
 	);
+
+	VkAttachmentDescription depthAttachment = {};
+	depthAttachment.format = m_depthFormat;
 	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 
 	VkAttachmentReference depthAttachmentRef = {};
 	depthAttachmentRef.attachment = 1;
@@ -474,7 +551,7 @@ int Graphics::createDefaultRenderPass()
 	renderPassInfo.dependencyCount = 1;
 	renderPassInfo.pDependencies = &dependency;
 
-	if (vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_defaultRenderPass) != VK_SUCCESS) {
+	if (vkCreateRenderPass(m_device, &renderPassInfo, m_hostAllocator.getCallbacks(), &m_defaultRenderPass) != VK_SUCCESS) {
 		panicF("failed to create render pass!");
 		return 0;
 	}
@@ -482,46 +559,139 @@ int Graphics::createDefaultRenderPass()
 	return 1;
 }
 
+int Graphics::createDepthResources()
+{
+	//depth aspect only in the view, so it can be sampled even with stencil in the format
+	if (!gpu::CreateImage2D(m_physDevice, m_device, m_hostAllocator.getCallbacks(), m_swapchain.m_extent, 1, m_depthFormat,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_DEPTH_BIT, m_depthImage)) {
+		panicF("failed to create depth buffer!");
+		return 0;
+	}
+
+	return 1;
+}
+
+int Graphics::createFramebuffers()
+{
+	m_swapchain.m_frameBuffers.resize(m_swapchain.m_imageViews.size());
+
+	//one per swapchain image, all sharing the depth buffer
+	for (size_t i = 0; i < m_swapchain.m_imageViews.size(); i++) {
+		std::array<VkImageView, 2> attachments = { m_swapchain.m_imageViews[i], m_depthImage.view };
+
+		VkFramebufferCreateInfo framebufferInfo = {};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = m_defaultRenderPass;
+		framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		framebufferInfo.pAttachments = attachments.data();
+		framebufferInfo.width = m_swapchain.m_extent.width;
+		framebufferInfo.height = m_swapchain.m_extent.height;
+		framebufferInfo.layers = 1;
+
+		if (vkCreateFramebuffer(m_device, &framebufferInfo, m_hostAllocator.getCallbacks(), &m_swapchain.m_frameBuffers[i]) != VK_SUCCESS) {
+			panicF("failed to create framebuffer!");
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
 int Graphics::createDefaultDescriptorSetLayout()
 {
-	//uniform buffers
-	VkDescriptorSetLayoutBinding uboLayoutBinding = {};
-	uboLayoutBinding.binding = 0;
-	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	uboLayoutBinding.descriptorCount = 1;
-	uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	uboLayoutBinding.pImmutableSamplers = nullptr; // Optional
-
-	//image sampler
-	VkDescriptorSetLayoutBinding samplerLayoutBinding = {};
-	samplerLayoutBinding.binding = 1;
-	samplerLayoutBinding.descriptorCount = 1;
-	samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	samplerLayoutBinding.pImmutableSamplers = nullptr;
-	samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-	//create the layout info
-	std::array<VkDescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, samplerLayoutBinding };
-	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
-	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-	layoutInfo.pBindings = bindings.data();
-
-	if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_defaultLayout) != VK_SUCCESS) {
-		panicF("failed to create descriptor set layout!");
+	//Layouts come from what the shaders declare, not restated here
+	m_shaders.load("vert.spv", "shader.vert");
+	m_shaders.load("frag.spv", "shader.frag");
+
+	const ShaderReflection* vert = m_shaders.getReflection("vert.spv");
+	const ShaderReflection* frag = m_shaders.getReflection("frag.spv");
+
+	PipelineLayoutDesc desc = shader::MergeLayouts({ vert, frag });
+	if (desc.sets.empty()) {
+		panicF("default shaders declare no descriptor sets!");
+		return 0;
+	}
+
+	//Trilinear, wrapping, as anisotropic as the device goes
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.magFilter = VK_FILTER_LINEAR;
+	samplerInfo.minFilter = VK_FILTER_LINEAR;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	samplerInfo.anisotropyEnable = VK_TRUE;
+	samplerInfo.maxAnisotropy = 16.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	m_defaultSampler = m_samplers.get(samplerInfo);
+	if (m_defaultSampler == VK_NULL_HANDLE) {
+		panicF("failed to get the default sampler!");
 		return 0;
 	}
 
+	//every texture the default shaders sample goes through it, baked into the layout
+	uint32_t samplerCount = 0;
+	for (const auto& set : desc.sets) {
+		for (const auto& binding : set) {
+			samplerCount = std::max(samplerCount, binding.descriptorCount);
+		}
+	}
+	const std::vector<VkSampler> immutableSamplers(samplerCount, m_defaultSampler);
+
+	for (uint32_t set = 0; set < desc.sets.size(); set++) {
+		for (const auto& binding : desc.sets[set]) {
+			if (binding.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLER || binding.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) {
+				shader::SetImmutableSamplers(desc, set, binding.binding, immutableSamplers.data());
+			}
+		}
+	}
+
+	//shared with any other pipeline whose shaders have the same interface
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	m_defaultPipelineLayout = m_layouts.getPipelineLayout(desc, &setLayouts);
+	m_defaultLayout = setLayouts[0];
+
 	return 1;
 }
 
-int Graphics::createDefaultPipeline()
+VkPipeline Graphics::getDefaultPipeline(uint32_t features, VertexFormat format)
 {
-	auto vertShaderCode = mem::ReadFile("../Media/Shaders/vert.spv");
-	auto fragShaderCode = mem::ReadFile("../Media/Shaders/frag.spv");
+	//nothing to multiply by without a colour attribute
+	if (!vertex::HasColour(format)) {
+		features &= ~kShaderVertexColour;
+	}
+
+	const uint32_t key = features | (static_cast<uint32_t>(format) << 16);
 
-	VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-	VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+	auto it = m_defaultPipelines.find(key);
+	if (it != m_defaultPipelines.end()) {
+		return it->second;
+	}
+
+	//first use of this feature set and format - built once, kept until the swapchain goes
+	VkPipeline pipeline = createDefaultPipeline(features, format);
+	if (pipeline != VK_NULL_HANDLE) {
+		m_defaultPipelines.emplace(key, pipeline);
+	}
+
+	return pipeline;
+}
+
+VkPipeline Graphics::createDefaultPipeline(uint32_t features, VertexFormat format)
+{
+	//owned by the shader library, kept for rebuilds. Features that change the
+	//module come from a define permutation, the rest are specialized below.
+	const std::vector<std::string> vertDefines = vertex::GetShaderDefines(format);
+	const std::string vertName = shader::PermutationName("vert.spv", vertDefines);
+	const std::vector<std::string> fragDefines = shader::FeatureDefines(features);
+	VkShaderModule vertShaderModule = m_shaders.load(vertName, "shader.vert", vertDefines);
+	VkShaderModule fragShaderModule = m_shaders.load(shader::PermutationName("frag.spv", fragDefines), "shader.frag", fragDefines);
+
+	Specialization specialization = Specialization::FromFeatures(features);
+	if (features & kShaderAlphaTest) {
+		specialization.set(kShaderAlphaCutoffId, kAlphaTestCutoff);
+	}
 
 	//Vertex Shader
 	VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
@@ -529,11 +699,6 @@ int Graphics::createDefaultPipeline()
 	vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
 	vertShaderStageInfo.module = vertShaderModule;
 	vertShaderStageInfo.pName = "main";
-	//pSpecializationInfo:  You can use a single shader module where its behavior can be 
-	//configured at pipeline creation by specifying different values for the constants 
-	//used in it. This is more efficient than configuring the shader using variables at 
-	//render time, because the compiler can do optimizations like eliminating if statements 
-	//that depend on these values.
 
 	//Frag Shader
 	VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
@@ -541,20 +706,21 @@ int Graphics::createDefaultPipeline()
 	fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 	fragShaderStageInfo.module = fragShaderModule;
 	fragShaderStageInfo.pName = "main";
+	//feature branches are folded by the driver when the pipeline is created
+	fragShaderStageInfo.pSpecializationInfo = specialization.getInfo();
 
 	//Store Stages
 	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
-	//Vertex Input - from Model Vertex format
-	auto bindingDescription = Vertex_Pos3Col3Uv2::getBindingDescription();
-	auto attributeDescriptions = Vertex_Pos3Col3Uv2::getAttributeDescriptions();
+	//Vertex Input - the shader's inputs, stored as the mesh's format
+	const VertexInputDesc vertexInput = vertex::BuildInput(format, *m_shaders.getReflection(vertName));
 
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInput.attributes.size());
+	vertexInputInfo.pVertexBindingDescriptions = &vertexInput.binding;
+	vertexInputInfo.pVertexAttributeDescriptions = vertexInput.attributes.data();
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
 	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -665,19 +831,6 @@ int Graphics::createDefaultPipeline()
 	depthStencil.minDepthBounds = 0.0f; // Optional
 	depthStencil.maxDepthBounds = 1.0f; // Optional
 
-	//Pipeline Layout
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = &m_defaultLayout;
-	pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-	pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
-
-	if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_defaultPipelineLayout) != VK_SUCCESS) {
-		panicF("failed to create pipeline layout!");
-		return 0;
-	}
-
 	//Create the pipeline object
 	VkGraphicsPipelineCreateInfo pipelineInfo = {};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -693,6 +846,7 @@ int Graphics::createDefaultPipeline()
 	pipelineInfo.pColorBlendState = &colorBlending;
 	pipelineInfo.pDynamicState = nullptr; // Optional
 
+	//Pipeline Layout - from createDefaultDescriptorSetLayout, owned by the cache
 	pipelineInfo.layout = m_defaultPipelineLayout;
 
 	pipelineInfo.renderPass = m_defaultRenderPass;
@@ -702,42 +856,61 @@ int Graphics::createDefaultPipeline()
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
 	pipelineInfo.basePipelineIndex = -1; // Optional
 
-	if (vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_defaultPipeline) != VK_SUCCESS) {
+	VkPipeline pipeline;
+	if (vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, m_hostAllocator.getCallbacks(), &pipeline) != VK_SUCCESS) {
 		panicF("failed to create graphics pipeline!");
-		return 0;
+		return VK_NULL_HANDLE;
+	}
+
+	return pipeline;
+}
+
+int Graphics::rebuildDefaultPipeline()
+{
+	//device is idle - the shader library waits before calling back
+	for (auto& pipeline : m_defaultPipelines) {
+		vkDestroyPipeline(m_device, pipeline.second, m_hostAllocator.getCallbacks());
 	}
 
-	vkDestroyShaderModule(m_device, fragShaderModule, nullptr);
-	vkDestroyShaderModule(m_device, vertShaderModule, nullptr);
+	//interface may have changed - an unchanged one gets the cached layouts back
+	CHECK_RET(createDefaultDescriptorSetLayout());
+
+	//rebuild the permutations that were in use
+	for (auto& pipeline : m_defaultPipelines) {
+		pipeline.second = createDefaultPipeline(pipeline.first & 0xFFFF, static_cast<VertexFormat>(pipeline.first >> 16));
+		if (pipeline.second == VK_NULL_HANDLE) return 0;
+	}
 
 	return 1;
 }
 
 int Graphics::cleanupSwapchain()
 {
-	//cleanup depth buffer TODO
-	//vkDestroyImageView(m_device, depthImageView, nullptr);
-	//vkDestroyImage(m_device, depthImage, nullptr);
-	//vkFreeMemory(m_device, depthImageMemory, nullptr);
-
 	//Destroy all framebuffers
 	for (auto framebuffer : m_swapchain.m_frameBuffers) {
-		vkDestroyFramebuffer(m_device, framebuffer, nullptr);
+		vkDestroyFramebuffer(m_device, framebuffer, m_hostAllocator.getCallbacks());
 	}
+	m_swapchain.m_frameBuffers.clear();
+
+	//cleanup depth buffer
+	gpu::DestroyImage(m_device, m_hostAllocator.getCallbacks(), m_depthImage);
 
 	//free up command buffers TODO
 	//vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
 
-	vkDestroyPipeline(m_device, m_defaultPipeline, nullptr);
-	vkDestroyPipelineLayout(m_device, m_defaultPipelineLayout, nullptr);
-	vkDestroyRenderPass(m_device, m_defaultRenderPass, nullptr);
+	for (auto& pipeline : m_defaultPipelines) {
+		vkDestroyPipeline(m_device, pipeline.second, m_hostAllocator.getCallbacks());
+	}
+	m_defaultPipelines.clear();
+
+	vkDestroyRenderPass(m_device, m_defaultRenderPass, m_hostAllocator.getCallbacks());
 
 	//destroy all image views
 	for (auto imageView : m_swapchain.m_imageViews) {
-		vkDestroyImageView(m_device, imageView, nullptr);
+		vkDestroyImageView(m_device, imageView, m_hostAllocator.getCallbacks());
 	}
 
-	vkDestroySwapchainKHR(m_device, m_swapchain.m_swapChain, nullptr);
+	vkDestroySwapchainKHR(m_device, m_swapchain.m_swapChain, m_hostAllocator.getCallbacks());
 
 	return 1;
 }
@@ -977,7 +1150,7 @@ VkImageView Graphics::createVkImageView(VkDevice device, VkImage image, VkFormat
 	viewInfo.subresourceRange.aspectMask = aspectFlags;
 
 	VkImageView imageView;
-	if (vkCreateImageView(device, &viewInfo, nullptr, &imageView) != VK_SUCCESS) {
+	if (vkCreateImageView(device, &viewInfo, m_hostAllocator.getCallbacks(), &imageView) != VK_SUCCESS) {
 		errorF("failed to create texture image view!");
 	}
 
@@ -1000,18 +1173,3 @@ VkFormat Graphics::findSupportedFormat(VkPhysicalDevice physicalDevice, const st
 
 	panicF("Graphics::findSupportedFormat() - failed to find supported format!");
 }
-
-VkShaderModule Graphics::createShaderModule(const std::vector<char>& shaderBin)
-{
-	VkShaderModuleCreateInfo createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = shaderBin.size();
-	createInfo.pCode = reinterpret_cast<const uint32_t*>(shaderBin.data());
-
-	VkShaderModule shaderModule;
-	if (vkCreateShaderModule(m_device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-		panicF("failed to create shader module!");
-	}
-
-	return shaderModule;
-}
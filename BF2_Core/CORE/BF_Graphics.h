@@ -1,10 +1,21 @@
 #pragma once
 
 #include <memory>
+#include <unordered_map>
 #include <vector>
 #include "../Graphics & Window/BF_Window.h"
 #include "../Graphics & Window/VK_QueueFamilyIndices.h"
 #include "../Graphics & Window/VK_Swapchain.h"
+#include "../Graphics & Window/BF_GpuProfiler.h"
+#include "../Graphics & Window/BF_VkHostAllocator.h"
+#include "../Graphics & Window/BF_ShaderLibrary.h"
+#include "../Graphics & Window/BF_LayoutCache.h"
+#include "../Graphics & Window/BF_SamplerCache.h"
+#include "../Graphics & Window/BF_ShaderPermutation.h"
+#include "../Graphics & Window/BF_VertexFormat.h"
+#include "../Graphics & Window/BF_GpuImage.h"
+#include "../Graphics & Window/BF_DepthPyramid.h"
+#include "../Graphics & Window/BF_TextureStreamer.h"
 
 #include <vulkan/vulkan.h>
 
@@ -16,13 +27,21 @@ public:
 	Graphics(const Graphics&) = delete;
 	Graphics& operator=(const Graphics&) = delete;
 
-	void init();
+	//io streams textures in
+	void init(IOService& io);
 	void shutdown();
 
 	void frame();
 
 	const double queryTimer() const;
 
+	GpuProfiler& getGpuProfiler();
+	TextureStreamer& getTextureStreamer();
+	SamplerCache& getSamplerCache();
+
+	//Driver host memory stats
+	const VkHostAllocator& getHostAllocator() const;
+
 	const bool getExitFlag() const;
 
 private:
@@ -43,8 +62,15 @@ private:
 	int createVkLogicalDevice();
 	int createSwapchain();
 	int createDefaultRenderPass();
+	int createDepthResources();
+	int createFramebuffers();
 	int createDefaultDescriptorSetLayout();
-	int createDefaultPipeline();
+	VkPipeline createDefaultPipeline(uint32_t features, VertexFormat);
+	int rebuildDefaultPipeline();
+
+	//Default pipeline specialized for a ShaderFeature mask and the mesh's vertex
+	//format, created on first use
+	VkPipeline getDefaultPipeline(uint32_t features, VertexFormat = VertexFormat::Pos3Col3Uv2);
 
 	//cleanup
 	int cleanupSwapchain();
@@ -64,7 +90,9 @@ private:
 	//Helpers
 	VkImageView createVkImageView(VkDevice, VkImage, VkFormat, VkImageAspectFlags);
 	VkFormat findSupportedFormat(VkPhysicalDevice, const std::vector<VkFormat>&, VkImageTiling, VkFormatFeatureFlags);
-	VkShaderModule createShaderModule(const std::vector<char>&);
+
+	//pAllocator for every vkCreate*/vkDestroy*
+	VkHostAllocator				m_hostAllocator;
 
 	VkDebugUtilsMessengerEXT	m_debugMsgr;
 
@@ -77,12 +105,35 @@ private:
 	VkQueue						m_presentQueue;
 
 	VkRenderPass				m_defaultRenderPass;
-	VkDescriptorSetLayout		m_defaultLayout;
-	VkPipeline					m_defaultPipeline;
-	VkPipelineLayout			m_defaultPipelineLayout;
+	VkDescriptorSetLayout		m_defaultLayout;			//owned by m_layouts
+	std::unordered_map<uint32_t, VkPipeline> m_defaultPipelines;	//by ShaderFeature mask | VertexFormat << 16
+	VkPipelineLayout			m_defaultPipelineLayout;	//owned by m_layouts
+	VkSampler					m_defaultSampler;			//owned by m_samplers, immutable in m_defaultLayout
 
 	Swapchain					m_swapchain;
 
+	//Depth attachment of the default render pass, sampled afterwards for the pyramid
+	VkFormat					m_depthFormat;
+	GpuImage					m_depthImage;
+
+	//Hierarchical Z built from m_depthImage, for occlusion culling
+	DepthPyramid				m_depthPyramid;
+
+	GpuProfiler					m_gpuProfiler;
+
+	//Texture mips by on-screen demand, under kTextureMemoryBudget
+	TextureStreamer				m_textures;
+	IOService*					m_io;
+
+	//Packed or loose SPIR-V, hot reloaded from source when enabled
+	ShaderLibrary				m_shaders;
+
+	//Descriptor set and pipeline layouts reflected from the shaders, shared by equal interface
+	LayoutCache					m_layouts;
+
+	//Every sampler, one per distinct state
+	SamplerCache				m_samplers;
+
 	bool m_enableValidationLayers;
 	std::vector<const char*> m_validationLayers;
 	std::vector<const char*> m_deviceExtensions;
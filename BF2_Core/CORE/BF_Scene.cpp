@@ -1,17 +1,252 @@
 #include "BF_Scene.h"
+#include "../Utils/BF_Consts.h"
+#include "../Utils/BF_Profiler.h"
 
-Scene::Scene()
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+Scene::Scene() : m_spatialIndex(SpatialIndex::Bvh), m_cameraPosition(0.0f), m_projectionScale(0.0f), m_hasCamera(false)
 {
 }
 
 void Scene::init()
 {
+	m_grid.init(kGridCellSize);
 }
 
 void Scene::shutdown()
 {
+	m_previousTransforms.clear();
+	m_currentTransforms.clear();
+	m_nextTransforms.clear();
+	m_renderTransforms.clear();
+	m_lods.clear();
+	m_localBounds.clear();
+	m_bvh.clear();
+	m_grid.clear();
 }
 
 void Scene::update()
 {
+	//The state we are about to advance becomes the interpolation source, and
+	//moves made since the last step land now - so each blends in over one step.
+	//Swapped, not copied, so only next is copied and no storage is reallocated.
+	std::swap(m_previousTransforms, m_currentTransforms);
+	m_currentTransforms = m_nextTransforms;
+}
+
+void Scene::interpolate(float alpha)
+{
+	for (size_t i = 0; i < m_currentTransforms.size(); i++) {
+		m_renderTransforms[i] = Transform::interpolate(m_previousTransforms[i], m_currentTransforms[i], alpha);
+	}
+
+	updateBounds();
+	selectLods();
+}
+
+EntityId Scene::createEntity(const Transform& transform)
+{
+	const EntityId id = static_cast<EntityId>(m_currentTransforms.size());
+
+	m_previousTransforms.push_back(transform);
+	m_currentTransforms.push_back(transform);
+	m_nextTransforms.push_back(transform);
+	m_renderTransforms.push_back(transform);
+	m_lods.push_back(LodState{ {}, glm::vec3(0.0f), 0.0f, 0 });
+
+	Aabb point;
+	point.min = glm::vec3(0.0f);
+	point.max = glm::vec3(0.0f);
+	m_localBounds.push_back(point);
+
+	if (m_spatialIndex == SpatialIndex::Grid) {
+		m_grid.insert(id, worldBounds(id));
+	}
+	else {
+		m_bvh.insert(id, worldBounds(id));
+	}
+
+	return id;
+}
+
+void Scene::setTransform(EntityId id, const Transform& transform, bool snap)
+{
+	m_nextTransforms[id] = transform;
+
+	if (snap) {
+		m_previousTransforms[id] = transform;
+		m_currentTransforms[id] = transform;
+		m_renderTransforms[id] = transform;
+	}
+}
+
+const Transform& Scene::getTransform(EntityId id) const
+{
+	return m_nextTransforms[id];
+}
+
+const Transform& Scene::getRenderTransform(EntityId id) const
+{
+	return m_renderTransforms[id];
+}
+
+void Scene::setLods(EntityId id, const std::vector<float>& errors, const glm::vec3& centre, float radius)
+{
+	m_lods[id].errors = errors;
+	m_lods[id].centre = centre;
+	m_lods[id].radius = radius;
+	m_lods[id].current = 0;
+}
+
+void Scene::setCamera(const glm::vec3& position, float fovY, float viewportHeight)
+{
+	m_cameraPosition = position;
+	m_projectionScale = viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+	m_hasCamera = true;
+}
+
+const uint32_t Scene::getLod(EntityId id) const
+{
+	return m_lods[id].current;
+}
+
+void Scene::setBounds(EntityId id, const Aabb& localBounds)
+{
+	m_localBounds[id] = localBounds;
+
+	if (m_spatialIndex == SpatialIndex::Grid) {
+		m_grid.update(id, worldBounds(id));
+	}
+	else {
+		m_bvh.update(id, worldBounds(id));
+	}
+}
+
+void Scene::setSpatialIndex(SpatialIndex index)
+{
+	if (index == m_spatialIndex) return;
+
+	BF_PROFILE_ZONE("Scene::setSpatialIndex");
+
+	std::vector<Aabb> bounds(m_localBounds.size());
+	for (size_t i = 0; i < bounds.size(); i++) {
+		bounds[i] = worldBounds(static_cast<EntityId>(i));
+	}
+
+	//Only the active index is kept up to date, the other is dropped
+	if (index == SpatialIndex::Grid) {
+		m_grid.rebuild(bounds.data(), bounds.size());
+		m_bvh.clear();
+	}
+	else {
+		m_bvh.build(bounds.data(), bounds.size());
+		m_grid.clear();
+	}
+
+	m_spatialIndex = index;
+}
+
+const SpatialIndex Scene::getSpatialIndex() const
+{
+	return m_spatialIndex;
+}
+
+void Scene::queryBox(const Aabb& box, std::vector<EntityId>& out) const
+{
+	if (m_spatialIndex == SpatialIndex::Grid) {
+		m_grid.queryBox(box, out);
+	}
+	else {
+		m_bvh.queryBox(box, out);
+	}
+}
+
+void Scene::queryFrustum(const glm::vec4 planes[6], std::vector<EntityId>& out) const
+{
+	if (m_spatialIndex == SpatialIndex::Grid) {
+		m_grid.queryFrustum(planes, out);
+	}
+	else {
+		m_bvh.queryFrustum(planes, out);
+	}
+}
+
+bool Scene::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, EntityId& hit, float& distance) const
+{
+	if (m_spatialIndex == SpatialIndex::Grid) {
+		return m_grid.raycast(origin, direction, maxDistance, hit, distance);
+	}
+	return m_bvh.raycast(origin, direction, maxDistance, hit, distance);
+}
+
+void Scene::updateBounds()
+{
+	BF_PROFILE_ZONE("Scene::updateBounds");
+
+	//Grid moves are O(1) and need no refit
+	if (m_spatialIndex == SpatialIndex::Grid) {
+		for (size_t i = 0; i < m_renderTransforms.size(); i++) {
+			m_grid.update(static_cast<EntityId>(i), worldBounds(static_cast<EntityId>(i)));
+		}
+		return;
+	}
+
+	//Unmoved boxes compare equal and leave the tree alone
+	for (size_t i = 0; i < m_renderTransforms.size(); i++) {
+		m_bvh.update(static_cast<EntityId>(i), worldBounds(static_cast<EntityId>(i)));
+	}
+
+	m_bvh.refit();
+}
+
+Aabb Scene::worldBounds(EntityId id) const
+{
+	return m_localBounds[id].transformed(m_renderTransforms[id]);
+}
+
+void Scene::selectLods()
+{
+	if (!m_hasCamera) return;
+
+	BF_PROFILE_ZONE("Scene::selectLods");
+
+	for (size_t i = 0; i < m_lods.size(); i++) {
+		LodState& lod = m_lods[i];
+		if (lod.errors.size() < 2) continue;
+
+		const Transform& transform = m_renderTransforms[i];
+		const float scale = std::max(transform.scale.x, std::max(transform.scale.y, transform.scale.z));
+
+		//Nearest point of the bounding sphere, whose centre needn't be the mesh
+		//origin - inside it always gets full detail
+		const glm::vec3 centre = transform.position + transform.rotation * (lod.centre * transform.scale);
+		const float distance = glm::length(centre - m_cameraPosition) - lod.radius * scale;
+		if (distance <= 0.0f) {
+			lod.current = 0;
+			continue;
+		}
+
+		const float pixelsPerUnit = m_projectionScale * scale / distance;
+
+		//Coarsest level that projects within the limit. Dropping to a coarser level
+		//than now must clear a tighter limit, so an object sat on the boundary
+		//doesn't pop back and forth every frame.
+		uint32_t selected = 0;
+		for (uint32_t level = static_cast<uint32_t>(lod.errors.size()) - 1; level > 0; level--) {
+			const float limit = level > lod.current ? kLodPixelError * (1.0f - kLodHysteresis) : kLodPixelError;
+			if (lod.errors[level] * pixelsPerUnit <= limit) {
+				selected = level;
+				break;
+			}
+		}
+
+		lod.current = selected;
+	}
+}
+
+const size_t Scene::getEntityCount() const
+{
+	return m_currentTransforms.size();
 }
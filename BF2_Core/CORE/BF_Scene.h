@@ -1,5 +1,20 @@
 #pragma once
 
+#include <vector>
+#include <cstdint>
+#include "../Utils/BF_Transform.h"
+#include "../Utils/BF_Bvh.h"
+#include "../Utils/BF_SpatialGrid.h"
+
+using EntityId = uint32_t;
+
+//Index behind the spatial queries - the BVH suits mostly still scenes, the grid
+//ones where most entities move every frame (crowds), where refits degrade
+enum class SpatialIndex : uint32_t {
+	Bvh,
+	Grid
+};
+
 class Scene {
 public:
 	Scene();
@@ -9,8 +24,80 @@ public:
 	void init();
 	void shutdown();
 
+	//Advance the simulation by one fixed step (kFixedTimestep)
 	void update();
 
+	//Blend the last two simulation states for rendering, alpha in [0, 1]
+	void interpolate(float alpha);
+
+	EntityId createEntity(const Transform&);
+
+	//Takes effect at the next update and is blended in over that step, whenever
+	//it is called. snap applies it at once with no blend (teleports, spawns).
+	void setTransform(EntityId, const Transform&, bool snap = false);
+
+	//Latest transform set, ahead of what is drawn until the next update
+	const Transform& getTransform(EntityId) const;
+	const Transform& getRenderTransform(EntityId) const;
+
+	//Discrete LODs for the entity's mesh - each level's error in mesh units, finest
+	//first (LodChain::lods), and the mesh's bounding sphere in its own space
+	//(LodChain::centre, LodChain::radius)
+	void setLods(EntityId, const std::vector<float>& errors, const glm::vec3& centre, float radius);
+
+	//Viewpoint LODs are picked for, fovY in radians and viewport height in pixels
+	void setCamera(const glm::vec3& position, float fovY, float viewportHeight);
+
+	//Level to draw this frame, 0 until a camera is set
+	const uint32_t getLod(EntityId) const;
+
+	//Entity bounds in its own space, carried by the render transform - a point
+	//at its position until set
+	void setBounds(EntityId, const Aabb& localBounds);
+
+	//Switches index, rebuilding the new one from the current bounds
+	void setSpatialIndex(SpatialIndex);
+	const SpatialIndex getSpatialIndex() const;
+
+	//Spatial queries over the bounds as last drawn (interpolate), appending to out
+	void queryBox(const Aabb&, std::vector<EntityId>& out) const;
+	void queryFrustum(const glm::vec4 planes[6], std::vector<EntityId>& out) const;
+
+	//Nearest entity bounds along the ray, direction normalized
+	bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, EntityId& hit, float& distance) const;
+
+	const size_t getEntityCount() const;
+
 private:
+	struct LodState {
+		std::vector<float> errors;
+		glm::vec3 centre;
+		float radius;
+		uint32_t current;
+	};
+
+	//Per frame, from the render transforms - coarsest level within kLodPixelError
+	void selectLods();
+
+	//Per frame, moves every entity's box in the active index to its render transform
+	void updateBounds();
+
+	Aabb worldBounds(EntityId) const;
+
+	//Simulation state at the previous and current fixed step, and the blend drawn this frame
+	std::vector<Transform> m_previousTransforms;
+	std::vector<Transform> m_currentTransforms;
+	std::vector<Transform> m_nextTransforms;		//set since the last step, current on the next
+	std::vector<Transform> m_renderTransforms;
+
+	std::vector<LodState> m_lods;
+
+	std::vector<Aabb> m_localBounds;
+	SpatialIndex m_spatialIndex;
+	Bvh m_bvh;
+	SpatialGrid m_grid;
 
-};
\ No newline at end of file
+	glm::vec3	m_cameraPosition;
+	float		m_projectionScale;		//pixels per unit of size at unit distance
+	bool		m_hasCamera;
+};
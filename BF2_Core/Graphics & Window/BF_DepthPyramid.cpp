@@ -0,0 +1,334 @@
+#include "BF_DepthPyramid.h"
+#include "BF_LayoutCache.h"
+#include "BF_SamplerCache.h"
+#include "BF_ShaderLibrary.h"
+#include "../Utils/BF_Error.h"
+
+#include <algorithm>
+
+//Must match local_size in depth_reduce.comp
+static constexpr uint32_t kReduceGroupSize = 8;
+
+namespace {
+	struct ReducePush {
+		uint32_t srcSize[2];
+		uint32_t dstSize[2];
+	};
+
+	uint32_t previousPow2(uint32_t value)
+	{
+		uint32_t result = 1;
+		while (result * 2 <= value) {
+			result *= 2;
+		}
+		return result;
+	}
+}
+
+DepthPyramid::DepthPyramid() : m_physDevice(VK_NULL_HANDLE), m_device(VK_NULL_HANDLE), m_pAllocator(nullptr),
+	m_shaders(nullptr), m_layouts(nullptr), m_pipeline(VK_NULL_HANDLE), m_pipelineLayout(VK_NULL_HANDLE),
+	m_setLayout(VK_NULL_HANDLE), m_descriptorPool(VK_NULL_HANDLE), m_sampler(VK_NULL_HANDLE), m_dependency(0),
+	m_depthView(VK_NULL_HANDLE), m_depthExtent({ 0, 0 }), m_pyramid()
+{
+}
+
+int DepthPyramid::init(VkPhysicalDevice physDevice, VkDevice device, const VkAllocationCallbacks* pAllocator, ShaderLibrary& shaders, LayoutCache& layouts, SamplerCache& samplers)
+{
+	m_physDevice = physDevice;
+	m_device = device;
+	m_pAllocator = pAllocator;
+	m_shaders = &shaders;
+	m_layouts = &layouts;
+
+	//Point sampling - the reduction reads texels directly, and filtering between
+	//farthest depths would give a depth nearer than some of them
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.magFilter = VK_FILTER_NEAREST;
+	samplerInfo.minFilter = VK_FILTER_NEAREST;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+	m_sampler = samplers.get(samplerInfo);
+	if (m_sampler == VK_NULL_HANDLE) {
+		errorF("DepthPyramid - failed to get sampler!");
+		return 0;
+	}
+
+	if (!createPipeline()) return 0;
+
+	m_dependency = m_shaders->addDependency({ "depth_reduce.spv" }, [this]() {
+		vkDestroyPipeline(m_device, m_pipeline, m_pAllocator);
+		m_pipeline = VK_NULL_HANDLE;
+
+		const VkDescriptorSetLayout previous = m_setLayout;
+		if (createPipeline() && m_setLayout != previous) {
+			createDescriptorSets();
+		}
+	});
+
+	return 1;
+}
+
+void DepthPyramid::shutdown()
+{
+	if (m_shaders != nullptr) {
+		m_shaders->removeDependency(m_dependency);
+		m_shaders = nullptr;
+	}
+
+	destroyLevels();
+
+	if (m_descriptorPool != VK_NULL_HANDLE) {
+		vkDestroyDescriptorPool(m_device, m_descriptorPool, m_pAllocator);
+		m_descriptorPool = VK_NULL_HANDLE;
+	}
+
+	if (m_pipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(m_device, m_pipeline, m_pAllocator);
+		m_pipeline = VK_NULL_HANDLE;
+	}
+
+	m_sampler = VK_NULL_HANDLE;
+}
+
+int DepthPyramid::createPipeline()
+{
+	VkShaderModule module = m_shaders->loadOptional("depth_reduce.spv", "depth_reduce.comp");
+	const ShaderReflection* reflection = m_shaders->getReflection("depth_reduce.spv");
+	if (module == VK_NULL_HANDLE || reflection == nullptr) {
+		errorF("DepthPyramid - reduction shader failed to load, occlusion culling unavailable");
+		return 0;
+	}
+
+	PipelineLayoutDesc desc = shader::MergeLayouts({ reflection });
+	if (desc.sets.empty()) {
+		errorF("DepthPyramid - reduction shader declares no descriptor sets!");
+		return 0;
+	}
+
+	//The source of every reduction is point sampled
+	if (!shader::SetImmutableSamplers(desc, 0, 0, &m_sampler)) {
+		errorF("DepthPyramid - reduction shader's source isn't at binding 0!");
+		return 0;
+	}
+
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	m_pipelineLayout = m_layouts->getPipelineLayout(desc, &setLayouts);
+	m_setLayout = setLayouts[0];
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = module;
+	pipelineInfo.stage.pName = reflection->entryPoint.c_str();
+	pipelineInfo.layout = m_pipelineLayout;
+
+	VkResult res = vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, m_pAllocator, &m_pipeline);
+	if (res != VK_SUCCESS) {
+		errorF("DepthPyramid - failed to create reduction pipeline! - VkResult %i", res);
+		m_pipeline = VK_NULL_HANDLE;
+		return 0;
+	}
+
+	return 1;
+}
+
+int DepthPyramid::resize(VkImageView depthView, VkExtent2D depthExtent)
+{
+	destroyLevels();
+
+	m_depthView = depthView;
+	m_depthExtent = depthExtent;
+
+	const VkExtent2D extent = { previousPow2(std::max(depthExtent.width, 1u)), previousPow2(std::max(depthExtent.height, 1u)) };
+	const uint32_t mipLevels = gpu::MipCount(extent);
+
+	if (!gpu::CreateImage2D(m_physDevice, m_device, m_pAllocator, extent, mipLevels, VK_FORMAT_R32_SFLOAT,
+		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, m_pyramid)) {
+		errorF("DepthPyramid - failed to create %ux%u pyramid", extent.width, extent.height);
+		return 0;
+	}
+
+	m_levelViews.resize(mipLevels, VK_NULL_HANDLE);
+	for (uint32_t i = 0; i < mipLevels; i++) {
+		m_levelViews[i] = gpu::CreateImageView(m_device, m_pAllocator, m_pyramid.image, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, i, 1);
+		if (m_levelViews[i] == VK_NULL_HANDLE) {
+			destroyLevels();
+			return 0;
+		}
+	}
+
+	return createDescriptorSets();
+}
+
+int DepthPyramid::createDescriptorSets()
+{
+	if (m_descriptorPool != VK_NULL_HANDLE) {
+		vkDestroyDescriptorPool(m_device, m_descriptorPool, m_pAllocator);
+		m_descriptorPool = VK_NULL_HANDLE;
+	}
+	m_levelSets.clear();
+
+	const uint32_t levelCount = static_cast<uint32_t>(m_levelViews.size());
+	if (levelCount == 0 || m_setLayout == VK_NULL_HANDLE) return 0;
+
+	VkDescriptorPoolSize poolSizes[2] = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = levelCount;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[1].descriptorCount = levelCount;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = levelCount;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+
+	VkResult res = vkCreateDescriptorPool(m_device, &poolInfo, m_pAllocator, &m_descriptorPool);
+	if (res != VK_SUCCESS) {
+		errorF("DepthPyramid - failed to create descriptor pool! - VkResult %i", res);
+		m_descriptorPool = VK_NULL_HANDLE;
+		return 0;
+	}
+
+	const std::vector<VkDescriptorSetLayout> setLayouts(levelCount, m_setLayout);
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = m_descriptorPool;
+	allocInfo.descriptorSetCount = levelCount;
+	allocInfo.pSetLayouts = setLayouts.data();
+
+	m_levelSets.resize(levelCount);
+	res = vkAllocateDescriptorSets(m_device, &allocInfo, m_levelSets.data());
+	if (res != VK_SUCCESS) {
+		errorF("DepthPyramid - failed to allocate descriptor sets! - VkResult %i", res);
+		m_levelSets.clear();
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < levelCount; i++) {
+		VkDescriptorImageInfo src = {};
+		src.sampler = m_sampler;
+		src.imageView = i == 0 ? m_depthView : m_levelViews[i - 1];
+		src.imageLayout = i == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+		VkDescriptorImageInfo dst = {};
+		dst.imageView = m_levelViews[i];
+		dst.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		VkWriteDescriptorSet writes[2] = {};
+		writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[0].dstSet = m_levelSets[i];
+		writes[0].dstBinding = 0;
+		writes[0].descriptorCount = 1;
+		writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writes[0].pImageInfo = &src;
+
+		writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[1].dstSet = m_levelSets[i];
+		writes[1].dstBinding = 1;
+		writes[1].descriptorCount = 1;
+		writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		writes[1].pImageInfo = &dst;
+
+		vkUpdateDescriptorSets(m_device, 2, writes, 0, nullptr);
+	}
+
+	return 1;
+}
+
+void DepthPyramid::destroyLevels()
+{
+	for (auto view : m_levelViews) {
+		if (view != VK_NULL_HANDLE) {
+			vkDestroyImageView(m_device, view, m_pAllocator);
+		}
+	}
+	m_levelViews.clear();
+	m_levelSets.clear();
+
+	gpu::DestroyImage(m_device, m_pAllocator, m_pyramid);
+}
+
+void DepthPyramid::build(VkCommandBuffer cmd)
+{
+	if (!isReady()) return;
+
+	//Depth writes done before the first level reads them
+	VkMemoryBarrier depthBarrier = {};
+	depthBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	depthBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	//Every level is rewritten - last frame's contents can go, once last frame's culling read them
+	VkImageMemoryBarrier pyramidBarrier = {};
+	pyramidBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	pyramidBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	pyramidBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	pyramidBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	pyramidBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	pyramidBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	pyramidBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	pyramidBarrier.image = m_pyramid.image;
+	pyramidBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_pyramid.mipLevels, 0, 1 };
+
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &depthBarrier, 0, nullptr, 1, &pyramidBarrier);
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+
+	VkExtent2D src = m_depthExtent;
+	for (uint32_t i = 0; i < m_pyramid.mipLevels; i++) {
+		const VkExtent2D dst = { std::max(m_pyramid.extent.width >> i, 1u), std::max(m_pyramid.extent.height >> i, 1u) };
+
+		const ReducePush push = { { src.width, src.height }, { dst.width, dst.height } };
+
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_levelSets[i], 0, nullptr);
+		vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), &push);
+		vkCmdDispatch(cmd, (dst.width + kReduceGroupSize - 1) / kReduceGroupSize, (dst.height + kReduceGroupSize - 1) / kReduceGroupSize, 1);
+
+		//This level written before the next one, or the culling, reads it
+		VkImageMemoryBarrier levelBarrier = pyramidBarrier;
+		levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		levelBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		levelBarrier.subresourceRange.baseMipLevel = i;
+		levelBarrier.subresourceRange.levelCount = 1;
+
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &levelBarrier);
+
+		src = dst;
+	}
+}
+
+const VkImageView DepthPyramid::getView() const
+{
+	return m_pyramid.view;
+}
+
+const VkSampler DepthPyramid::getSampler() const
+{
+	return m_sampler;
+}
+
+const VkExtent2D DepthPyramid::getExtent() const
+{
+	return m_pyramid.extent;
+}
+
+const uint32_t DepthPyramid::getMipLevels() const
+{
+	return m_pyramid.mipLevels;
+}
+
+const bool DepthPyramid::isReady() const
+{
+	return m_pipeline != VK_NULL_HANDLE && !m_levelSets.empty();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+#include "BF_GpuImage.h"
+
+class ShaderLibrary;
+class LayoutCache;
+class SamplerCache;
+
+//Hierarchical Z - a mip chain of the depth buffer, every texel the farthest depth
+//under it. The first level is the depth buffer's size rounded down to powers of
+//two, so the footprint of any screen rectangle is at most 2x2 texels at the level
+//matching its size.
+class DepthPyramid {
+public:
+	DepthPyramid();
+	DepthPyramid(const DepthPyramid&) = delete;
+	DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+	int init(VkPhysicalDevice, VkDevice, const VkAllocationCallbacks*, ShaderLibrary&, LayoutCache&, SamplerCache&);
+	void shutdown();
+
+	//Recreates the pyramid for a depth buffer - after every swapchain (re)creation.
+	//The view must be of the depth aspect only.
+	int resize(VkImageView depthView, VkExtent2D depthExtent);
+
+	//Outside a render pass, once the depth buffer is written and in
+	//DEPTH_STENCIL_READ_ONLY_OPTIMAL. Ends readable by compute shaders.
+	void build(VkCommandBuffer);
+
+	//Whole chain in GENERAL layout, sample with getSampler() and textureLod
+	const VkImageView getView() const;
+	const VkSampler getSampler() const;
+	const VkExtent2D getExtent() const;
+	const uint32_t getMipLevels() const;
+
+	const bool isReady() const;
+
+private:
+	int createPipeline();
+	int createDescriptorSets();
+	void destroyLevels();
+
+	VkPhysicalDevice				m_physDevice;
+	VkDevice						m_device;
+	const VkAllocationCallbacks*	m_pAllocator;
+	ShaderLibrary*					m_shaders;
+	LayoutCache*					m_layouts;
+
+	VkPipeline			m_pipeline;
+	VkPipelineLayout	m_pipelineLayout;		//owned by m_layouts
+	VkDescriptorSetLayout m_setLayout;			//owned by m_layouts
+	VkDescriptorPool	m_descriptorPool;
+	VkSampler			m_sampler;				//owned by the sampler cache, immutable in m_setLayout
+	uint32_t			m_dependency;
+
+	VkImageView			m_depthView;
+	VkExtent2D			m_depthExtent;
+
+	GpuImage			m_pyramid;
+	std::vector<VkImageView> m_levelViews;		//one mip each, written by the reduction
+	std::vector<VkDescriptorSet> m_levelSets;	//level i reads i - 1 (the depth buffer for 0)
+};
@@ -0,0 +1,98 @@
+#include "BF_GpuBuffer.h"
+#include "../Utils/BF_Error.h"
+
+uint32_t gpu::FindMemoryType(VkPhysicalDevice physDevice, uint32_t typeBits, VkMemoryPropertyFlags properties)
+{
+	VkPhysicalDeviceMemoryProperties memProperties;
+	vkGetPhysicalDeviceMemoryProperties(physDevice, &memProperties);
+
+	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+		if ((typeBits & (1u << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			return i;
+		}
+	}
+
+	return ~0u;
+}
+
+int gpu::CreateBuffer(VkPhysicalDevice physDevice, VkDevice device, const VkAllocationCallbacks* pAllocator, VkDeviceSize size,
+	VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, GpuBuffer& out)
+{
+	out = {};
+
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VkResult res = vkCreateBuffer(device, &bufferInfo, pAllocator, &out.buffer);
+	if (res != VK_SUCCESS) {
+		errorF("Failed to create buffer of %llu bytes! - VkResult %i", static_cast<unsigned long long>(size), res);
+		return 0;
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(device, out.buffer, &requirements);
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = requirements.size;
+	allocInfo.memoryTypeIndex = FindMemoryType(physDevice, requirements.memoryTypeBits, properties);
+
+	if (allocInfo.memoryTypeIndex == ~0u) {
+		errorF("No memory type for buffer with properties 0x%x!", properties);
+		DestroyBuffer(device, pAllocator, out);
+		return 0;
+	}
+
+	res = vkAllocateMemory(device, &allocInfo, pAllocator, &out.memory);
+	if (res != VK_SUCCESS) {
+		errorF("Failed to allocate buffer memory! - VkResult %i", res);
+		DestroyBuffer(device, pAllocator, out);
+		return 0;
+	}
+
+	vkBindBufferMemory(device, out.buffer, out.memory, 0);
+	out.size = size;
+
+	if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		res = vkMapMemory(device, out.memory, 0, size, 0, &out.mapped);
+		if (res != VK_SUCCESS) {
+			errorF("Failed to map buffer memory! - VkResult %i", res);
+			DestroyBuffer(device, pAllocator, out);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+void gpu::DestroyBuffer(VkDevice device, const VkAllocationCallbacks* pAllocator, GpuBuffer& buffer)
+{
+	if (buffer.mapped != nullptr) {
+		vkUnmapMemory(device, buffer.memory);
+	}
+	if (buffer.buffer != VK_NULL_HANDLE) {
+		vkDestroyBuffer(device, buffer.buffer, pAllocator);
+	}
+	if (buffer.memory != VK_NULL_HANDLE) {
+		vkFreeMemory(device, buffer.memory, pAllocator);
+	}
+
+	buffer = {};
+}
+
+void gpu::CmdDrawIndexedIndirect(VkCommandBuffer cmd, const GpuBuffer& buffer, uint32_t drawCount, bool multiDrawIndirect)
+{
+	const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+
+	if (multiDrawIndirect) {
+		vkCmdDrawIndexedIndirect(cmd, buffer.buffer, 0, drawCount, stride);
+		return;
+	}
+
+	for (uint32_t i = 0; i < drawCount; i++) {
+		vkCmdDrawIndexedIndirect(cmd, buffer.buffer, static_cast<VkDeviceSize>(stride) * i, 1, stride);
+	}
+}
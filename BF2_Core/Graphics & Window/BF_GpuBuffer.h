@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+//A buffer and the memory bound to it. mapped is set when the memory is host
+//visible, and stays mapped for the buffer's lifetime.
+struct GpuBuffer {
+	VkBuffer		buffer;
+	VkDeviceMemory	memory;
+	VkDeviceSize	size;
+	void*			mapped;
+};
+
+namespace gpu {
+	//Index of a memory type allowed by typeBits with all of properties, ~0u if none
+	uint32_t FindMemoryType(VkPhysicalDevice, uint32_t typeBits, VkMemoryPropertyFlags properties);
+
+	//One allocation per buffer - fine for the handful of long lived buffers made so far
+	int CreateBuffer(VkPhysicalDevice, VkDevice, const VkAllocationCallbacks*, VkDeviceSize size,
+		VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, GpuBuffer& out);
+
+	void DestroyBuffer(VkDevice, const VkAllocationCallbacks*, GpuBuffer&);
+
+	//drawCount tightly packed VkDrawIndexedIndirectCommands - one call with
+	//multiDrawIndirect enabled on the device, one per command without
+	void CmdDrawIndexedIndirect(VkCommandBuffer, const GpuBuffer&, uint32_t drawCount, bool multiDrawIndirect);
+}
@@ -0,0 +1,115 @@
+#include "BF_GpuImage.h"
+#include "BF_GpuBuffer.h"
+#include "../Utils/BF_Error.h"
+
+#include <algorithm>
+
+int gpu::CreateImage2D(VkPhysicalDevice physDevice, VkDevice device, const VkAllocationCallbacks* pAllocator, VkExtent2D extent, uint32_t mipLevels,
+	VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, GpuImage& out)
+{
+	out = {};
+
+	VkImageCreateInfo imageInfo = {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = format;
+	imageInfo.extent = { extent.width, extent.height, 1 };
+	imageInfo.mipLevels = mipLevels;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = usage;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VkResult res = vkCreateImage(device, &imageInfo, pAllocator, &out.image);
+	if (res != VK_SUCCESS) {
+		errorF("Failed to create %ux%u image! - VkResult %i", extent.width, extent.height, res);
+		return 0;
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(device, out.image, &requirements);
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = requirements.size;
+	allocInfo.memoryTypeIndex = FindMemoryType(physDevice, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (allocInfo.memoryTypeIndex == ~0u) {
+		errorF("No device local memory type for image!");
+		DestroyImage(device, pAllocator, out);
+		return 0;
+	}
+
+	res = vkAllocateMemory(device, &allocInfo, pAllocator, &out.memory);
+	if (res != VK_SUCCESS) {
+		errorF("Failed to allocate image memory! - VkResult %i", res);
+		DestroyImage(device, pAllocator, out);
+		return 0;
+	}
+
+	vkBindImageMemory(device, out.image, out.memory, 0);
+
+	out.view = CreateImageView(device, pAllocator, out.image, format, aspect, 0, mipLevels);
+	if (out.view == VK_NULL_HANDLE) {
+		DestroyImage(device, pAllocator, out);
+		return 0;
+	}
+
+	out.format = format;
+	out.extent = extent;
+	out.mipLevels = mipLevels;
+
+	return 1;
+}
+
+VkImageView gpu::CreateImageView(VkDevice device, const VkAllocationCallbacks* pAllocator, VkImage image, VkFormat format, VkImageAspectFlags aspect,
+	uint32_t baseMipLevel, uint32_t mipLevels)
+{
+	VkImageViewCreateInfo viewInfo = {};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = format;
+	viewInfo.subresourceRange.aspectMask = aspect;
+	viewInfo.subresourceRange.baseMipLevel = baseMipLevel;
+	viewInfo.subresourceRange.levelCount = mipLevels;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	VkImageView view = VK_NULL_HANDLE;
+	VkResult res = vkCreateImageView(device, &viewInfo, pAllocator, &view);
+	if (res != VK_SUCCESS) {
+		errorF("Failed to create image view! - VkResult %i", res);
+		return VK_NULL_HANDLE;
+	}
+
+	return view;
+}
+
+void gpu::DestroyImage(VkDevice device, const VkAllocationCallbacks* pAllocator, GpuImage& image)
+{
+	if (image.view != VK_NULL_HANDLE) {
+		vkDestroyImageView(device, image.view, pAllocator);
+	}
+	if (image.image != VK_NULL_HANDLE) {
+		vkDestroyImage(device, image.image, pAllocator);
+	}
+	if (image.memory != VK_NULL_HANDLE) {
+		vkFreeMemory(device, image.memory, pAllocator);
+	}
+
+	image = {};
+}
+
+uint32_t gpu::MipCount(VkExtent2D extent)
+{
+	uint32_t levels = 1;
+	uint32_t size = std::max(extent.width, extent.height);
+	while (size > 1) {
+		size >>= 1;
+		levels++;
+	}
+	return levels;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+//A device local 2D image, its memory and a view of every mip level
+struct GpuImage {
+	VkImage			image;
+	VkDeviceMemory	memory;
+	VkImageView		view;
+	VkFormat		format;
+	VkExtent2D		extent;
+	uint32_t		mipLevels;
+};
+
+namespace gpu {
+	int CreateImage2D(VkPhysicalDevice, VkDevice, const VkAllocationCallbacks*, VkExtent2D extent, uint32_t mipLevels,
+		VkFormat, VkImageUsageFlags, VkImageAspectFlags, GpuImage& out);
+
+	//VK_NULL_HANDLE on failure
+	VkImageView CreateImageView(VkDevice, const VkAllocationCallbacks*, VkImage, VkFormat, VkImageAspectFlags,
+		uint32_t baseMipLevel = 0, uint32_t mipLevels = 1);
+
+	void DestroyImage(VkDevice, const VkAllocationCallbacks*, GpuImage&);
+
+	//Levels in a full chain down to 1x1
+	uint32_t MipCount(VkExtent2D);
+}
@@ -0,0 +1,225 @@
+#include "BF_GpuProfiler.h"
+#include "../Utils/BF_Error.h"
+
+//Two timestamps per scope
+static constexpr uint32_t kQueriesPerFrame = kGpuProfilerMaxScopes * 2;
+static constexpr uint32_t kNoScope = ~0u;
+
+GpuProfiler::GpuProfiler() : m_device(VK_NULL_HANDLE), m_queryPool(VK_NULL_HANDLE), m_pAllocator(nullptr),
+	m_timestampPeriod(1.0), m_timestampMask(~0ull), m_frameSlot(0), m_frameNumber(0),
+	m_recording(false), m_supported(false)
+{
+	for (auto& frame : m_frames) {
+		frame.queryCount = 0;
+		frame.frameNumber = 0;
+		frame.pending = false;
+	}
+}
+
+int GpuProfiler::init(VkPhysicalDevice physDevice, VkDevice device, uint32_t queueFamily, const VkAllocationCallbacks* pAllocator)
+{
+	m_device = device;
+	m_pAllocator = pAllocator;
+
+	//Timestamps are only valid on queues reporting valid bits
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physDevice, &queueFamilyCount, nullptr);
+
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physDevice, &queueFamilyCount, queueFamilies.data());
+
+	const uint32_t validBits = queueFamily < queueFamilyCount ? queueFamilies[queueFamily].timestampValidBits : 0;
+	if (validBits == 0) {
+		errorF("GpuProfiler - timestamps unsupported on queue family %u, GPU profiling disabled", queueFamily);
+		return 1;
+	}
+
+	m_timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physDevice, &deviceProperties);
+	m_timestampPeriod = static_cast<double>(deviceProperties.limits.timestampPeriod);
+
+	//One range of queries per frame in flight
+	VkQueryPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = kQueriesPerFrame * kGpuProfilerLatency;
+
+	VkResult res = vkCreateQueryPool(m_device, &poolInfo, m_pAllocator, &m_queryPool);
+	if (res != VK_SUCCESS) {
+		errorF("GpuProfiler - failed to create timestamp query pool! - VkResult %i", res);
+		//not vital, carry on without GPU timings
+		return 1;
+	}
+
+	m_results.resize(kQueriesPerFrame);
+	m_scopeStack.reserve(kGpuProfilerMaxScopes);
+	for (auto& frame : m_frames) {
+		frame.scopes.reserve(kGpuProfilerMaxScopes);
+	}
+
+	m_supported = true;
+
+	return 1;
+}
+
+void GpuProfiler::shutdown()
+{
+	if (m_queryPool != VK_NULL_HANDLE) {
+		vkDestroyQueryPool(m_device, m_queryPool, m_pAllocator);
+		m_queryPool = VK_NULL_HANDLE;
+	}
+
+	m_supported = false;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer cmd)
+{
+	if (!m_supported) return;
+
+	Frame& frame = m_frames[m_frameSlot];
+
+	//Slot is about to be reused - last chance to read it
+	if (frame.pending) {
+		readFrame(frame, m_frameSlot);
+
+		if (frame.pending) {
+			debugF("GpuProfiler - frame %llu results not ready, dropped\n", static_cast<unsigned long long>(frame.frameNumber));
+			frame.pending = false;
+		}
+	}
+
+	vkCmdResetQueryPool(cmd, m_queryPool, m_frameSlot * kQueriesPerFrame, kQueriesPerFrame);
+
+	frame.scopes.clear();
+	frame.queryCount = 0;
+	frame.frameNumber = m_frameNumber;
+
+	m_scopeStack.clear();
+	m_recording = true;
+}
+
+void GpuProfiler::endFrame()
+{
+	if (!m_supported || !m_recording) return;
+
+	if (!m_scopeStack.empty()) {
+		errorF("GpuProfiler - %u scope(s) left open at end of frame", static_cast<uint32_t>(m_scopeStack.size()));
+	}
+
+	Frame& frame = m_frames[m_frameSlot];
+	frame.pending = frame.queryCount > 0;
+
+	m_frameSlot = (m_frameSlot + 1) % kGpuProfilerLatency;
+	m_frameNumber++;
+	m_recording = false;
+}
+
+void GpuProfiler::beginScope(VkCommandBuffer cmd, const char* name)
+{
+	if (!m_supported || !m_recording) return;
+
+	Frame& frame = m_frames[m_frameSlot];
+
+	//Out of queries - still push so endScope stays balanced
+	if (frame.queryCount + 2 > kQueriesPerFrame) {
+		m_scopeStack.push_back(kNoScope);
+		return;
+	}
+
+	//Reserve both queries now so the end is guaranteed a slot
+	Scope scope;
+	scope.name = name;
+	scope.depth = static_cast<uint32_t>(m_scopeStack.size());
+	scope.beginQuery = frame.queryCount;
+	scope.endQuery = frame.queryCount + 1;
+	frame.queryCount += 2;
+
+	vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, m_frameSlot * kQueriesPerFrame + scope.beginQuery);
+
+	m_scopeStack.push_back(static_cast<uint32_t>(frame.scopes.size()));
+	frame.scopes.push_back(scope);
+}
+
+void GpuProfiler::endScope(VkCommandBuffer cmd)
+{
+	if (!m_supported || !m_recording || m_scopeStack.empty()) return;
+
+	const uint32_t index = m_scopeStack.back();
+	m_scopeStack.pop_back();
+
+	if (index == kNoScope) return;
+
+	const Scope& scope = m_frames[m_frameSlot].scopes[index];
+	vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, m_frameSlot * kQueriesPerFrame + scope.endQuery);
+}
+
+void GpuProfiler::collect()
+{
+	if (!m_supported) return;
+
+	for (uint32_t slot = 0; slot < kGpuProfilerLatency; slot++) {
+		Frame& frame = m_frames[slot];
+
+		//Only read frames old enough to have been submitted - the host could
+		//otherwise see availability left over from before the pending reset
+		if (frame.pending && m_frameNumber - frame.frameNumber >= kGpuProfilerLatency - 1) {
+			readFrame(frame, slot);
+		}
+	}
+}
+
+void GpuProfiler::readFrame(Frame& frame, uint32_t frameSlot)
+{
+	//No WAIT bit - VK_NOT_READY just means try again next frame
+	VkResult res = vkGetQueryPoolResults(m_device, m_queryPool, frameSlot * kQueriesPerFrame, frame.queryCount,
+		frame.queryCount * sizeof(uint64_t), m_results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+	if (res != VK_SUCCESS) return;
+
+	for (const auto& scope : frame.scopes) {
+		const uint64_t ticks = (m_results[scope.endQuery] - m_results[scope.beginQuery]) & m_timestampMask;
+		const double ms = static_cast<double>(ticks) * m_timestampPeriod / 1000000.0;
+
+		auto it = m_stats.find(scope.name);
+		if (it == m_stats.end()) {
+			it = m_stats.emplace(scope.name, ScopeStats{ SampleWindow(), scope.depth }).first;
+			m_statOrder.push_back(scope.name);
+		}
+
+		it->second.samples.add(ms);
+	}
+
+	frame.pending = false;
+}
+
+TimingStats GpuProfiler::getStats(const std::string& name) const
+{
+	auto it = m_stats.find(name);
+	if (it == m_stats.end()) {
+		return TimingStats{};
+	}
+
+	return it->second.samples.compute();
+}
+
+void GpuProfiler::report() const
+{
+	if (!m_supported) return;
+
+	debugF("GPU timings (ms):\n");
+
+	for (const auto& name : m_statOrder) {
+		const ScopeStats& scopeStats = m_stats.at(name);
+		const TimingStats stats = scopeStats.samples.compute();
+
+		debugF("%*s%-24s avg %7.3f  min %7.3f  max %7.3f  p50 %7.3f  p95 %7.3f  p99 %7.3f\n",
+			scopeStats.depth * 2, "", name.c_str(), stats.avg, stats.min, stats.max, stats.p50, stats.p95, stats.p99);
+	}
+}
+
+const bool GpuProfiler::isSupported() const
+{
+	return m_supported;
+}
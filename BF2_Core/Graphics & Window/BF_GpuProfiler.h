@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include "../Utils/BF_Stats.h"
+
+//Frames of latency before results are read back - the GPU has long finished
+//with them by then, so vkGetQueryPoolResults never stalls
+constexpr uint32_t kGpuProfilerLatency = 3;
+constexpr uint32_t kGpuProfilerMaxScopes = 64;
+
+class GpuProfiler {
+public:
+	GpuProfiler();
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	int init(VkPhysicalDevice, VkDevice, uint32_t queueFamily, const VkAllocationCallbacks* pAllocator = nullptr);
+	void shutdown();
+
+	//Bracket all scopes recorded for a frame
+	void beginFrame(VkCommandBuffer);
+	void endFrame();
+
+	//Scopes nest - name must outlive the profiler (string literals)
+	void beginScope(VkCommandBuffer, const char* name);
+	void endScope(VkCommandBuffer);
+
+	//Read back any frames the GPU has finished, never waits
+	void collect();
+
+	TimingStats getStats(const std::string& name) const;
+	void report() const;
+
+	const bool isSupported() const;
+
+private:
+	struct Scope {
+		const char* name;
+		uint32_t depth;
+		uint32_t beginQuery;
+		uint32_t endQuery;
+	};
+
+	struct ScopeStats {
+		SampleWindow samples;
+		uint32_t depth;
+	};
+
+	struct Frame {
+		std::vector<Scope> scopes;
+		uint32_t queryCount;
+		uint64_t frameNumber;
+		bool pending;
+	};
+
+	void readFrame(Frame&, uint32_t frameSlot);
+
+	VkDevice		m_device;
+	VkQueryPool		m_queryPool;
+	const VkAllocationCallbacks* m_pAllocator;
+
+	//ns per tick and mask for the valid timestamp bits
+	double			m_timestampPeriod;
+	uint64_t		m_timestampMask;
+
+	Frame			m_frames[kGpuProfilerLatency];
+	uint32_t		m_frameSlot;
+	uint64_t		m_frameNumber;
+	bool			m_recording;
+
+	std::vector<uint32_t> m_scopeStack;
+	std::vector<uint64_t> m_results;
+
+	//per scope name, milliseconds - order kept for reporting
+	std::unordered_map<std::string, ScopeStats> m_stats;
+	std::vector<std::string> m_statOrder;
+
+	bool m_supported;
+};
+
+//RAII helper for a profiled block
+class GpuScope {
+public:
+	GpuScope(GpuProfiler& profiler, VkCommandBuffer cmd, const char* name) : m_profiler(profiler), m_cmd(cmd)
+	{
+		m_profiler.beginScope(m_cmd, name);
+	}
+
+	~GpuScope()
+	{
+		m_profiler.endScope(m_cmd);
+	}
+
+	GpuScope(const GpuScope&) = delete;
+	GpuScope& operator=(const GpuScope&) = delete;
+
+private:
+	GpuProfiler& m_profiler;
+	VkCommandBuffer m_cmd;
+};
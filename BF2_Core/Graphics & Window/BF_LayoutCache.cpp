@@ -0,0 +1,139 @@
+#include "BF_LayoutCache.h"
+#include "../Utils/BF_Error.h"
+
+LayoutCache::LayoutCache() : m_device(VK_NULL_HANDLE), m_pAllocator(nullptr)
+{
+}
+
+LayoutCache::~LayoutCache()
+{
+	shutdown();
+}
+
+void LayoutCache::init(VkDevice device, const VkAllocationCallbacks* pAllocator)
+{
+	m_device = device;
+	m_pAllocator = pAllocator;
+}
+
+void LayoutCache::shutdown()
+{
+	//pipeline layouts first, they reference the set layouts
+	for (auto& layout : m_pipelineLayouts) {
+		vkDestroyPipelineLayout(m_device, layout.second, m_pAllocator);
+	}
+	m_pipelineLayouts.clear();
+
+	for (auto& layout : m_setLayouts) {
+		vkDestroyDescriptorSetLayout(m_device, layout.second, m_pAllocator);
+	}
+	m_setLayouts.clear();
+}
+
+VkDescriptorSetLayout LayoutCache::getSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+	Key key;
+	key.reserve(bindings.size() * 2);
+	for (const auto& binding : bindings) {
+		//Immutable samplers are part of the layout's identity
+		key.push_back((static_cast<uint64_t>(binding.binding) << 32) | static_cast<uint32_t>(binding.descriptorType));
+		key.push_back((static_cast<uint64_t>(binding.descriptorCount) << 32) | binding.stageFlags);
+		if (binding.pImmutableSamplers) {
+			for (uint32_t i = 0; i < binding.descriptorCount; i++) {
+				key.push_back(reinterpret_cast<uint64_t>(binding.pImmutableSamplers[i]));
+			}
+		}
+	}
+
+	auto it = m_setLayouts.find(key);
+	if (it != m_setLayouts.end()) {
+		return it->second;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	VkDescriptorSetLayout layout;
+	if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, m_pAllocator, &layout) != VK_SUCCESS) {
+		panicF("failed to create descriptor set layout!");
+		return VK_NULL_HANDLE;
+	}
+
+	m_setLayouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+VkPipelineLayout LayoutCache::getPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstants)
+{
+	Key key;
+	key.reserve(setLayouts.size() + pushConstants.size() * 2 + 1);
+	key.push_back(setLayouts.size());
+	for (VkDescriptorSetLayout layout : setLayouts) {
+		key.push_back(reinterpret_cast<uint64_t>(layout));
+	}
+	for (const auto& range : pushConstants) {
+		key.push_back((static_cast<uint64_t>(range.offset) << 32) | range.size);
+		key.push_back(range.stageFlags);
+	}
+
+	auto it = m_pipelineLayouts.find(key);
+	if (it != m_pipelineLayouts.end()) {
+		return it->second;
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstants.size());
+	pipelineLayoutInfo.pPushConstantRanges = pushConstants.data();
+
+	VkPipelineLayout layout;
+	if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, m_pAllocator, &layout) != VK_SUCCESS) {
+		panicF("failed to create pipeline layout!");
+		return VK_NULL_HANDLE;
+	}
+
+	m_pipelineLayouts.emplace(std::move(key), layout);
+	return layout;
+}
+
+VkPipelineLayout LayoutCache::getPipelineLayout(const PipelineLayoutDesc& desc, std::vector<VkDescriptorSetLayout>* setLayouts)
+{
+	std::vector<VkDescriptorSetLayout> layouts;
+	layouts.reserve(desc.sets.size());
+	for (const auto& set : desc.sets) {
+		layouts.push_back(getSetLayout(set));
+	}
+
+	VkPipelineLayout layout = getPipelineLayout(layouts, desc.pushConstants);
+
+	if (setLayouts) {
+		*setLayouts = std::move(layouts);
+	}
+
+	return layout;
+}
+
+const size_t LayoutCache::getSetLayoutCount() const
+{
+	return m_setLayouts.size();
+}
+
+const size_t LayoutCache::getPipelineLayoutCount() const
+{
+	return m_pipelineLayouts.size();
+}
+
+size_t LayoutCache::KeyHash::operator()(const Key& key) const
+{
+	//FNV-1a over the words
+	uint64_t hash = 14695981039346656037ull;
+	for (uint64_t word : key) {
+		hash ^= word;
+		hash *= 1099511628211ull;
+	}
+	return static_cast<size_t>(hash);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "BF_ShaderReflection.h"
+
+//Shares descriptor set layouts and pipeline layouts between pipelines - equal
+//descriptions come back as the same handle, so pipelines built from shaders
+//with the same interface end up with one layout between them.
+//Everything handed out lives until shutdown().
+class LayoutCache {
+public:
+	LayoutCache();
+	LayoutCache(const LayoutCache&) = delete;
+	LayoutCache& operator=(const LayoutCache&) = delete;
+
+	~LayoutCache();
+
+	void init(VkDevice, const VkAllocationCallbacks*);
+	void shutdown();
+
+	VkDescriptorSetLayout getSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+	VkPipelineLayout getPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstants);
+
+	//Set layouts for every set in desc (empty sets included), then the pipeline layout.
+	//setLayouts receives the set layouts, for allocating descriptor sets against.
+	VkPipelineLayout getPipelineLayout(const PipelineLayoutDesc& desc, std::vector<VkDescriptorSetLayout>* setLayouts = nullptr);
+
+	const size_t getSetLayoutCount() const;
+	const size_t getPipelineLayoutCount() const;
+
+private:
+	using Key = std::vector<uint64_t>;
+
+	struct KeyHash {
+		size_t operator()(const Key&) const;
+	};
+
+	VkDevice						m_device;
+	const VkAllocationCallbacks*	m_pAllocator;
+
+	std::unordered_map<Key, VkDescriptorSetLayout, KeyHash> m_setLayouts;
+	std::unordered_map<Key, VkPipelineLayout, KeyHash> m_pipelineLayouts;
+};
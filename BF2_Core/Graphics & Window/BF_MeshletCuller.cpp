@@ -0,0 +1,266 @@
+#include "BF_MeshletCuller.h"
+#include "BF_LayoutCache.h"
+#include "BF_ShaderLibrary.h"
+#include "../Utils/BF_Error.h"
+
+#include <cstddef>
+
+//Must match local_size_x in meshlet_cull.comp
+static constexpr uint32_t kCullGroupSize = 64;
+//Push constant bytes - up to meshletCount, without any padding after it
+static constexpr uint32_t kCullViewSize = offsetof(CullView, meshletCount) + sizeof(uint32_t);
+
+MeshletCuller::MeshletCuller() : m_physDevice(VK_NULL_HANDLE), m_device(VK_NULL_HANDLE), m_pAllocator(nullptr),
+	m_shaders(nullptr), m_layouts(nullptr), m_pipeline(VK_NULL_HANDLE), m_pipelineLayout(VK_NULL_HANDLE),
+	m_setLayout(VK_NULL_HANDLE), m_descriptorPool(VK_NULL_HANDLE), m_descriptorSet(VK_NULL_HANDLE),
+	m_dependency(0), m_multiDrawIndirect(false), m_meshlets(), m_draws(), m_meshletCount(0)
+{
+}
+
+int MeshletCuller::init(VkPhysicalDevice physDevice, VkDevice device, const VkAllocationCallbacks* pAllocator, ShaderLibrary& shaders, LayoutCache& layouts)
+{
+	m_physDevice = physDevice;
+	m_device = device;
+	m_pAllocator = pAllocator;
+	m_shaders = &shaders;
+	m_layouts = &layouts;
+
+	//Graphics enables it whenever the device has it
+	VkPhysicalDeviceFeatures features;
+	vkGetPhysicalDeviceFeatures(m_physDevice, &features);
+	m_multiDrawIndirect = features.multiDrawIndirect == VK_TRUE;
+
+	if (!createPipeline()) return 0;
+
+	m_dependency = m_shaders->addDependency({ "meshlet_cull.spv" }, [this]() {
+		vkDestroyPipeline(m_device, m_pipeline, m_pAllocator);
+		m_pipeline = VK_NULL_HANDLE;
+		createPipeline();
+	});
+
+	return 1;
+}
+
+void MeshletCuller::shutdown()
+{
+	if (m_shaders != nullptr) {
+		m_shaders->removeDependency(m_dependency);
+		m_shaders = nullptr;
+	}
+
+	gpu::DestroyBuffer(m_device, m_pAllocator, m_meshlets);
+	gpu::DestroyBuffer(m_device, m_pAllocator, m_draws);
+	m_meshletCount = 0;
+
+	if (m_descriptorPool != VK_NULL_HANDLE) {
+		vkDestroyDescriptorPool(m_device, m_descriptorPool, m_pAllocator);
+		m_descriptorPool = VK_NULL_HANDLE;
+		m_descriptorSet = VK_NULL_HANDLE;
+	}
+
+	if (m_pipeline != VK_NULL_HANDLE) {
+		vkDestroyPipeline(m_device, m_pipeline, m_pAllocator);
+		m_pipeline = VK_NULL_HANDLE;
+	}
+}
+
+int MeshletCuller::createPipeline()
+{
+	VkShaderModule module = m_shaders->loadOptional("meshlet_cull.spv", "meshlet_cull.comp");
+	const ShaderReflection* reflection = m_shaders->getReflection("meshlet_cull.spv");
+	if (module == VK_NULL_HANDLE || reflection == nullptr) {
+		errorF("MeshletCuller - cull shader failed to load, meshlets will not be culled");
+		return 0;
+	}
+
+	const PipelineLayoutDesc desc = shader::MergeLayouts({ reflection });
+	if (desc.sets.empty()) {
+		errorF("MeshletCuller - cull shader declares no descriptor sets!");
+		return 0;
+	}
+
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	m_pipelineLayout = m_layouts->getPipelineLayout(desc, &setLayouts);
+
+	//A reload that changed the shader's interface needs a new set to match
+	if (setLayouts[0] != m_setLayout) {
+		m_setLayout = setLayouts[0];
+
+		if (m_descriptorPool != VK_NULL_HANDLE) {
+			vkDestroyDescriptorPool(m_device, m_descriptorPool, m_pAllocator);
+		}
+
+		VkDescriptorPoolSize poolSize = {};
+		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSize.descriptorCount = 2;
+
+		VkDescriptorPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.maxSets = 1;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+
+		VkResult res = vkCreateDescriptorPool(m_device, &poolInfo, m_pAllocator, &m_descriptorPool);
+		if (res != VK_SUCCESS) {
+			errorF("MeshletCuller - failed to create descriptor pool! - VkResult %i", res);
+			m_descriptorPool = VK_NULL_HANDLE;
+			return 0;
+		}
+
+		VkDescriptorSetAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &m_setLayout;
+
+		res = vkAllocateDescriptorSets(m_device, &allocInfo, &m_descriptorSet);
+		if (res != VK_SUCCESS) {
+			errorF("MeshletCuller - failed to allocate descriptor set! - VkResult %i", res);
+			return 0;
+		}
+
+		writeDescriptors();
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = module;
+	pipelineInfo.stage.pName = reflection->entryPoint.c_str();
+	pipelineInfo.layout = m_pipelineLayout;
+
+	VkResult res = vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, m_pAllocator, &m_pipeline);
+	if (res != VK_SUCCESS) {
+		errorF("MeshletCuller - failed to create cull pipeline! - VkResult %i", res);
+		m_pipeline = VK_NULL_HANDLE;
+		return 0;
+	}
+
+	return 1;
+}
+
+void MeshletCuller::writeDescriptors()
+{
+	if (m_descriptorSet == VK_NULL_HANDLE || m_meshlets.buffer == VK_NULL_HANDLE) return;
+
+	VkDescriptorBufferInfo bufferInfos[2] = {};
+	bufferInfos[0].buffer = m_meshlets.buffer;
+	bufferInfos[0].range = VK_WHOLE_SIZE;
+	bufferInfos[1].buffer = m_draws.buffer;
+	bufferInfos[1].range = VK_WHOLE_SIZE;
+
+	VkWriteDescriptorSet writes[2] = {};
+	for (uint32_t i = 0; i < 2; i++) {
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = m_descriptorSet;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+
+	vkUpdateDescriptorSets(m_device, 2, writes, 0, nullptr);
+}
+
+int MeshletCuller::upload(const std::vector<Meshlet>& meshlets, int32_t vertexOffset)
+{
+	gpu::DestroyBuffer(m_device, m_pAllocator, m_meshlets);
+	gpu::DestroyBuffer(m_device, m_pAllocator, m_draws);
+	m_meshletCount = 0;
+
+	if (meshlets.empty()) return 1;
+
+	//Host visible for now - written once, read by one dispatch a frame
+	const VkMemoryPropertyFlags hostMemory = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+	if (!gpu::CreateBuffer(m_physDevice, m_device, m_pAllocator, sizeof(GpuMeshlet) * meshlets.size(),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostMemory, m_meshlets)) return 0;
+
+	if (!gpu::CreateBuffer(m_physDevice, m_device, m_pAllocator, sizeof(VkDrawIndexedIndirectCommand) * meshlets.size(),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_draws)) {
+		gpu::DestroyBuffer(m_device, m_pAllocator, m_meshlets);
+		return 0;
+	}
+
+	GpuMeshlet* out = static_cast<GpuMeshlet*>(m_meshlets.mapped);
+	for (const auto& meshlet : meshlets) {
+		const MeshletBounds& b = meshlet.bounds;
+		out->sphere = glm::vec4(b.centre, b.radius);
+		out->coneApex = glm::vec4(b.coneApex, 0.0f);
+		out->cone = glm::vec4(b.coneAxis, b.coneCutoff);
+		out->draw[0] = meshlet.firstIndex;
+		out->draw[1] = meshlet.indexCount;
+		out->draw[2] = static_cast<uint32_t>(vertexOffset);
+		out->draw[3] = 0;
+		out++;
+	}
+
+	m_meshletCount = static_cast<uint32_t>(meshlets.size());
+	writeDescriptors();
+
+	return 1;
+}
+
+void MeshletCuller::cull(VkCommandBuffer cmd, const CullView& view)
+{
+	if (m_pipeline == VK_NULL_HANDLE || m_meshletCount == 0) return;
+
+	CullView push = view;
+	push.meshletCount = m_meshletCount;
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
+	vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, kCullViewSize, &push);
+	vkCmdDispatch(cmd, (m_meshletCount + kCullGroupSize - 1) / kCullGroupSize, 1, 1);
+
+	//Draw commands written before the indirect draws read them
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = m_draws.buffer;
+	barrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+		0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void MeshletCuller::draw(VkCommandBuffer cmd)
+{
+	if (m_meshletCount == 0) return;
+
+	//Culled meshlets cost a command processor lookup, not any vertex work
+	gpu::CmdDrawIndexedIndirect(cmd, m_draws, m_meshletCount, m_multiDrawIndirect);
+}
+
+CullView MeshletCuller::MakeView(const glm::mat4& viewProjModel, const glm::mat4& model, const glm::vec3& cameraPos)
+{
+	CullView view = {};
+
+	//Gribb-Hartmann - rows of the clip matrix added to or taken from the w row.
+	//Near uses w + z, which is looser than Vulkan's 0..1 depth needs but never wrong.
+	const glm::mat4 m = glm::transpose(viewProjModel);
+	view.planes[0] = m[3] + m[0];
+	view.planes[1] = m[3] - m[0];
+	view.planes[2] = m[3] + m[1];
+	view.planes[3] = m[3] - m[1];
+	view.planes[4] = m[3] + m[2];
+	view.planes[5] = m[3] - m[2];
+
+	for (auto& plane : view.planes) {
+		const float length = glm::length(glm::vec3(plane));
+		if (length > 0.0f) plane /= length;
+	}
+
+	view.cameraPos = glm::inverse(model) * glm::vec4(cameraPos, 1.0f);
+
+	return view;
+}
+
+const uint32_t MeshletCuller::getMeshletCount() const
+{
+	return m_meshletCount;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#define GLM_FORCE_CTOR_INIT
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "BF_GpuBuffer.h"
+#include "../Utils/BF_Meshlet.h"
+
+class ShaderLibrary;
+class LayoutCache;
+
+//What the cull pass tests against, in the mesh's space
+struct CullView {
+	glm::vec4 planes[6];	//normalized, facing inwards
+	glm::vec4 cameraPos;
+	uint32_t meshletCount;	//filled in by cull()
+};
+
+//Frustum and normal cone culling of one mesh's meshlets on the GPU. A compute
+//pass writes an indexed indirect draw per meshlet, with no instances for the
+//ones culled, so draw() needs no readback and no draw count extension.
+class MeshletCuller {
+public:
+	MeshletCuller();
+	MeshletCuller(const MeshletCuller&) = delete;
+	MeshletCuller& operator=(const MeshletCuller&) = delete;
+
+	int init(VkPhysicalDevice, VkDevice, const VkAllocationCallbacks*, ShaderLibrary&, LayoutCache&);
+	void shutdown();
+
+	//Replaces the meshlet list - the device must not be using the previous one.
+	//vertexOffset is added to every index, as for vkCmdDrawIndexed.
+	int upload(const std::vector<Meshlet>&, int32_t vertexOffset = 0);
+
+	//Outside a render pass, before draw() - ends with the barrier draw() needs
+	void cull(VkCommandBuffer, const CullView&);
+
+	//Index and vertex buffers and the graphics pipeline must already be bound
+	void draw(VkCommandBuffer);
+
+	//view is the camera's viewProj * model, cameraPos in world space
+	static CullView MakeView(const glm::mat4& viewProjModel, const glm::mat4& model, const glm::vec3& cameraPos);
+
+	const uint32_t getMeshletCount() const;
+
+private:
+	//Matches MeshletCull in meshlet_cull.comp
+	struct GpuMeshlet {
+		glm::vec4 sphere;
+		glm::vec4 coneApex;
+		glm::vec4 cone;
+		uint32_t draw[4];
+	};
+
+	int createPipeline();
+	void writeDescriptors();
+
+	VkPhysicalDevice				m_physDevice;
+	VkDevice						m_device;
+	const VkAllocationCallbacks*	m_pAllocator;
+	ShaderLibrary*					m_shaders;
+	LayoutCache*					m_layouts;
+
+	VkPipeline			m_pipeline;
+	VkPipelineLayout	m_pipelineLayout;		//owned by m_layouts
+	VkDescriptorSetLayout m_setLayout;			//owned by m_layouts
+	VkDescriptorPool	m_descriptorPool;
+	VkDescriptorSet		m_descriptorSet;
+	uint32_t			m_dependency;
+	bool				m_multiDrawIndirect;
+
+	GpuBuffer			m_meshlets;
+	GpuBuffer			m_draws;
+	uint32_t			m_meshletCount;
+};
@@ -0,0 +1,315 @@
+#include "BF_OcclusionCuller.h"
+#include "BF_DepthPyramid.h"
+#include "BF_LayoutCache.h"
+#include "BF_ShaderLibrary.h"
+#include "BF_ShaderPermutation.h"
+#include "../Utils/BF_Error.h"
+
+#include <cstddef>
+#include <cstring>
+
+//Must match local_size_x and the constant_id of kLatePass in occlusion_cull.comp
+static constexpr uint32_t kCullGroupSize = 64;
+static constexpr uint32_t kLatePassId = 0;
+
+OcclusionCuller::OcclusionCuller() : m_physDevice(VK_NULL_HANDLE), m_device(VK_NULL_HANDLE), m_pAllocator(nullptr),
+	m_shaders(nullptr), m_layouts(nullptr), m_pipelines{ VK_NULL_HANDLE, VK_NULL_HANDLE }, m_pipelineLayout(VK_NULL_HANDLE),
+	m_setLayout(VK_NULL_HANDLE), m_descriptorPool(VK_NULL_HANDLE), m_descriptorSets{ VK_NULL_HANDLE, VK_NULL_HANDLE },
+	m_dependency(0), m_multiDrawIndirect(false), m_pyramidView(VK_NULL_HANDLE), m_pyramidSampler(VK_NULL_HANDLE),
+	m_pyramidExtent({ 0, 0 }), m_instances(), m_visibility(), m_draws(), m_instanceCount(0)
+{
+}
+
+int OcclusionCuller::init(VkPhysicalDevice physDevice, VkDevice device, const VkAllocationCallbacks* pAllocator, ShaderLibrary& shaders, LayoutCache& layouts)
+{
+	m_physDevice = physDevice;
+	m_device = device;
+	m_pAllocator = pAllocator;
+	m_shaders = &shaders;
+	m_layouts = &layouts;
+
+	//Graphics enables it whenever the device has it
+	VkPhysicalDeviceFeatures features;
+	vkGetPhysicalDeviceFeatures(m_physDevice, &features);
+	m_multiDrawIndirect = features.multiDrawIndirect == VK_TRUE;
+
+	if (!createPipelines()) return 0;
+
+	m_dependency = m_shaders->addDependency({ "occlusion_cull.spv" }, [this]() {
+		for (auto& pipeline : m_pipelines) {
+			vkDestroyPipeline(m_device, pipeline, m_pAllocator);
+			pipeline = VK_NULL_HANDLE;
+		}
+
+		const VkDescriptorSetLayout previous = m_setLayout;
+		if (createPipelines() && m_setLayout != previous) {
+			createDescriptorSets();
+		}
+	});
+
+	return createDescriptorSets();
+}
+
+void OcclusionCuller::shutdown()
+{
+	if (m_shaders != nullptr) {
+		m_shaders->removeDependency(m_dependency);
+		m_shaders = nullptr;
+	}
+
+	gpu::DestroyBuffer(m_device, m_pAllocator, m_instances);
+	gpu::DestroyBuffer(m_device, m_pAllocator, m_visibility);
+	for (auto& draws : m_draws) {
+		gpu::DestroyBuffer(m_device, m_pAllocator, draws);
+	}
+	m_instanceCount = 0;
+
+	if (m_descriptorPool != VK_NULL_HANDLE) {
+		vkDestroyDescriptorPool(m_device, m_descriptorPool, m_pAllocator);
+		m_descriptorPool = VK_NULL_HANDLE;
+	}
+
+	for (auto& pipeline : m_pipelines) {
+		if (pipeline != VK_NULL_HANDLE) {
+			vkDestroyPipeline(m_device, pipeline, m_pAllocator);
+			pipeline = VK_NULL_HANDLE;
+		}
+	}
+}
+
+int OcclusionCuller::createPipelines()
+{
+	VkShaderModule module = m_shaders->loadOptional("occlusion_cull.spv", "occlusion_cull.comp");
+	const ShaderReflection* reflection = m_shaders->getReflection("occlusion_cull.spv");
+	if (module == VK_NULL_HANDLE || reflection == nullptr) {
+		errorF("OcclusionCuller - cull shader failed to load, instances will not be culled");
+		return 0;
+	}
+
+	const PipelineLayoutDesc desc = shader::MergeLayouts({ reflection });
+	if (desc.sets.empty()) {
+		errorF("OcclusionCuller - cull shader declares no descriptor sets!");
+		return 0;
+	}
+
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	m_pipelineLayout = m_layouts->getPipelineLayout(desc, &setLayouts);
+	m_setLayout = setLayouts[0];
+
+	for (uint32_t phase = 0; phase < kPhaseCount; phase++) {
+		Specialization specialization;
+		specialization.set(kLatePassId, phase == kLate);
+
+		VkComputePipelineCreateInfo pipelineInfo = {};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = module;
+		pipelineInfo.stage.pName = reflection->entryPoint.c_str();
+		pipelineInfo.stage.pSpecializationInfo = specialization.getInfo();
+		pipelineInfo.layout = m_pipelineLayout;
+
+		VkResult res = vkCreateComputePipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, m_pAllocator, &m_pipelines[phase]);
+		if (res != VK_SUCCESS) {
+			errorF("OcclusionCuller - failed to create cull pipeline! - VkResult %i", res);
+			m_pipelines[phase] = VK_NULL_HANDLE;
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+int OcclusionCuller::createDescriptorSets()
+{
+	if (m_descriptorPool != VK_NULL_HANDLE) {
+		vkDestroyDescriptorPool(m_device, m_descriptorPool, m_pAllocator);
+		m_descriptorPool = VK_NULL_HANDLE;
+	}
+
+	VkDescriptorPoolSize poolSizes[2] = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[0].descriptorCount = 3 * kPhaseCount;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[1].descriptorCount = kPhaseCount;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = kPhaseCount;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+
+	VkResult res = vkCreateDescriptorPool(m_device, &poolInfo, m_pAllocator, &m_descriptorPool);
+	if (res != VK_SUCCESS) {
+		errorF("OcclusionCuller - failed to create descriptor pool! - VkResult %i", res);
+		m_descriptorPool = VK_NULL_HANDLE;
+		return 0;
+	}
+
+	const VkDescriptorSetLayout setLayouts[kPhaseCount] = { m_setLayout, m_setLayout };
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = m_descriptorPool;
+	allocInfo.descriptorSetCount = kPhaseCount;
+	allocInfo.pSetLayouts = setLayouts;
+
+	res = vkAllocateDescriptorSets(m_device, &allocInfo, m_descriptorSets);
+	if (res != VK_SUCCESS) {
+		errorF("OcclusionCuller - failed to allocate descriptor sets! - VkResult %i", res);
+		return 0;
+	}
+
+	writeDescriptors();
+
+	return 1;
+}
+
+void OcclusionCuller::writeDescriptors()
+{
+	//Both phases bind the pyramid - the early one never reads it, but the module declares it
+	if (m_descriptorPool == VK_NULL_HANDLE || m_instances.buffer == VK_NULL_HANDLE || m_pyramidView == VK_NULL_HANDLE) return;
+
+	for (uint32_t phase = 0; phase < kPhaseCount; phase++) {
+		VkDescriptorBufferInfo buffers[3] = {};
+		buffers[0] = { m_instances.buffer, 0, VK_WHOLE_SIZE };
+		buffers[1] = { m_visibility.buffer, 0, VK_WHOLE_SIZE };
+		buffers[2] = { m_draws[phase].buffer, 0, VK_WHOLE_SIZE };
+
+		VkDescriptorImageInfo pyramid = {};
+		pyramid.sampler = m_pyramidSampler;
+		pyramid.imageView = m_pyramidView;
+		pyramid.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		VkWriteDescriptorSet writes[4] = {};
+		for (uint32_t i = 0; i < 4; i++) {
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = m_descriptorSets[phase];
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = i < 3 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writes[i].pBufferInfo = i < 3 ? &buffers[i] : nullptr;
+			writes[i].pImageInfo = i < 3 ? nullptr : &pyramid;
+		}
+
+		vkUpdateDescriptorSets(m_device, 4, writes, 0, nullptr);
+	}
+}
+
+int OcclusionCuller::upload(const std::vector<CullInstance>& instances)
+{
+	gpu::DestroyBuffer(m_device, m_pAllocator, m_instances);
+	gpu::DestroyBuffer(m_device, m_pAllocator, m_visibility);
+	for (auto& draws : m_draws) {
+		gpu::DestroyBuffer(m_device, m_pAllocator, draws);
+	}
+	m_instanceCount = 0;
+
+	if (instances.empty()) return 1;
+
+	//Host visible for now - no staging path yet
+	const VkMemoryPropertyFlags hostMemory = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	const VkDeviceSize drawSize = sizeof(VkDrawIndexedIndirectCommand) * instances.size();
+
+	int ok = gpu::CreateBuffer(m_physDevice, m_device, m_pAllocator, sizeof(CullInstance) * instances.size(),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostMemory, m_instances);
+	ok = ok && gpu::CreateBuffer(m_physDevice, m_device, m_pAllocator, sizeof(uint32_t) * instances.size(),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostMemory, m_visibility);
+	for (auto& draws : m_draws) {
+		ok = ok && gpu::CreateBuffer(m_physDevice, m_device, m_pAllocator, drawSize,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, draws);
+	}
+
+	if (!ok) {
+		gpu::DestroyBuffer(m_device, m_pAllocator, m_instances);
+		gpu::DestroyBuffer(m_device, m_pAllocator, m_visibility);
+		for (auto& draws : m_draws) {
+			gpu::DestroyBuffer(m_device, m_pAllocator, draws);
+		}
+		return 0;
+	}
+
+	std::memcpy(m_instances.mapped, instances.data(), sizeof(CullInstance) * instances.size());
+	std::memset(m_visibility.mapped, 0, sizeof(uint32_t) * instances.size());
+
+	m_instanceCount = static_cast<uint32_t>(instances.size());
+	writeDescriptors();
+
+	return 1;
+}
+
+void OcclusionCuller::setPyramid(const DepthPyramid& pyramid)
+{
+	m_pyramidView = pyramid.getView();
+	m_pyramidSampler = pyramid.getSampler();
+	m_pyramidExtent = pyramid.getExtent();
+
+	writeDescriptors();
+}
+
+void OcclusionCuller::cullEarly(VkCommandBuffer cmd, const glm::mat4& viewProj)
+{
+	cull(cmd, viewProj, kEarly);
+}
+
+void OcclusionCuller::cullLate(VkCommandBuffer cmd, const glm::mat4& viewProj)
+{
+	cull(cmd, viewProj, kLate);
+}
+
+void OcclusionCuller::cull(VkCommandBuffer cmd, const glm::mat4& viewProj, Phase phase)
+{
+	if (m_pipelines[phase] == VK_NULL_HANDLE || m_instanceCount == 0 || m_pyramidView == VK_NULL_HANDLE) return;
+
+	//Visibility written by the previous late pass, and the draws it wrote already consumed
+	VkMemoryBarrier before = {};
+	before.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	before.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	before.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+		1, &before, 0, nullptr, 0, nullptr);
+
+	CullPush push = {};
+	push.viewProj = viewProj;
+	push.pyramidSize[0] = static_cast<float>(m_pyramidExtent.width);
+	push.pyramidSize[1] = static_cast<float>(m_pyramidExtent.height);
+	push.instanceCount = m_instanceCount;
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelines[phase]);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSets[phase], 0, nullptr);
+	//up to instanceCount, without any padding after it
+	const uint32_t pushSize = offsetof(CullPush, instanceCount) + sizeof(uint32_t);
+	vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, pushSize, &push);
+	vkCmdDispatch(cmd, (m_instanceCount + kCullGroupSize - 1) / kCullGroupSize, 1, 1);
+
+	//Draw commands written before the indirect draws read them
+	VkBufferMemoryBarrier after = {};
+	after.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	after.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	after.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+	after.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	after.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	after.buffer = m_draws[phase].buffer;
+	after.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+		0, nullptr, 1, &after, 0, nullptr);
+}
+
+void OcclusionCuller::drawEarly(VkCommandBuffer cmd)
+{
+	if (m_instanceCount == 0) return;
+	gpu::CmdDrawIndexedIndirect(cmd, m_draws[kEarly], m_instanceCount, m_multiDrawIndirect);
+}
+
+void OcclusionCuller::drawLate(VkCommandBuffer cmd)
+{
+	if (m_instanceCount == 0) return;
+	gpu::CmdDrawIndexedIndirect(cmd, m_draws[kLate], m_instanceCount, m_multiDrawIndirect);
+}
+
+const uint32_t OcclusionCuller::getInstanceCount() const
+{
+	return m_instanceCount;
+}
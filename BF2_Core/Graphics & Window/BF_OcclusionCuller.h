@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#define GLM_FORCE_CTOR_INIT
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "BF_GpuBuffer.h"
+
+class ShaderLibrary;
+class LayoutCache;
+class DepthPyramid;
+
+//One instance's bounds and the draw it makes - matches occlusion_cull.comp
+struct CullInstance {
+	glm::vec4 sphere;		//world space centre, radius
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	int32_t vertexOffset;
+	uint32_t firstInstance;
+};
+
+//Two phase GPU occlusion culling against a DepthPyramid. Each frame:
+//
+//	cullEarly()		- instances visible last frame that are in the frustum
+//	drawEarly()		- in the default render pass, clearing depth
+//	DepthPyramid::build()
+//	cullLate()		- everything, tested against the new pyramid
+//	drawLate()		- in a pass loading the early depth
+//
+//The late pass draws only what the early pass missed, and its result is next
+//frame's early set - nothing visible is ever skipped, and a static view draws
+//almost everything in the early pass.
+class OcclusionCuller {
+public:
+	OcclusionCuller();
+	OcclusionCuller(const OcclusionCuller&) = delete;
+	OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+	int init(VkPhysicalDevice, VkDevice, const VkAllocationCallbacks*, ShaderLibrary&, LayoutCache&);
+	void shutdown();
+
+	//Replaces the instance list, with nothing marked visible - the first frame
+	//draws everything in the late pass. The device must not be using the old one.
+	int upload(const std::vector<CullInstance>&);
+
+	//After every DepthPyramid::resize(), and before the first cull
+	void setPyramid(const DepthPyramid&);
+
+	//Outside a render pass - each ends with the barrier its draws need
+	void cullEarly(VkCommandBuffer, const glm::mat4& viewProj);
+	void cullLate(VkCommandBuffer, const glm::mat4& viewProj);
+
+	//Index and vertex buffers and the graphics pipeline must already be bound
+	void drawEarly(VkCommandBuffer);
+	void drawLate(VkCommandBuffer);
+
+	const uint32_t getInstanceCount() const;
+
+private:
+	enum Phase { kEarly = 0, kLate = 1, kPhaseCount = 2 };
+
+	//Matches CullView in occlusion_cull.comp
+	struct CullPush {
+		glm::mat4 viewProj;
+		float pyramidSize[2];
+		uint32_t instanceCount;
+	};
+
+	int createPipelines();
+	int createDescriptorSets();
+	void writeDescriptors();
+	void cull(VkCommandBuffer, const glm::mat4& viewProj, Phase);
+
+	VkPhysicalDevice				m_physDevice;
+	VkDevice						m_device;
+	const VkAllocationCallbacks*	m_pAllocator;
+	ShaderLibrary*					m_shaders;
+	LayoutCache*					m_layouts;
+
+	VkPipeline			m_pipelines[kPhaseCount];	//one module, specialized per phase
+	VkPipelineLayout	m_pipelineLayout;			//owned by m_layouts
+	VkDescriptorSetLayout m_setLayout;				//owned by m_layouts
+	VkDescriptorPool	m_descriptorPool;
+	VkDescriptorSet		m_descriptorSets[kPhaseCount];
+	uint32_t			m_dependency;
+	bool				m_multiDrawIndirect;
+
+	VkImageView			m_pyramidView;
+	VkSampler			m_pyramidSampler;
+	VkExtent2D			m_pyramidExtent;
+
+	GpuBuffer			m_instances;
+	GpuBuffer			m_visibility;
+	GpuBuffer			m_draws[kPhaseCount];
+	uint32_t			m_instanceCount;
+};
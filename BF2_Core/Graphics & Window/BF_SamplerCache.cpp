@@ -0,0 +1,110 @@
+#include "BF_SamplerCache.h"
+#include "../Utils/BF_Error.h"
+
+#include <algorithm>
+#include <cstring>
+
+static uint32_t FloatBits(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+SamplerCache::SamplerCache() : m_device(VK_NULL_HANDLE), m_pAllocator(nullptr), m_maxAnisotropy(1.0f), m_maxCount(0)
+{
+}
+
+SamplerCache::~SamplerCache()
+{
+	shutdown();
+}
+
+void SamplerCache::init(VkPhysicalDevice physDevice, VkDevice device, const VkAllocationCallbacks* pAllocator)
+{
+	m_device = device;
+	m_pAllocator = pAllocator;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physDevice, &properties);
+	m_maxAnisotropy = properties.limits.maxSamplerAnisotropy;
+	m_maxCount = properties.limits.maxSamplerAllocationCount;
+}
+
+void SamplerCache::shutdown()
+{
+	for (auto& sampler : m_samplers) {
+		vkDestroySampler(m_device, sampler.second, m_pAllocator);
+	}
+	m_samplers.clear();
+}
+
+VkSampler SamplerCache::get(const VkSamplerCreateInfo& info)
+{
+	//Reduction modes, YCbCr conversions... would all need to be part of the key
+	if (info.pNext) {
+		errorF("SamplerCache::get() - pNext chains aren't cached");
+		return VK_NULL_HANDLE;
+	}
+
+	VkSamplerCreateInfo samplerInfo = info;
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.maxAnisotropy = samplerInfo.anisotropyEnable ? std::min(samplerInfo.maxAnisotropy, m_maxAnisotropy) : 1.0f;
+	if (!samplerInfo.compareEnable) samplerInfo.compareOp = VK_COMPARE_OP_NEVER;
+
+	//Fields the state ignores are normalised above so they don't split the cache
+	const Key key = {
+		samplerInfo.flags,
+		static_cast<uint32_t>(samplerInfo.magFilter),
+		static_cast<uint32_t>(samplerInfo.minFilter),
+		static_cast<uint32_t>(samplerInfo.mipmapMode),
+		static_cast<uint32_t>(samplerInfo.addressModeU),
+		static_cast<uint32_t>(samplerInfo.addressModeV),
+		static_cast<uint32_t>(samplerInfo.addressModeW),
+		FloatBits(samplerInfo.mipLodBias),
+		samplerInfo.anisotropyEnable,
+		FloatBits(samplerInfo.maxAnisotropy),
+		samplerInfo.compareEnable,
+		static_cast<uint32_t>(samplerInfo.compareOp),
+		FloatBits(samplerInfo.minLod),
+		FloatBits(samplerInfo.maxLod),
+		static_cast<uint32_t>(samplerInfo.borderColor),
+		samplerInfo.unnormalizedCoordinates,
+	};
+
+	auto it = m_samplers.find(key);
+	if (it != m_samplers.end()) {
+		return it->second;
+	}
+
+	if (m_samplers.size() >= m_maxCount) {
+		errorF("SamplerCache::get() - device limit of %u samplers reached", m_maxCount);
+		return VK_NULL_HANDLE;
+	}
+
+	VkSampler sampler;
+	VkResult res = vkCreateSampler(m_device, &samplerInfo, m_pAllocator, &sampler);
+	if (res != VK_SUCCESS) {
+		errorF("SamplerCache::get() - failed to create sampler! - VkResult %i", res);
+		return VK_NULL_HANDLE;
+	}
+
+	m_samplers.emplace(key, sampler);
+	return sampler;
+}
+
+const size_t SamplerCache::getCount() const
+{
+	return m_samplers.size();
+}
+
+size_t SamplerCache::KeyHash::operator()(const Key& key) const
+{
+	//FNV-1a over the words
+	uint64_t hash = 14695981039346656037ull;
+	for (uint32_t word : key) {
+		hash ^= word;
+		hash *= 1099511628211ull;
+	}
+	return static_cast<size_t>(hash);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+
+//Shares VkSamplers between everything asking for the same state - equal
+//create infos come back as the same handle. Devices cap how many samplers can
+//exist (maxSamplerAllocationCount, as low as 4000), and one sampler per
+//texture or per pass would reach it long before the distinct states do.
+//Everything handed out lives until shutdown().
+class SamplerCache {
+public:
+	SamplerCache();
+	SamplerCache(const SamplerCache&) = delete;
+	SamplerCache& operator=(const SamplerCache&) = delete;
+
+	~SamplerCache();
+
+	void init(VkPhysicalDevice, VkDevice, const VkAllocationCallbacks*);
+	void shutdown();
+
+	//maxAnisotropy is clamped to the device's limit first, so requests past it
+	//share one sampler. No pNext chains - VK_NULL_HANDLE if given one.
+	VkSampler get(const VkSamplerCreateInfo&);
+
+	const size_t getCount() const;
+
+private:
+	//Every field of VkSamplerCreateInfo past pNext, floats by their bits
+	using Key = std::array<uint32_t, 16>;
+
+	struct KeyHash {
+		size_t operator()(const Key&) const;
+	};
+
+	VkDevice						m_device;
+	const VkAllocationCallbacks*	m_pAllocator;
+
+	float		m_maxAnisotropy;
+	uint32_t	m_maxCount;
+
+	std::unordered_map<Key, VkSampler, KeyHash> m_samplers;
+};
@@ -0,0 +1,458 @@
+#include "BF_ShaderLibrary.h"
+#include "../Utils/BF_Error.h"
+#include "../Utils/BF_Memory.h"
+#include "../Utils/BF_Profiler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+#ifdef __linux__
+	#include <sys/inotify.h>
+	#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+//How often sources are checked when there's no change notification
+static constexpr std::chrono::milliseconds kShaderPollInterval(500);
+
+namespace {
+	std::string findCompiler()
+	{
+#ifdef _WIN32
+		const char* exe = "glslangValidator.exe";
+		const char* bin = "Bin";
+#else
+		const char* exe = "glslangValidator";
+		const char* bin = "bin";
+#endif
+
+		//Prefer the SDK's copy, PATH otherwise
+		if (const char* sdk = std::getenv("VULKAN_SDK")) {
+			const fs::path path = fs::path(sdk) / bin / exe;
+
+			std::error_code ec;
+			if (fs::exists(path, ec)) {
+				return path.string();
+			}
+		}
+
+		return exe;
+	}
+
+	fs::file_time_type lastWriteTime(const std::string& path)
+	{
+		std::error_code ec;
+		const fs::file_time_type time = fs::last_write_time(path, ec);
+		return ec ? fs::file_time_type::min() : time;
+	}
+}
+
+ShaderLibrary::ShaderLibrary() : m_device(VK_NULL_HANDLE), m_pAllocator(nullptr), m_nextDependencyId(1),
+	m_hotReload(false), m_inotify(-1), m_exit(false)
+{
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+	shutdown();
+}
+
+int ShaderLibrary::init(VkDevice device, const VkAllocationCallbacks* pAllocator, const std::string& directory, const std::string& pakFile, bool hotReload)
+{
+	m_device = device;
+	m_pAllocator = pAllocator;
+	m_directory = directory;
+	m_hotReload = hotReload;
+
+	//one open for all shaders instead of a file per stage
+	if (m_pak.open(pakFile)) {
+		debugF("Loading shaders from %s\n", pakFile.c_str());
+	}
+
+	if (!m_hotReload) return 1;
+
+	m_compiler = findCompiler();
+	m_nextPoll = std::chrono::steady_clock::now() + kShaderPollInterval;
+
+#ifdef __linux__
+	//Change notifications instead of polling - non blocking, drained in update()
+	m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotify >= 0 && inotify_add_watch(m_inotify, m_directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		errorF("ShaderLibrary - can't watch %s, polling instead", m_directory.c_str());
+		close(m_inotify);
+		m_inotify = -1;
+	}
+#endif
+
+	m_exit = false;
+	m_worker = std::thread(&ShaderLibrary::compileThread, this);
+
+	return 1;
+}
+
+void ShaderLibrary::shutdown()
+{
+	if (m_worker.joinable()) {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_exit = true;
+			m_jobs.clear();
+		}
+		m_wake.notify_all();
+		m_worker.join();
+	}
+
+#ifdef __linux__
+	if (m_inotify >= 0) {
+		close(m_inotify);
+		m_inotify = -1;
+	}
+#endif
+
+	for (auto& shader : m_shaders) {
+		if (shader.second.module != VK_NULL_HANDLE) {
+			vkDestroyShaderModule(m_device, shader.second.module, m_pAllocator);
+		}
+	}
+
+	m_shaders.clear();
+	m_dependencies.clear();
+	m_results.clear();
+	m_pak.close();
+}
+
+VkShaderModule ShaderLibrary::load(const std::string& spvName, const std::string& source, const std::vector<std::string>& defines)
+{
+	return loadShader(spvName, source, defines, true);
+}
+
+VkShaderModule ShaderLibrary::loadOptional(const std::string& spvName, const std::string& source, const std::vector<std::string>& defines)
+{
+	return loadShader(spvName, source, defines, false);
+}
+
+VkShaderModule ShaderLibrary::loadShader(const std::string& spvName, const std::string& source, const std::vector<std::string>& defines, bool required)
+{
+	auto it = m_shaders.find(spvName);
+	if (it != m_shaders.end()) {
+		return it->second.module;
+	}
+
+	Shader shader = {};
+	shader.source = source;
+	shader.defines = defines;
+	shader.compiling = false;
+	shader.dirty = false;
+
+	bool preferLoose = false;
+
+	//Source edited since the SPIR-V was built (or never built) - bring it up to date first
+	if (m_hotReload && !source.empty()) {
+		const CompileJob job = makeJob(spvName, shader);
+		shader.sourceTime = lastWriteTime(job.sourcePath);
+
+		if (shader.sourceTime != fs::file_time_type::min() && lastWriteTime(job.outputPath) < shader.sourceTime) {
+			std::string log;
+			if (compile(job, log)) {
+				preferLoose = true;
+			}
+			else {
+				errorF("ShaderLibrary - %s failed to compile, using the existing SPIR-V\n%s", source.c_str(), log.c_str());
+			}
+		}
+	}
+
+	shader.module = loadModule(spvName, preferLoose, required, shader.reflection);
+
+	//Not kept, so get() and getReflection() agree it isn't loaded
+	if (shader.module == VK_NULL_HANDLE) return VK_NULL_HANDLE;
+
+	return m_shaders.emplace(spvName, std::move(shader)).first->second.module;
+}
+
+VkShaderModule ShaderLibrary::get(const std::string& spvName) const
+{
+	auto it = m_shaders.find(spvName);
+	return it != m_shaders.end() ? it->second.module : VK_NULL_HANDLE;
+}
+
+const ShaderReflection* ShaderLibrary::getReflection(const std::string& spvName) const
+{
+	auto it = m_shaders.find(spvName);
+	return it != m_shaders.end() ? &it->second.reflection : nullptr;
+}
+
+uint32_t ShaderLibrary::addDependency(const std::vector<std::string>& spvNames, RebuildCallback callback)
+{
+	const uint32_t id = m_nextDependencyId++;
+	m_dependencies.push_back({ id, spvNames, std::move(callback) });
+	return id;
+}
+
+void ShaderLibrary::removeDependency(uint32_t id)
+{
+	m_dependencies.erase(std::remove_if(m_dependencies.begin(), m_dependencies.end(),
+		[id](const Dependency& d) { return d.id == id; }), m_dependencies.end());
+}
+
+const bool ShaderLibrary::isHotReloadEnabled() const
+{
+	return m_hotReload;
+}
+
+void ShaderLibrary::update()
+{
+	if (!m_hotReload) return;
+
+	watchSources();
+
+	std::vector<CompileResult> results;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		results.swap(m_results);
+	}
+
+	if (results.empty()) return;
+
+	BF_PROFILE_ZONE("ShaderLibrary::reload");
+
+	std::unordered_set<std::string> reloaded;
+	for (const auto& result : results) {
+		auto it = m_shaders.find(result.spvName);
+		if (it == m_shaders.end()) continue;
+
+		Shader& shader = it->second;
+		shader.compiling = false;
+
+		if (!result.ok) {
+			//Keep running on the last good module
+			errorF("ShaderLibrary - %s failed to compile\n%s", shader.source.c_str(), result.log.c_str());
+		}
+		else {
+			if (shader.module != VK_NULL_HANDLE) {
+				vkDestroyShaderModule(m_device, shader.module, m_pAllocator);
+			}
+			shader.module = loadModule(result.spvName, true, true, shader.reflection);
+			reloaded.insert(result.spvName);
+
+			debugF("ShaderLibrary - reloaded %s\n", result.spvName.c_str());
+		}
+
+		if (shader.dirty) {
+			shader.dirty = false;
+			queueCompile(result.spvName);
+		}
+	}
+
+	if (reloaded.empty()) return;
+
+	//Nothing may still be using the old pipelines when they're rebuilt
+	vkDeviceWaitIdle(m_device);
+
+	//Each dependent rebuilds once, however many of its shaders changed
+	for (const auto& dependency : m_dependencies) {
+		const bool affected = std::any_of(dependency.spvNames.begin(), dependency.spvNames.end(),
+			[&reloaded](const std::string& name) { return reloaded.count(name) > 0; });
+
+		if (affected && dependency.callback) {
+			dependency.callback();
+		}
+	}
+}
+
+VkShaderModule ShaderLibrary::createModule(const char* code, size_t size, ShaderReflection& reflection)
+{
+	//Reflected here so the layouts always describe the module actually in use
+	shader::Reflect(reinterpret_cast<const uint32_t*>(code), size / sizeof(uint32_t), reflection);
+
+	//code must be 4 byte aligned - mapped files are page aligned
+	VkShaderModuleCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = size;
+	createInfo.pCode = reinterpret_cast<const uint32_t*>(code);
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(m_device, &createInfo, m_pAllocator, &shaderModule) != VK_SUCCESS) {
+		panicF("failed to create shader module!");
+	}
+
+	return shaderModule;
+}
+
+VkShaderModule ShaderLibrary::loadModule(const std::string& spvName, bool preferLoose, bool required, ShaderReflection& reflection)
+{
+	//Packed - uncompressed entries are used in place from the mapping.
+	//Skipped once a shader has been rebuilt, the pak copy is stale.
+	if (!preferLoose) {
+		if (const PakEntry* entry = m_pak.find(spvName)) {
+			if (const char* code = m_pak.view(*entry)) {
+				return createModule(code, static_cast<size_t>(entry->size), reflection);
+			}
+
+			std::vector<char> code = m_pak.readAll(spvName);
+			return createModule(code.data(), code.size(), reflection);
+		}
+	}
+
+	//Never built - Media/Shaders/compile.bat, or hot reload with a compiler, makes it from the GLSL
+	std::error_code ec;
+	if (!fs::exists(m_directory + spvName, ec)) {
+		if (required) {
+			panicF("ShaderLibrary - %s%s not built, run compile.bat there or put glslangValidator on PATH", m_directory.c_str(), spvName.c_str());
+		}
+
+		errorF("ShaderLibrary - %s%s not built, run compile.bat there or put glslangValidator on PATH", m_directory.c_str(), spvName.c_str());
+		return VK_NULL_HANDLE;
+	}
+
+	//Loose file - mapped straight from disk, no intermediate copy
+	mem::MappedFile code = mem::MapFile(m_directory + spvName);
+	return createModule(code.data(), code.size(), reflection);
+}
+
+ShaderLibrary::CompileJob ShaderLibrary::makeJob(const std::string& spvName, const Shader& shader) const
+{
+	CompileJob job;
+	job.spvName = spvName;
+	job.sourcePath = m_directory + shader.source;
+	job.outputPath = m_directory + spvName;
+	job.defines = shader.defines;
+
+	return job;
+}
+
+bool ShaderLibrary::compile(const CompileJob& job, std::string& log) const
+{
+	BF_PROFILE_ZONE("ShaderLibrary::compile");
+
+	//Build to a temporary so a failed compile never clobbers good SPIR-V
+	const std::string tempPath = job.outputPath + ".tmp";
+	const std::string logPath = job.outputPath + ".log";
+
+	std::string command = "\"" + m_compiler + "\" -V";
+	for (const auto& define : job.defines) {
+		command += " -D" + define;
+	}
+	command += " \"" + job.sourcePath + "\" -o \"" + tempPath + "\" > \"" + logPath + "\" 2>&1";
+#ifdef _WIN32
+	//cmd strips the outer quotes when the command itself starts with one
+	command = "\"" + command + "\"";
+#endif
+
+	const int result = std::system(command.c_str());
+
+	std::ifstream logFile(logPath);
+	std::stringstream logText;
+	logText << logFile.rdbuf();
+	log = logText.str();
+	logFile.close();
+
+	std::error_code ec;
+	fs::remove(logPath, ec);
+
+	if (result != 0) {
+		fs::remove(tempPath, ec);
+		return false;
+	}
+
+	fs::rename(tempPath, job.outputPath, ec);
+	if (ec) {
+		log += "failed to replace " + job.outputPath + ": " + ec.message();
+		return false;
+	}
+
+	return true;
+}
+
+void ShaderLibrary::watchSources()
+{
+#ifdef __linux__
+	if (m_inotify >= 0) {
+		alignas(inotify_event) char buffer[4096];
+
+		ssize_t length;
+		while ((length = read(m_inotify, buffer, sizeof(buffer))) > 0) {
+			for (char* p = buffer; p < buffer + length; ) {
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+				if (event->len > 0) {
+					sourceChanged(event->name);
+				}
+				p += sizeof(inotify_event) + event->len;
+			}
+		}
+
+		return;
+	}
+#endif
+
+	//No notifications - compare timestamps every so often
+	const auto now = std::chrono::steady_clock::now();
+	if (now < m_nextPoll) return;
+	m_nextPoll = now + kShaderPollInterval;
+
+	for (const auto& shader : m_shaders) {
+		if (shader.second.source.empty()) continue;
+
+		if (lastWriteTime(m_directory + shader.second.source) != shader.second.sourceTime) {
+			sourceChanged(shader.second.source);
+		}
+	}
+}
+
+void ShaderLibrary::sourceChanged(const std::string& source)
+{
+	for (auto& shader : m_shaders) {
+		if (shader.second.source != source) continue;
+
+		shader.second.sourceTime = lastWriteTime(m_directory + source);
+
+		//Editors often write more than once per save - only one compile in flight
+		if (shader.second.compiling) {
+			shader.second.dirty = true;
+			continue;
+		}
+
+		queueCompile(shader.first);
+	}
+}
+
+void ShaderLibrary::queueCompile(const std::string& spvName)
+{
+	Shader& shader = m_shaders[spvName];
+	shader.compiling = true;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(makeJob(spvName, shader));
+	}
+	m_wake.notify_one();
+}
+
+void ShaderLibrary::compileThread()
+{
+	prof::SetThreadName("Shader Compiler");
+
+	while (true) {
+		CompileJob job;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this]() { return m_exit || !m_jobs.empty(); });
+
+			if (m_exit) return;
+
+			job = std::move(m_jobs.front());
+			m_jobs.pop_front();
+		}
+
+		CompileResult result;
+		result.spvName = job.spvName;
+		result.ok = compile(job, result.log);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_results.push_back(std::move(result));
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../Utils/BF_Pak.h"
+#include "BF_ShaderReflection.h"
+
+//Owns the engine's shader modules - SPIR-V from the pak when present, else
+//loose files. With hot reload on, the GLSL sources are watched (inotify on
+//Linux, timestamp polling elsewhere) and recompiled with glslangValidator on
+//a worker thread. Finished modules are swapped and the pipelines registered
+//against them rebuilt from update(), on the main thread.
+//Each module is reflected as it is created, the result kept alongside it.
+class ShaderLibrary {
+public:
+	using RebuildCallback = std::function<void()>;
+
+	ShaderLibrary();
+	ShaderLibrary(const ShaderLibrary&) = delete;
+	ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+	~ShaderLibrary();
+
+	int init(VkDevice, const VkAllocationCallbacks*, const std::string& directory, const std::string& pakFile, bool hotReload);
+	void shutdown();
+
+	//Load a module by SPIR-V name, or return the one already loaded. source is
+	//the GLSL it is built from (relative to the directory) - needed to reload it.
+	//defines are passed to the compiler, name permutations with shader::PermutationName.
+	VkShaderModule load(const std::string& spvName, const std::string& source = "", const std::vector<std::string>& defines = {});
+
+	//As load(), but a module that was never built is reported and VK_NULL_HANDLE
+	//returned rather than stopping - for passes the engine can run without
+	VkShaderModule loadOptional(const std::string& spvName, const std::string& source = "", const std::vector<std::string>& defines = {});
+
+	//VK_NULL_HANDLE if not loaded
+	VkShaderModule get(const std::string& spvName) const;
+
+	//What the loaded module declares, nullptr if not loaded. Refreshed on reload,
+	//so read it again from the rebuild callback rather than holding on to it.
+	const ShaderReflection* getReflection(const std::string& spvName) const;
+
+	//callback runs after any of the named shaders is reloaded - the device is
+	//idle by then, so it can destroy and recreate its pipelines directly
+	uint32_t addDependency(const std::vector<std::string>& spvNames, RebuildCallback callback);
+	void removeDependency(uint32_t id);
+
+	//Once per frame on the main thread - picks up changes, applies finished compiles
+	void update();
+
+	const bool isHotReloadEnabled() const;
+
+private:
+	struct Shader {
+		std::string source;
+		std::vector<std::string> defines;
+		VkShaderModule module;
+		ShaderReflection reflection;
+		std::filesystem::file_time_type sourceTime;
+		bool compiling;
+		bool dirty;			//changed again while compiling
+	};
+
+	struct CompileJob {
+		std::string spvName;
+		std::string sourcePath;
+		std::string outputPath;
+		std::vector<std::string> defines;
+	};
+
+	struct CompileResult {
+		std::string spvName;
+		bool ok;
+		std::string log;
+	};
+
+	struct Dependency {
+		uint32_t id;
+		std::vector<std::string> spvNames;
+		RebuildCallback callback;
+	};
+
+	VkShaderModule loadShader(const std::string& spvName, const std::string& source, const std::vector<std::string>& defines, bool required);
+	VkShaderModule createModule(const char* code, size_t size, ShaderReflection&);
+	VkShaderModule loadModule(const std::string& spvName, bool preferLoose, bool required, ShaderReflection&);
+
+	//Runs the compiler and waits for it, output written next to the source
+	bool compile(const CompileJob&, std::string& log) const;
+	CompileJob makeJob(const std::string& spvName, const Shader&) const;
+
+	void watchSources();
+	void sourceChanged(const std::string& source);
+	void queueCompile(const std::string& spvName);
+	void compileThread();
+
+	VkDevice						m_device;
+	const VkAllocationCallbacks*	m_pAllocator;
+
+	std::string		m_directory;
+	PakArchive		m_pak;
+
+	std::unordered_map<std::string, Shader> m_shaders;
+	std::vector<Dependency> m_dependencies;
+	uint32_t		m_nextDependencyId;
+
+	//Hot reload
+	bool			m_hotReload;
+	std::string		m_compiler;
+	std::chrono::steady_clock::time_point m_nextPoll;
+	int				m_inotify;
+
+	std::thread		m_worker;
+	std::mutex		m_mutex;
+	std::condition_variable m_wake;
+	std::deque<CompileJob> m_jobs;
+	std::vector<CompileResult> m_results;
+	bool			m_exit;
+};
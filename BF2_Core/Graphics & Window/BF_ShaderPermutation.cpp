@@ -0,0 +1,97 @@
+#include "BF_ShaderPermutation.h"
+
+#include <algorithm>
+#include <cstring>
+
+void Specialization::set(uint32_t constantId, bool value)
+{
+	//SPIR-V bools are specialized as 32 bit VkBool32
+	setWord(constantId, value ? VK_TRUE : VK_FALSE);
+}
+
+void Specialization::set(uint32_t constantId, int32_t value)
+{
+	setWord(constantId, static_cast<uint32_t>(value));
+}
+
+void Specialization::set(uint32_t constantId, uint32_t value)
+{
+	setWord(constantId, value);
+}
+
+void Specialization::set(uint32_t constantId, float value)
+{
+	uint32_t word;
+	std::memcpy(&word, &value, sizeof(word));
+	setWord(constantId, word);
+}
+
+Specialization Specialization::FromFeatures(uint32_t features)
+{
+	Specialization specialization;
+	for (uint32_t i = 0; i < kShaderFeatureCount; i++) {
+		specialization.set(i, (features & (1u << i)) != 0);
+	}
+	return specialization;
+}
+
+const VkSpecializationInfo* Specialization::getInfo()
+{
+	if (m_entries.empty()) return nullptr;
+
+	m_info.mapEntryCount = static_cast<uint32_t>(m_entries.size());
+	m_info.pMapEntries = m_entries.data();
+	m_info.dataSize = m_data.size() * sizeof(uint32_t);
+	m_info.pData = m_data.data();
+
+	return &m_info;
+}
+
+void Specialization::setWord(uint32_t constantId, uint32_t word)
+{
+	auto it = std::find_if(m_entries.begin(), m_entries.end(),
+		[constantId](const VkSpecializationMapEntry& e) { return e.constantID == constantId; });
+
+	if (it != m_entries.end()) {
+		m_data[it->offset / sizeof(uint32_t)] = word;
+		return;
+	}
+
+	VkSpecializationMapEntry entry = {};
+	entry.constantID = constantId;
+	entry.offset = static_cast<uint32_t>(m_data.size() * sizeof(uint32_t));
+	entry.size = sizeof(uint32_t);
+
+	m_entries.push_back(entry);
+	m_data.push_back(word);
+}
+
+std::string shader::PermutationName(const std::string& spvName, const std::vector<std::string>& defines)
+{
+	if (defines.empty()) return spvName;
+
+	const size_t dot = spvName.rfind('.');
+	std::string name = spvName.substr(0, dot);
+
+	for (const auto& define : defines) {
+		//NAME=VALUE becomes NAME-VALUE, keeps the file name legal
+		std::string part = define;
+		std::replace(part.begin(), part.end(), '=', '-');
+		name += "_" + part;
+	}
+
+	return dot != std::string::npos ? name + spvName.substr(dot) : name;
+}
+
+std::vector<std::string> shader::FeatureDefines(uint32_t features)
+{
+	std::vector<std::string> defines;
+
+	//discard is compiled out entirely rather than specialized away - some drivers
+	//turn off early depth for any module containing it, dead or not
+	if (features & kShaderAlphaTest) {
+		defines.push_back("ALPHA_TEST");
+	}
+
+	return defines;
+}
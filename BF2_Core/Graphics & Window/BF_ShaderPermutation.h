@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Feature toggles for the default shaders. Each bit's index is the constant_id
+//of the matching specialization constant in shader.frag, so a feature mask
+//maps straight onto VkSpecializationInfo.
+enum ShaderFeature : uint32_t {
+	kShaderTextured		= 1u << 0,
+	kShaderVertexColour	= 1u << 1,
+	kShaderAlphaTest	= 1u << 2,
+};
+
+constexpr uint32_t kShaderFeatureCount = 3;
+
+//What the default pipeline is built with when nothing else is asked for
+constexpr uint32_t kShaderDefaultFeatures = kShaderTextured | kShaderVertexColour;
+
+//constant_ids after the feature bits
+constexpr uint32_t kShaderAlphaCutoffId = kShaderFeatureCount;
+
+//Specialization constant values for one pipeline - folded by the driver when
+//the pipeline is created, so branches on them cost nothing at draw time
+class Specialization {
+public:
+	Specialization() = default;
+
+	void set(uint32_t constantId, bool value);
+	void set(uint32_t constantId, int32_t value);
+	void set(uint32_t constantId, uint32_t value);
+	void set(uint32_t constantId, float value);
+
+	//One bool per feature bit
+	static Specialization FromFeatures(uint32_t features);
+
+	//Valid until this is changed or destroyed, nullptr when empty
+	const VkSpecializationInfo* getInfo();
+
+private:
+	void setWord(uint32_t constantId, uint32_t word);
+
+	std::vector<VkSpecializationMapEntry> m_entries;
+	std::vector<uint32_t> m_data;
+	VkSpecializationInfo m_info;
+};
+
+namespace shader {
+	//SPIR-V name of a define permutation - "frag.spv" + { "ALPHA_TEST" } is
+	//"frag_ALPHA_TEST.spv". No defines gives the name back unchanged.
+	std::string PermutationName(const std::string& spvName, const std::vector<std::string>& defines);
+
+	//Defines the default fragment shader is built with for a feature mask. Only
+	//features that change the module itself - the rest are specialized.
+	std::vector<std::string> FeatureDefines(uint32_t features);
+}
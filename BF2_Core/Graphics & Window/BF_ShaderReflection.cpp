@@ -0,0 +1,520 @@
+#include "BF_ShaderReflection.h"
+#include "../Utils/BF_Error.h"
+
+#include <algorithm>
+
+//SPIR-V spec values, only the handful reflection needs
+namespace {
+	constexpr uint32_t kSpirvMagic = 0x07230203;
+	constexpr size_t kSpirvHeaderWords = 5;
+
+	enum Op : uint32_t {
+		OpEntryPoint = 15,
+		OpTypeInt = 21,
+		OpTypeFloat = 22,
+		OpTypeVector = 23,
+		OpTypeMatrix = 24,
+		OpTypeImage = 25,
+		OpTypeSampler = 26,
+		OpTypeSampledImage = 27,
+		OpTypeArray = 28,
+		OpTypeRuntimeArray = 29,
+		OpTypeStruct = 30,
+		OpTypePointer = 32,
+		OpConstant = 43,
+		OpVariable = 59,
+		OpDecorate = 71,
+		OpMemberDecorate = 72,
+	};
+
+	enum Decoration : uint32_t {
+		DecorationBlock = 2,
+		DecorationBufferBlock = 3,
+		DecorationArrayStride = 6,
+		DecorationMatrixStride = 7,
+		DecorationBuiltIn = 11,
+		DecorationLocation = 30,
+		DecorationBinding = 33,
+		DecorationDescriptorSet = 34,
+		DecorationOffset = 35,
+	};
+
+	enum StorageClass : uint32_t {
+		StorageClassUniformConstant = 0,
+		StorageClassInput = 1,
+		StorageClassUniform = 2,
+		StorageClassPushConstant = 9,
+		StorageClassStorageBuffer = 12,
+	};
+
+	enum Dim : uint32_t {
+		DimBuffer = 5,
+		DimSubpassData = 6,
+	};
+
+	//Everything learnt about one result id
+	struct Id {
+		uint32_t opcode;
+		uint32_t type;			//pointee/element/component type, or a variable's pointer type
+		uint32_t storageClass;
+		uint32_t width;			//int/float bits
+		uint32_t count;			//vector/matrix components, array length id
+		uint32_t signedness;
+		uint32_t dim;
+		uint32_t sampled;		//image: 1 sampled, 2 storage
+		uint32_t value;			//OpConstant (32 bit)
+
+		uint32_t set;
+		uint32_t binding;
+		uint32_t location;
+		uint32_t arrayStride;
+		bool hasBinding;
+		bool hasLocation;
+		bool builtIn;
+		bool block;
+		bool bufferBlock;
+
+		std::vector<uint32_t> members;
+		std::vector<uint32_t> memberOffsets;
+		std::vector<uint32_t> memberMatrixStrides;
+	};
+
+	VkShaderStageFlagBits stageFromModel(uint32_t executionModel)
+	{
+		switch (executionModel) {
+		case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+		case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+		case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+		case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+		case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+		case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+		default: return VK_SHADER_STAGE_ALL;
+		}
+	}
+
+	void growMembers(Id& id, uint32_t member)
+	{
+		if (id.memberOffsets.size() <= member) {
+			id.memberOffsets.resize(member + 1, 0);
+			id.memberMatrixStrides.resize(member + 1, 0);
+		}
+	}
+
+	//Byte size of a type as laid out in a buffer block
+	uint32_t typeSize(const std::vector<Id>& ids, uint32_t typeId, uint32_t matrixStride = 0)
+	{
+		const Id& type = ids[typeId];
+
+		switch (type.opcode) {
+		case OpTypeInt:
+		case OpTypeFloat:
+			return type.width / 8;
+
+		case OpTypeVector:
+			return type.count * typeSize(ids, type.type);
+
+		case OpTypeMatrix:
+			return type.count * (matrixStride ? matrixStride : typeSize(ids, type.type));
+
+		case OpTypeArray: {
+			const uint32_t stride = type.arrayStride ? type.arrayStride : typeSize(ids, type.type);
+			return ids[type.count].value * stride;
+		}
+
+		case OpTypeStruct: {
+			uint32_t size = 0;
+			for (size_t i = 0; i < type.members.size(); i++) {
+				const uint32_t offset = i < type.memberOffsets.size() ? type.memberOffsets[i] : 0;
+				const uint32_t stride = i < type.memberMatrixStrides.size() ? type.memberMatrixStrides[i] : 0;
+				size = std::max(size, offset + typeSize(ids, type.members[i], stride));
+			}
+			return size;
+		}
+
+		default:
+			return 0;
+		}
+	}
+
+	//Vertex attribute format of a scalar/vector input type
+	VkFormat inputFormat(const std::vector<Id>& ids, uint32_t typeId, uint32_t& size)
+	{
+		const Id& type = ids[typeId];
+		const Id& scalar = type.opcode == OpTypeVector ? ids[type.type] : type;
+		const uint32_t components = type.opcode == OpTypeVector ? type.count : 1;
+
+		size = components * scalar.width / 8;
+
+		if (scalar.opcode == OpTypeFloat && scalar.width == 32) {
+			static const VkFormat formats[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+			return formats[components - 1];
+		}
+		if (scalar.opcode == OpTypeFloat && scalar.width == 16) {
+			static const VkFormat formats[] = { VK_FORMAT_R16_SFLOAT, VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_R16G16B16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT };
+			return formats[components - 1];
+		}
+		if (scalar.opcode == OpTypeInt && scalar.width == 32) {
+			static const VkFormat sint[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+			static const VkFormat uint[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+			return scalar.signedness ? sint[components - 1] : uint[components - 1];
+		}
+
+		size = 0;
+		return VK_FORMAT_UNDEFINED;
+	}
+
+	uint32_t formatSize(VkFormat format)
+	{
+		switch (format) {
+		case VK_FORMAT_R16_SFLOAT: return 2;
+		case VK_FORMAT_R16G16_SFLOAT: return 4;
+		case VK_FORMAT_R16G16B16_SFLOAT: return 6;
+		case VK_FORMAT_R16G16B16A16_SFLOAT: return 8;
+		case VK_FORMAT_R32_SFLOAT: case VK_FORMAT_R32_SINT: case VK_FORMAT_R32_UINT: return 4;
+		case VK_FORMAT_R32G32_SFLOAT: case VK_FORMAT_R32G32_SINT: case VK_FORMAT_R32G32_UINT: return 8;
+		case VK_FORMAT_R32G32B32_SFLOAT: case VK_FORMAT_R32G32B32_SINT: case VK_FORMAT_R32G32B32_UINT: return 12;
+		case VK_FORMAT_R32G32B32A32_SFLOAT: case VK_FORMAT_R32G32B32A32_SINT: case VK_FORMAT_R32G32B32A32_UINT: return 16;
+		default: return 0;
+		}
+	}
+}
+
+bool shader::Reflect(const uint32_t* code, size_t wordCount, ShaderReflection& out)
+{
+	out = ShaderReflection();
+	out.stage = VK_SHADER_STAGE_ALL;
+
+	if (!code || wordCount < kSpirvHeaderWords || code[0] != kSpirvMagic) {
+		errorF("shader::Reflect() - not a SPIR-V module");
+		return false;
+	}
+
+	const uint32_t bound = code[3];
+	std::vector<Id> ids(bound, Id());
+	std::vector<uint32_t> variables;
+
+	//One pass to gather types, decorations and variables
+	for (size_t i = kSpirvHeaderWords; i < wordCount; ) {
+		const uint32_t* inst = code + i;
+		const uint32_t opcode = inst[0] & 0xFFFF;
+		const uint32_t length = inst[0] >> 16;
+
+		if (length == 0 || i + length > wordCount) {
+			errorF("shader::Reflect() - malformed instruction at word %llu", static_cast<unsigned long long>(i));
+			return false;
+		}
+
+		//Operand index 1 is the result id for type declarations
+		auto result = [&](uint32_t word) -> Id* {
+			return (word < length && inst[word] < bound) ? &ids[inst[word]] : nullptr;
+		};
+
+		switch (opcode) {
+		case OpEntryPoint:
+			//First entry point only - the engine's shaders have one each
+			if (out.entryPoint.empty() && length > 3) {
+				out.stage = stageFromModel(inst[1]);
+				out.entryPoint = reinterpret_cast<const char*>(inst + 3);
+			}
+			break;
+
+		case OpTypeInt:
+			if (Id* id = result(1)) { id->opcode = opcode; id->width = inst[2]; id->signedness = inst[3]; }
+			break;
+
+		case OpTypeFloat:
+			if (Id* id = result(1)) { id->opcode = opcode; id->width = inst[2]; }
+			break;
+
+		case OpTypeVector:
+		case OpTypeMatrix:
+			if (Id* id = result(1)) { id->opcode = opcode; id->type = inst[2]; id->count = inst[3]; }
+			break;
+
+		case OpTypeImage:
+			if (Id* id = result(1)) { id->opcode = opcode; id->type = inst[2]; id->dim = inst[3]; id->sampled = inst[7]; }
+			break;
+
+		case OpTypeSampler:
+			if (Id* id = result(1)) { id->opcode = opcode; }
+			break;
+
+		case OpTypeSampledImage:
+		case OpTypeRuntimeArray:
+			if (Id* id = result(1)) { id->opcode = opcode; id->type = inst[2]; }
+			break;
+
+		case OpTypeArray:
+			if (Id* id = result(1)) { id->opcode = opcode; id->type = inst[2]; id->count = inst[3]; }
+			break;
+
+		case OpTypeStruct:
+			if (Id* id = result(1)) {
+				id->opcode = opcode;
+				id->members.assign(inst + 2, inst + length);
+				growMembers(*id, static_cast<uint32_t>(id->members.size()) - 1);
+			}
+			break;
+
+		case OpTypePointer:
+			if (Id* id = result(1)) { id->opcode = opcode; id->storageClass = inst[2]; id->type = inst[3]; }
+			break;
+
+		case OpConstant:
+			if (Id* id = result(2)) { id->opcode = opcode; id->type = inst[1]; id->value = inst[3]; }
+			break;
+
+		case OpVariable:
+			if (Id* id = result(2)) {
+				id->opcode = opcode;
+				id->type = inst[1];
+				id->storageClass = inst[3];
+				variables.push_back(inst[2]);
+			}
+			break;
+
+		case OpDecorate:
+			if (Id* id = result(1)) {
+				switch (inst[2]) {
+				case DecorationBlock: id->block = true; break;
+				case DecorationBufferBlock: id->bufferBlock = true; break;
+				case DecorationArrayStride: id->arrayStride = inst[3]; break;
+				case DecorationBuiltIn: id->builtIn = true; break;
+				case DecorationLocation: id->location = inst[3]; id->hasLocation = true; break;
+				case DecorationBinding: id->binding = inst[3]; id->hasBinding = true; break;
+				case DecorationDescriptorSet: id->set = inst[3]; break;
+				}
+			}
+			break;
+
+		case OpMemberDecorate:
+			if (Id* id = result(1)) {
+				const uint32_t member = inst[2];
+				growMembers(*id, member);
+
+				switch (inst[3]) {
+				case DecorationOffset: id->memberOffsets[member] = inst[4]; break;
+				case DecorationMatrixStride: id->memberMatrixStrides[member] = inst[4]; break;
+				case DecorationBuiltIn: id->builtIn = true; break;		//gl_PerVertex
+				}
+			}
+			break;
+		}
+
+		i += length;
+	}
+
+	//Turn the interesting variables into bindings, push constants and inputs
+	for (uint32_t varId : variables) {
+		const Id& var = ids[varId];
+		const uint32_t pointee = ids[var.type].type;
+		if (pointee >= bound) continue;
+
+		switch (var.storageClass) {
+		case StorageClassUniformConstant:
+		case StorageClassUniform:
+		case StorageClassStorageBuffer: {
+			if (!var.hasBinding) break;
+
+			//Arrays of resources become the descriptor count
+			uint32_t typeId = pointee;
+			uint32_t count = 1;
+			if (ids[typeId].opcode == OpTypeArray) {
+				count = ids[ids[typeId].count].value;
+				typeId = ids[typeId].type;
+			}
+			else if (ids[typeId].opcode == OpTypeRuntimeArray) {
+				//Sized by whoever builds the layout, needs descriptor indexing
+				count = 1;
+				typeId = ids[typeId].type;
+			}
+
+			const Id& type = ids[typeId];
+			VkDescriptorType descriptorType = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+
+			if (var.storageClass == StorageClassStorageBuffer || (type.opcode == OpTypeStruct && type.bufferBlock)) {
+				descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			}
+			else if (type.opcode == OpTypeStruct) {
+				descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			}
+			else if (type.opcode == OpTypeSampledImage) {
+				descriptorType = ids[type.type].dim == DimBuffer ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			}
+			else if (type.opcode == OpTypeSampler) {
+				descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+			}
+			else if (type.opcode == OpTypeImage) {
+				if (type.dim == DimSubpassData) {
+					descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+				}
+				else if (type.dim == DimBuffer) {
+					descriptorType = type.sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+				}
+				else {
+					descriptorType = type.sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+				}
+			}
+
+			if (descriptorType == VK_DESCRIPTOR_TYPE_MAX_ENUM) {
+				errorF("shader::Reflect() - unrecognised resource at set %u binding %u", var.set, var.binding);
+				break;
+			}
+
+			out.bindings.push_back({ var.set, var.binding, descriptorType, count, static_cast<VkShaderStageFlags>(out.stage) });
+			break;
+		}
+
+		case StorageClassPushConstant: {
+			const Id& block = ids[pointee];
+
+			//Range starts at the first member actually declared
+			uint32_t offset = 0;
+			if (!block.memberOffsets.empty()) {
+				offset = *std::min_element(block.memberOffsets.begin(), block.memberOffsets.end());
+			}
+
+			VkPushConstantRange range = {};
+			range.stageFlags = out.stage;
+			range.offset = offset;
+			range.size = typeSize(ids, pointee) - offset;
+			out.pushConstants.push_back(range);
+			break;
+		}
+
+		case StorageClassInput: {
+			if (var.builtIn || ids[pointee].builtIn || !var.hasLocation) break;
+
+			//Matrices take a location per column
+			uint32_t typeId = pointee;
+			uint32_t locations = 1;
+			if (ids[typeId].opcode == OpTypeMatrix) {
+				locations = ids[typeId].count;
+				typeId = ids[typeId].type;
+			}
+
+			for (uint32_t l = 0; l < locations; l++) {
+				ReflectedInput input = {};
+				input.location = var.location + l;
+				input.format = inputFormat(ids, typeId, input.size);
+
+				if (input.format == VK_FORMAT_UNDEFINED) {
+					errorF("shader::Reflect() - unsupported input type at location %u", input.location);
+				}
+
+				out.inputs.push_back(input);
+			}
+			break;
+		}
+		}
+	}
+
+	std::sort(out.bindings.begin(), out.bindings.end(), [](const ReflectedBinding& a, const ReflectedBinding& b) {
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+	});
+	std::sort(out.inputs.begin(), out.inputs.end(), [](const ReflectedInput& a, const ReflectedInput& b) {
+		return a.location < b.location;
+	});
+
+	return true;
+}
+
+PipelineLayoutDesc shader::MergeLayouts(const std::vector<const ShaderReflection*>& stages)
+{
+	PipelineLayoutDesc desc;
+
+	for (const ShaderReflection* stage : stages) {
+		if (!stage) continue;
+
+		for (const auto& binding : stage->bindings) {
+			if (desc.sets.size() <= binding.set) {
+				desc.sets.resize(binding.set + 1);
+			}
+
+			auto& set = desc.sets[binding.set];
+			auto it = std::find_if(set.begin(), set.end(), [&binding](const VkDescriptorSetLayoutBinding& b) { return b.binding == binding.binding; });
+
+			if (it == set.end()) {
+				VkDescriptorSetLayoutBinding layoutBinding = {};
+				layoutBinding.binding = binding.binding;
+				layoutBinding.descriptorType = binding.type;
+				layoutBinding.descriptorCount = binding.count;
+				layoutBinding.stageFlags = binding.stages;
+				layoutBinding.pImmutableSamplers = nullptr;
+				set.push_back(layoutBinding);
+				continue;
+			}
+
+			//Same slot seen from another stage - must agree on what it is
+			if (it->descriptorType != binding.type || it->descriptorCount != binding.count) {
+				errorF("shader::MergeLayouts() - set %u binding %u declared differently between stages", binding.set, binding.binding);
+			}
+			it->stageFlags |= binding.stages;
+		}
+
+		for (const auto& range : stage->pushConstants) {
+			auto it = std::find_if(desc.pushConstants.begin(), desc.pushConstants.end(), [&range](const VkPushConstantRange& r) {
+				return r.offset == range.offset && r.size == range.size;
+			});
+
+			if (it != desc.pushConstants.end()) {
+				it->stageFlags |= range.stageFlags;
+			}
+			else {
+				desc.pushConstants.push_back(range);
+			}
+		}
+	}
+
+	//Stable order so equal layouts hash the same
+	for (auto& set : desc.sets) {
+		std::sort(set.begin(), set.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+			return a.binding < b.binding;
+		});
+	}
+
+	return desc;
+}
+
+bool shader::SetImmutableSamplers(PipelineLayoutDesc& desc, uint32_t set, uint32_t binding, const VkSampler* samplers)
+{
+	if (set < desc.sets.size()) {
+		for (auto& layoutBinding : desc.sets[set]) {
+			if (layoutBinding.binding != binding) continue;
+
+			if (layoutBinding.descriptorType != VK_DESCRIPTOR_TYPE_SAMPLER && layoutBinding.descriptorType != VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) {
+				errorF("shader::SetImmutableSamplers() - set %u binding %u doesn't hold samplers", set, binding);
+				return false;
+			}
+
+			layoutBinding.pImmutableSamplers = samplers;
+			return true;
+		}
+	}
+
+	errorF("shader::SetImmutableSamplers() - no set %u binding %u", set, binding);
+	return false;
+}
+
+VertexInputDesc shader::BuildVertexInput(const ShaderReflection& vertexStage, uint32_t binding)
+{
+	VertexInputDesc desc = {};
+	desc.binding.binding = binding;
+	desc.binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	uint32_t offset = 0;
+	for (const auto& input : vertexStage.inputs) {
+		VkVertexInputAttributeDescription attribute = {};
+		attribute.binding = binding;
+		attribute.location = input.location;
+		attribute.format = input.format;
+		attribute.offset = offset;
+		desc.attributes.push_back(attribute);
+
+		offset += formatSize(input.format);
+	}
+
+	desc.binding.stride = offset;
+
+	return desc;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//What a SPIR-V module declares - enough to build its descriptor set layouts,
+//push constant ranges and vertex input without restating them in C++
+
+struct ReflectedBinding {
+	uint32_t set;
+	uint32_t binding;
+	VkDescriptorType type;
+	uint32_t count;
+	VkShaderStageFlags stages;
+};
+
+struct ReflectedInput {
+	uint32_t location;
+	VkFormat format;
+	uint32_t size;
+};
+
+struct ShaderReflection {
+	VkShaderStageFlagBits stage;
+	std::string entryPoint;
+
+	std::vector<ReflectedBinding> bindings;
+	std::vector<VkPushConstantRange> pushConstants;
+
+	//Stage inputs sorted by location (vertex attributes for a vertex shader)
+	std::vector<ReflectedInput> inputs;
+};
+
+//Every stage of a pipeline merged
+struct PipelineLayoutDesc {
+	//Indexed by set number, unused sets in between are empty
+	std::vector<std::vector<VkDescriptorSetLayoutBinding>> sets;
+	std::vector<VkPushConstantRange> pushConstants;
+};
+
+struct VertexInputDesc {
+	VkVertexInputBindingDescription binding;
+	std::vector<VkVertexInputAttributeDescription> attributes;
+};
+
+namespace shader {
+	//False if code isn't valid SPIR-V
+	bool Reflect(const uint32_t* code, size_t wordCount, ShaderReflection& out);
+
+	//Bindings shared between stages are combined, mismatches reported
+	PipelineLayoutDesc MergeLayouts(const std::vector<const ShaderReflection*>& stages);
+
+	//Bakes samplers (descriptorCount of them) into a sampler or combined image
+	//sampler binding - sets then only write image views there, and equal samplers
+	//give equal layouts. samplers has to outlive building layouts from desc.
+	bool SetImmutableSamplers(PipelineLayoutDesc& desc, uint32_t set, uint32_t binding, const VkSampler* samplers);
+
+	//Vertex shader inputs as one tightly packed, interleaved binding
+	VertexInputDesc BuildVertexInput(const ShaderReflection& vertexStage, uint32_t binding = 0);
+}
@@ -0,0 +1,152 @@
+#include "BF_TextureConvert.h"
+#include "BF_TextureFile.h"
+#include "../Utils/BF_BlockCompress.h"
+#include "../Utils/BF_Error.h"
+#include "../Utils/BF_ImageDecode.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+static float SrgbToLinear(float value)
+{
+	return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float LinearToSrgb(float value)
+{
+	return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+//Source rows or columns under texel i of the level below - the last one of an odd
+//size takes three, so the odd edge isn't dropped
+static uint32_t FootprintTaps(uint32_t i, uint32_t sourceSize, uint32_t outSize, uint32_t taps[3])
+{
+	uint32_t count = 0;
+	taps[count++] = std::min(i * 2, sourceSize - 1);
+	taps[count++] = std::min(i * 2 + 1, sourceSize - 1);
+	if (i == outSize - 1 && sourceSize > 1 && (sourceSize & 1)) {
+		taps[count++] = sourceSize - 1;
+	}
+	return count;
+}
+
+//Next level down by a box filter - 2x2, up to 3x3 along an odd edge
+static Image Downsample(const Image& source, bool srgb, const float toLinear[256])
+{
+	Image out;
+	out.width = std::max(1u, source.width / 2);
+	out.height = std::max(1u, source.height / 2);
+	out.rgba.resize(static_cast<size_t>(out.width) * out.height * 4);
+
+	for (uint32_t y = 0; y < out.height; y++) {
+		uint32_t rows[3];
+		const uint32_t rowCount = FootprintTaps(y, source.height, out.height, rows);
+
+		for (uint32_t x = 0; x < out.width; x++) {
+			uint32_t columns[3];
+			const uint32_t columnCount = FootprintTaps(x, source.width, out.width, columns);
+
+			uint8_t* texel = out.rgba.data() + (static_cast<size_t>(y) * out.width + x) * 4;
+			for (int channel = 0; channel < 4; channel++) {
+				float sum = 0.0f;
+				for (uint32_t row = 0; row < rowCount; row++) {
+					for (uint32_t column = 0; column < columnCount; column++) {
+						const uint8_t* sample = source.rgba.data() + (static_cast<size_t>(rows[row]) * source.width + columns[column]) * 4;
+						sum += srgb && channel < 3 ? toLinear[sample[channel]] : sample[channel] / 255.0f;
+					}
+				}
+
+				float value = sum / static_cast<float>(rowCount * columnCount);
+				if (srgb && channel < 3) value = LinearToSrgb(value);
+				texel[channel] = static_cast<uint8_t>(std::lround(std::max(0.0f, std::min(1.0f, value)) * 255.0f));
+			}
+		}
+	}
+
+	return out;
+}
+
+bool tex::EncodingFromName(const std::string& name, TextureEncoding& out)
+{
+	static const struct {
+		const char* name;
+		TextureEncoding encoding;
+	} kNames[] = {
+		{ "auto", TextureEncoding::Auto },
+		{ "rgba8", TextureEncoding::RGBA8 },
+		{ "bc1", TextureEncoding::BC1 },
+		{ "bc3", TextureEncoding::BC3 },
+		{ "bc4", TextureEncoding::BC4 },
+		{ "bc5", TextureEncoding::BC5 },
+	};
+
+	for (const auto& entry : kNames) {
+		if (name == entry.name) {
+			out = entry.encoding;
+			return true;
+		}
+	}
+
+	errorF("tex::EncodingFromName() - unknown encoding %s", name.c_str());
+	return false;
+}
+
+bool tex::Convert(const std::string& source, const std::string& outFile, TextureEncoding encoding, bool srgb)
+{
+	Image image;
+	if (!img::Load(source, image)) {
+		errorF("tex::Convert() - failed to load %s", source.c_str());
+		return false;
+	}
+
+	if (encoding == TextureEncoding::Auto) {
+		bool opaque = true;
+		for (size_t i = 3; i < image.rgba.size() && opaque; i += 4) {
+			opaque = image.rgba[i] == 255;
+		}
+		encoding = opaque ? TextureEncoding::BC1 : TextureEncoding::BC3;
+	}
+
+	VkFormat format;
+	switch (encoding) {
+	case TextureEncoding::RGBA8: format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM; break;
+	case TextureEncoding::BC1: format = srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK; break;
+	case TextureEncoding::BC3: format = srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK; break;
+	case TextureEncoding::BC4: format = VK_FORMAT_BC4_UNORM_BLOCK; srgb = false; break;
+	default: format = VK_FORMAT_BC5_UNORM_BLOCK; srgb = false; break;
+	}
+
+	float toLinear[256];
+	for (int value = 0; value < 256; value++) {
+		toLinear[value] = SrgbToLinear(value / 255.0f);
+	}
+
+	const VkExtent2D extent = { image.width, image.height };
+
+	//Every level down to 1x1, each filtered from the one above
+	std::vector<std::vector<char>> mips;
+	for (;;) {
+		switch (encoding) {
+		case TextureEncoding::RGBA8: mips.emplace_back(image.rgba.begin(), image.rgba.end()); break;
+		case TextureEncoding::BC1: mips.push_back(bc::Compress(image.rgba.data(), image.width, image.height, bc::Format::BC1)); break;
+		case TextureEncoding::BC3: mips.push_back(bc::Compress(image.rgba.data(), image.width, image.height, bc::Format::BC3)); break;
+		case TextureEncoding::BC4: mips.push_back(bc::Compress(image.rgba.data(), image.width, image.height, bc::Format::BC4)); break;
+		default: mips.push_back(bc::Compress(image.rgba.data(), image.width, image.height, bc::Format::BC5)); break;
+		}
+
+		if (image.width == 1 && image.height == 1) break;
+		image = Downsample(image, srgb, toLinear);
+	}
+
+	if (!WriteDds(outFile, format, extent, mips)) return false;
+
+	size_t bytes = 0;
+	for (const auto& mip : mips) {
+		bytes += mip.size();
+	}
+	debugF("tex::Convert() - %s to %s, %ux%u with %zu mips in %zu bytes", source.c_str(), outFile.c_str(), extent.width, extent.height, mips.size(), bytes);
+
+	return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+enum class TextureEncoding : uint32_t {
+	Auto,		//BC1 when every texel is opaque, BC3 otherwise
+	RGBA8,
+	BC1,
+	BC3,
+	BC4,		//red only
+	BC5,		//red and green
+};
+
+namespace tex {
+	//"auto", "rgba8", "bc1", "bc3", "bc4" or "bc5"
+	bool EncodingFromName(const std::string& name, TextureEncoding& out);
+
+	//Offline - decodes a PNG/TGA, builds its full mip chain and writes a DDS
+	//TextureStreamer uploads as it is. srgb marks colour data, whose mips are
+	//averaged in linear light; BC4/BC5 are always linear.
+	bool Convert(const std::string& source, const std::string& outFile, TextureEncoding, bool srgb);
+}
@@ -0,0 +1,446 @@
+#include "BF_TextureFile.h"
+#include "BF_GpuImage.h"
+#include "../Utils/BF_Error.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace {
+	constexpr uint32_t kDdsMagic = 0x20534444;		//"DDS "
+	constexpr uint32_t kDdsFourCCDX10 = 0x30315844;	//"DX10"
+	constexpr uint32_t kDdsFourCCDXT1 = 0x31545844;	//"DXT1"
+	constexpr uint32_t kDdsFourCCDXT2 = 0x32545844;	//"DXT2"
+	constexpr uint32_t kDdsFourCCDXT3 = 0x33545844;	//"DXT3"
+	constexpr uint32_t kDdsFourCCDXT4 = 0x34545844;	//"DXT4"
+	constexpr uint32_t kDdsFourCCDXT5 = 0x35545844;	//"DXT5"
+	constexpr uint32_t kDdsFourCCATI1 = 0x31495441;	//"ATI1"
+	constexpr uint32_t kDdsFourCCATI2 = 0x32495441;	//"ATI2"
+	constexpr uint32_t kDdsFourCCBC4U = 0x55344342;	//"BC4U"
+	constexpr uint32_t kDdsFourCCBC4S = 0x53344342;	//"BC4S"
+	constexpr uint32_t kDdsFourCCBC5U = 0x55354342;	//"BC5U"
+	constexpr uint32_t kDdsFourCCBC5S = 0x53354342;	//"BC5S"
+
+	constexpr uint32_t kDdsFlagCaps = 0x1;
+	constexpr uint32_t kDdsFlagHeight = 0x2;
+	constexpr uint32_t kDdsFlagWidth = 0x4;
+	constexpr uint32_t kDdsFlagPixelFormat = 0x1000;
+	constexpr uint32_t kDdsFlagMipCount = 0x20000;
+	constexpr uint32_t kDdsFlagLinearSize = 0x80000;
+	constexpr uint32_t kDdsPixelFourCC = 0x4;
+	constexpr uint32_t kDdsPixelRGB = 0x40;
+	constexpr uint32_t kDdsCaps2Cubemap = 0x200;
+	constexpr uint32_t kDdsCaps2Volume = 0x200000;
+	constexpr uint32_t kDdsCapsComplex = 0x8;
+	constexpr uint32_t kDdsCapsTexture = 0x1000;
+	constexpr uint32_t kDdsCapsMipMap = 0x400000;
+
+	constexpr uint32_t kDxgiR8G8B8A8Unorm = 28;
+	constexpr uint32_t kDxgiR8G8B8A8Srgb = 29;
+	constexpr uint32_t kDxgiB8G8R8A8Unorm = 87;
+	constexpr uint32_t kDxgiB8G8R8A8Srgb = 91;
+	constexpr uint32_t kDxgiBC1Unorm = 71;
+	constexpr uint32_t kDxgiBC1Srgb = 72;
+	constexpr uint32_t kDxgiBC2Unorm = 74;
+	constexpr uint32_t kDxgiBC2Srgb = 75;
+	constexpr uint32_t kDxgiBC3Unorm = 77;
+	constexpr uint32_t kDxgiBC3Srgb = 78;
+	constexpr uint32_t kDxgiBC4Unorm = 80;
+	constexpr uint32_t kDxgiBC4Snorm = 81;
+	constexpr uint32_t kDxgiBC5Unorm = 83;
+	constexpr uint32_t kDxgiBC5Snorm = 84;
+	constexpr uint32_t kDxgiBC6HUf16 = 95;
+	constexpr uint32_t kDxgiBC6HSf16 = 96;
+	constexpr uint32_t kDxgiBC7Unorm = 98;
+	constexpr uint32_t kDxgiBC7Srgb = 99;
+	constexpr uint32_t kDxgiTexture2D = 3;
+
+	struct DdsPixelFormat {
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t rMask;
+		uint32_t gMask;
+		uint32_t bMask;
+		uint32_t aMask;
+	};
+
+	struct DdsHeader {
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DdsPixelFormat pixelFormat;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct DdsHeaderDX10 {
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	static_assert(sizeof(DdsHeader) == 124, "DdsHeader layout is part of the file format");
+	static_assert(sizeof(DdsHeaderDX10) == 20, "DdsHeaderDX10 layout is part of the file format");
+
+	//KTX2 - identifier, header, index, then one level entry per mip
+	constexpr uint8_t kKtx2Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	struct Ktx2Header {
+		uint8_t identifier[12];
+		uint32_t vkFormat;
+		uint32_t typeSize;
+		uint32_t pixelWidth;
+		uint32_t pixelHeight;
+		uint32_t pixelDepth;
+		uint32_t layerCount;
+		uint32_t faceCount;
+		uint32_t levelCount;
+		uint32_t supercompressionScheme;
+		uint32_t dfdByteOffset;
+		uint32_t dfdByteLength;
+		uint32_t kvdByteOffset;
+		uint32_t kvdByteLength;
+		uint64_t sgdByteOffset;
+		uint64_t sgdByteLength;
+	};
+
+	struct Ktx2Level {
+		uint64_t byteOffset;
+		uint64_t byteLength;
+		uint64_t uncompressedByteLength;
+	};
+
+	static_assert(sizeof(Ktx2Header) == 80, "Ktx2Header layout is part of the file format");
+	static_assert(sizeof(Ktx2Level) == 24, "Ktx2Level layout is part of the file format");
+
+	//Pairs both ways, the writer picks the first entry for a VkFormat
+	struct DxgiMapping {
+		uint32_t dxgiFormat;
+		VkFormat format;
+	};
+
+	constexpr DxgiMapping kDxgiFormats[] = {
+		{ kDxgiR8G8B8A8Unorm, VK_FORMAT_R8G8B8A8_UNORM },
+		{ kDxgiR8G8B8A8Srgb, VK_FORMAT_R8G8B8A8_SRGB },
+		{ kDxgiB8G8R8A8Unorm, VK_FORMAT_B8G8R8A8_UNORM },
+		{ kDxgiB8G8R8A8Srgb, VK_FORMAT_B8G8R8A8_SRGB },
+		{ kDxgiBC1Unorm, VK_FORMAT_BC1_RGBA_UNORM_BLOCK },
+		{ kDxgiBC1Srgb, VK_FORMAT_BC1_RGBA_SRGB_BLOCK },
+		{ kDxgiBC1Unorm, VK_FORMAT_BC1_RGB_UNORM_BLOCK },
+		{ kDxgiBC1Srgb, VK_FORMAT_BC1_RGB_SRGB_BLOCK },
+		{ kDxgiBC2Unorm, VK_FORMAT_BC2_UNORM_BLOCK },
+		{ kDxgiBC2Srgb, VK_FORMAT_BC2_SRGB_BLOCK },
+		{ kDxgiBC3Unorm, VK_FORMAT_BC3_UNORM_BLOCK },
+		{ kDxgiBC3Srgb, VK_FORMAT_BC3_SRGB_BLOCK },
+		{ kDxgiBC4Unorm, VK_FORMAT_BC4_UNORM_BLOCK },
+		{ kDxgiBC4Snorm, VK_FORMAT_BC4_SNORM_BLOCK },
+		{ kDxgiBC5Unorm, VK_FORMAT_BC5_UNORM_BLOCK },
+		{ kDxgiBC5Snorm, VK_FORMAT_BC5_SNORM_BLOCK },
+		{ kDxgiBC6HUf16, VK_FORMAT_BC6H_UFLOAT_BLOCK },
+		{ kDxgiBC6HSf16, VK_FORMAT_BC6H_SFLOAT_BLOCK },
+		{ kDxgiBC7Unorm, VK_FORMAT_BC7_UNORM_BLOCK },
+		{ kDxgiBC7Srgb, VK_FORMAT_BC7_SRGB_BLOCK },
+	};
+
+	VkFormat FromDxgi(uint32_t dxgiFormat)
+	{
+		for (const auto& mapping : kDxgiFormats) {
+			if (mapping.dxgiFormat == dxgiFormat) return mapping.format;
+		}
+		return VK_FORMAT_UNDEFINED;
+	}
+
+	uint32_t ToDxgi(VkFormat format)
+	{
+		for (const auto& mapping : kDxgiFormats) {
+			if (mapping.format == format) return mapping.dxgiFormat;
+		}
+		return 0;
+	}
+
+	//Legacy header - the two 32 bit byte orders and the block compressed FourCCs
+	VkFormat FromPixelFormat(const DdsPixelFormat& pf)
+	{
+		if (pf.flags & kDdsPixelFourCC) {
+			switch (pf.fourCC) {
+			case kDdsFourCCDXT1: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+			case kDdsFourCCDXT2:
+			case kDdsFourCCDXT3: return VK_FORMAT_BC2_UNORM_BLOCK;
+			case kDdsFourCCDXT4:
+			case kDdsFourCCDXT5: return VK_FORMAT_BC3_UNORM_BLOCK;
+			case kDdsFourCCATI1:
+			case kDdsFourCCBC4U: return VK_FORMAT_BC4_UNORM_BLOCK;
+			case kDdsFourCCBC4S: return VK_FORMAT_BC4_SNORM_BLOCK;
+			case kDdsFourCCATI2:
+			case kDdsFourCCBC5U: return VK_FORMAT_BC5_UNORM_BLOCK;
+			case kDdsFourCCBC5S: return VK_FORMAT_BC5_SNORM_BLOCK;
+			default: return VK_FORMAT_UNDEFINED;
+			}
+		}
+
+		if (!(pf.flags & kDdsPixelRGB) || pf.rgbBitCount != 32) return VK_FORMAT_UNDEFINED;
+
+		if (pf.rMask == 0x000000ff && pf.gMask == 0x0000ff00 && pf.bMask == 0x00ff0000) return VK_FORMAT_R8G8B8A8_UNORM;
+		if (pf.rMask == 0x00ff0000 && pf.gMask == 0x0000ff00 && pf.bMask == 0x000000ff) return VK_FORMAT_B8G8R8A8_UNORM;
+
+		return VK_FORMAT_UNDEFINED;
+	}
+}
+
+int tex::ParseDds(const char* data, size_t size, TextureFile& out)
+{
+	out = {};
+
+	uint32_t magic = 0;
+	DdsHeader header;
+	if (size < sizeof(magic) + sizeof(header)) {
+		errorF("DDS file too small!");
+		return 0;
+	}
+
+	std::memcpy(&magic, data, sizeof(magic));
+	std::memcpy(&header, data + sizeof(magic), sizeof(header));
+	size_t offset = sizeof(magic) + sizeof(header);
+
+	if (magic != kDdsMagic || header.size != sizeof(DdsHeader)) {
+		errorF("Not a DDS file!");
+		return 0;
+	}
+
+	if (header.caps2 & (kDdsCaps2Cubemap | kDdsCaps2Volume)) {
+		errorF("DDS cubemaps and volumes are not supported!");
+		return 0;
+	}
+
+	if ((header.pixelFormat.flags & kDdsPixelFourCC) && header.pixelFormat.fourCC == kDdsFourCCDX10) {
+		DdsHeaderDX10 dx10;
+		if (size < offset + sizeof(dx10)) {
+			errorF("DDS file too small!");
+			return 0;
+		}
+		std::memcpy(&dx10, data + offset, sizeof(dx10));
+		offset += sizeof(dx10);
+
+		if (dx10.resourceDimension != kDxgiTexture2D || dx10.arraySize > 1) {
+			errorF("Only single 2D DDS textures are supported!");
+			return 0;
+		}
+		out.format = FromDxgi(dx10.dxgiFormat);
+	}
+	else {
+		out.format = FromPixelFormat(header.pixelFormat);
+	}
+
+	if (out.format == VK_FORMAT_UNDEFINED) {
+		errorF("Unsupported DDS pixel format!");
+		return 0;
+	}
+
+	out.extent = { header.width, header.height };
+	if (out.extent.width == 0 || out.extent.height == 0) {
+		errorF("DDS texture has no size!");
+		return 0;
+	}
+
+	//No more than a full chain - MipExtent can't shift past it and the image couldn't hold them
+	const uint32_t mipCount = (header.flags & kDdsFlagMipCount) ? std::min(std::max(1u, header.mipMapCount), gpu::MipCount(out.extent)) : 1;
+
+	//Levels follow each other with no padding
+	for (uint32_t level = 0; level < mipCount; level++) {
+		TextureMip mip;
+		mip.extent = MipExtent(out.extent, level);
+		mip.offset = offset;
+		mip.size = MipSize(out.format, mip.extent);
+
+		if (offset + mip.size > size) {
+			errorF("DDS file truncated at mip %u!", level);
+			out = {};
+			return 0;
+		}
+
+		out.mips.push_back(mip);
+		offset += mip.size;
+	}
+
+	return 1;
+}
+
+int tex::ParseKtx2(const char* data, size_t size, TextureFile& out)
+{
+	out = {};
+
+	Ktx2Header header;
+	if (size < sizeof(header)) {
+		errorF("KTX2 file too small!");
+		return 0;
+	}
+	std::memcpy(&header, data, sizeof(header));
+
+	if (std::memcmp(header.identifier, kKtx2Identifier, sizeof(kKtx2Identifier)) != 0) {
+		errorF("Not a KTX2 file!");
+		return 0;
+	}
+
+	//Supercompressed (Basis, zstd) levels would need decoding on the CPU first
+	if (header.supercompressionScheme != 0) {
+		errorF("Supercompressed KTX2 files are not supported!");
+		return 0;
+	}
+
+	if (header.pixelHeight == 0 || header.pixelDepth != 0 || header.layerCount > 1 || header.faceCount != 1) {
+		errorF("Only single 2D KTX2 textures are supported!");
+		return 0;
+	}
+
+	out.format = static_cast<VkFormat>(header.vkFormat);
+	if (GetFormatBlock(out.format).bytes == 0) {
+		errorF("Unsupported KTX2 format %u!", header.vkFormat);
+		out = {};
+		return 0;
+	}
+
+	out.extent = { header.pixelWidth, header.pixelHeight };
+	if (out.extent.width == 0) {
+		errorF("KTX2 texture has no size!");
+		out = {};
+		return 0;
+	}
+
+	//Level 0 is the full size, though the file stores the smallest first.
+	//No more than a full chain, as for DDS.
+	const uint32_t mipCount = std::min(std::max(1u, header.levelCount), gpu::MipCount(out.extent));
+	if (size < sizeof(header) + mipCount * sizeof(Ktx2Level)) {
+		errorF("KTX2 file too small!");
+		out = {};
+		return 0;
+	}
+
+	for (uint32_t level = 0; level < mipCount; level++) {
+		Ktx2Level entry;
+		std::memcpy(&entry, data + sizeof(header) + level * sizeof(Ktx2Level), sizeof(entry));
+
+		TextureMip mip;
+		mip.extent = MipExtent(out.extent, level);
+		mip.offset = static_cast<size_t>(entry.byteOffset);
+		mip.size = MipSize(out.format, mip.extent);
+
+		if (entry.byteLength != mip.size || entry.byteOffset + entry.byteLength > size) {
+			errorF("KTX2 mip %u is corrupt!", level);
+			out = {};
+			return 0;
+		}
+
+		out.mips.push_back(mip);
+	}
+
+	return 1;
+}
+
+int tex::Parse(const char* data, size_t size, TextureFile& out)
+{
+	if (size >= sizeof(kKtx2Identifier) && std::memcmp(data, kKtx2Identifier, sizeof(kKtx2Identifier)) == 0) {
+		return ParseKtx2(data, size, out);
+	}
+	return ParseDds(data, size, out);
+}
+
+bool tex::WriteDds(const std::string& filename, VkFormat format, VkExtent2D extent, const std::vector<std::vector<char>>& mips)
+{
+	const uint32_t dxgiFormat = ToDxgi(format);
+	if (dxgiFormat == 0 || mips.empty()) {
+		errorF("tex::WriteDds() - DDS can't hold the format of %s", filename.c_str());
+		return false;
+	}
+
+	DdsHeader header = {};
+	header.size = sizeof(DdsHeader);
+	header.flags = kDdsFlagCaps | kDdsFlagHeight | kDdsFlagWidth | kDdsFlagPixelFormat | kDdsFlagMipCount | kDdsFlagLinearSize;
+	header.height = extent.height;
+	header.width = extent.width;
+	header.pitchOrLinearSize = static_cast<uint32_t>(mips[0].size());
+	header.mipMapCount = static_cast<uint32_t>(mips.size());
+	header.pixelFormat.size = sizeof(DdsPixelFormat);
+	header.pixelFormat.flags = kDdsPixelFourCC;
+	header.pixelFormat.fourCC = kDdsFourCCDX10;
+	header.caps = kDdsCapsTexture | (mips.size() > 1 ? kDdsCapsComplex | kDdsCapsMipMap : 0);
+
+	DdsHeaderDX10 dx10 = {};
+	dx10.dxgiFormat = dxgiFormat;
+	dx10.resourceDimension = kDxgiTexture2D;
+	dx10.arraySize = 1;
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		errorF("tex::WriteDds() - failed to open %s for writing", filename.c_str());
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&kDdsMagic), sizeof(kDdsMagic));
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(&dx10), sizeof(dx10));
+	for (const auto& mip : mips) {
+		file.write(mip.data(), mip.size());
+	}
+
+	if (!file) {
+		errorF("tex::WriteDds() - failed writing %s", filename.c_str());
+		return false;
+	}
+	return true;
+}
+
+FormatBlock tex::GetFormatBlock(VkFormat format)
+{
+	switch (format) {
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+		return { 4, 1, 1 };
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC4_SNORM_BLOCK:
+		return { 8, 4, 4 };
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC5_SNORM_BLOCK:
+	case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+	case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		return { 16, 4, 4 };
+	default:
+		return { 0, 1, 1 };
+	}
+}
+
+size_t tex::MipSize(VkFormat format, VkExtent2D extent)
+{
+	const FormatBlock block = GetFormatBlock(format);
+	const size_t blocksWide = (extent.width + block.width - 1) / block.width;
+	const size_t blocksHigh = (extent.height + block.height - 1) / block.height;
+	return blocksWide * blocksHigh * block.bytes;
+}
+
+VkExtent2D tex::MipExtent(VkExtent2D extent, uint32_t level)
+{
+	return { std::max(1u, extent.width >> level), std::max(1u, extent.height >> level) };
+}
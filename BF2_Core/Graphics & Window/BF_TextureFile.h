@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//One level's tightly packed texels within the file
+struct TextureMip {
+	size_t offset;
+	size_t size;
+	VkExtent2D extent;
+};
+
+//Layout of a 2D texture file, finest mip first - the texels stay in the file's bytes
+struct TextureFile {
+	VkFormat format;
+	VkExtent2D extent;
+	std::vector<TextureMip> mips;
+};
+
+//Texel block of a format - 1x1 for plain formats, 4x4 for BCn, bytes 0 if it isn't handled
+struct FormatBlock {
+	uint32_t bytes;
+	uint32_t width;
+	uint32_t height;
+};
+
+namespace tex {
+	//DDS with a single 2D surface and its mips - 32 bit RGBA/BGRA or BC1-7
+	//(legacy header with DXTn/ATIn FourCCs, or DX10 header)
+	int ParseDds(const char* data, size_t size, TextureFile& out);
+
+	//KTX2 with a single 2D surface and its mips, same formats, no supercompression
+	int ParseKtx2(const char* data, size_t size, TextureFile& out);
+
+	//Either of the above, told apart by the file's magic
+	int Parse(const char* data, size_t size, TextureFile& out);
+
+	//DDS with a DX10 header, mips finest first and already in format's layout
+	bool WriteDds(const std::string& filename, VkFormat format, VkExtent2D extent, const std::vector<std::vector<char>>& mips);
+
+	FormatBlock GetFormatBlock(VkFormat);
+
+	//Bytes of one level, whole blocks
+	size_t MipSize(VkFormat, VkExtent2D);
+
+	//Level extent, never below 1
+	VkExtent2D MipExtent(VkExtent2D, uint32_t level);
+}
@@ -0,0 +1,557 @@
+#include "BF_TextureStreamer.h"
+#include "../Utils/BF_AsyncIO.h"
+#include "../Utils/BF_Consts.h"
+#include "../Utils/BF_Error.h"
+#include "../Utils/BF_Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+//Levels with no edge longer than this are the tail - loaded first, never evicted
+static constexpr uint32_t kTextureTailSize = 64;
+
+//Staging offsets - covers the texel block size of every format handled
+static constexpr VkDeviceSize kStagingAlignment = 16;
+
+TextureStreamer::TextureStreamer() : m_physDevice(VK_NULL_HANDLE), m_device(VK_NULL_HANDLE), m_pAllocator(nullptr),
+	m_queue(VK_NULL_HANDLE), m_io(nullptr), m_commandPool(VK_NULL_HANDLE), m_cmd(VK_NULL_HANDLE), m_fence(VK_NULL_HANDLE),
+	m_recording(false), m_inFlight(false), m_staging{}, m_stagingUsed(0), m_fallback{}, m_residentBytes(0), m_streamedBytes(0), m_frame(1)
+{
+}
+
+int TextureStreamer::init(VkPhysicalDevice physDevice, VkDevice device, const VkAllocationCallbacks* pAllocator, uint32_t queueFamily, VkQueue queue, IOService& io)
+{
+	m_physDevice = physDevice;
+	m_device = device;
+	m_pAllocator = pAllocator;
+	m_queue = queue;
+	m_io = &io;
+
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = queueFamily;
+
+	if (vkCreateCommandPool(m_device, &poolInfo, m_pAllocator, &m_commandPool) != VK_SUCCESS) {
+		errorF("Failed to create texture upload command pool!");
+		return 0;
+	}
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = m_commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+
+	if (vkAllocateCommandBuffers(m_device, &allocInfo, &m_cmd) != VK_SUCCESS) {
+		errorF("Failed to allocate texture upload command buffer!");
+		return 0;
+	}
+
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	if (vkCreateFence(m_device, &fenceInfo, m_pAllocator, &m_fence) != VK_SUCCESS) {
+		errorF("Failed to create texture upload fence!");
+		return 0;
+	}
+
+	if (!gpu::CreateBuffer(m_physDevice, m_device, m_pAllocator, kTextureStagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_staging)) {
+		return 0;
+	}
+
+	return createFallback();
+}
+
+void TextureStreamer::shutdown()
+{
+	if (m_inFlight) {
+		vkWaitForFences(m_device, 1, &m_fence, VK_TRUE, UINT64_MAX);
+		m_inFlight = false;
+	}
+
+	for (auto& image : m_retired) {
+		gpu::DestroyImage(m_device, m_pAllocator, image);
+	}
+	m_retired.clear();
+
+	for (auto& texture : m_textures) {
+		gpu::DestroyImage(m_device, m_pAllocator, texture.image);
+	}
+	m_textures.clear();
+
+	gpu::DestroyImage(m_device, m_pAllocator, m_fallback);
+	gpu::DestroyBuffer(m_device, m_pAllocator, m_staging);
+
+	if (m_fence != VK_NULL_HANDLE) {
+		vkDestroyFence(m_device, m_fence, m_pAllocator);
+		m_fence = VK_NULL_HANDLE;
+	}
+	if (m_commandPool != VK_NULL_HANDLE) {
+		vkDestroyCommandPool(m_device, m_commandPool, m_pAllocator);
+		m_commandPool = VK_NULL_HANDLE;
+		m_cmd = VK_NULL_HANDLE;
+	}
+
+	m_residentBytes = 0;
+	m_streamedBytes = 0;
+}
+
+TextureHandle TextureStreamer::load(const std::string& filename)
+{
+	const TextureHandle handle = static_cast<TextureHandle>(m_textures.size());
+
+	Texture texture = {};
+	texture.filename = filename;
+	texture.budgetMip = kNotResident;
+	m_textures.push_back(std::move(texture));
+
+	requestRead(handle);
+	return handle;
+}
+
+void TextureStreamer::requestSize(TextureHandle handle, float pixels)
+{
+	Texture& texture = m_textures[handle];
+
+	uint32_t mip = 0;
+	if (texture.hasFile) {
+		//The level whose texels map about 1:1 onto the pixels covered
+		const float size = static_cast<float>(std::max(texture.file.extent.width, texture.file.extent.height));
+		const float ratio = size / std::max(pixels, 1.0f);
+		mip = ratio > 1.0f ? static_cast<uint32_t>(std::floor(std::log2(ratio))) : 0;
+		mip = std::max(std::min(mip, texture.tailMip), texture.finestMip);
+	}
+
+	texture.wantedMip = texture.lastUsedFrame == m_frame ? std::min(texture.wantedMip, mip) : mip;
+	texture.lastUsedFrame = m_frame;
+}
+
+void TextureStreamer::update()
+{
+	BF_PROFILE_ZONE("TextureStreamer::update");
+
+	//Last frame's batch done - its staging space and the images copied out of are free
+	if (m_inFlight) {
+		vkWaitForFences(m_device, 1, &m_fence, VK_TRUE, UINT64_MAX);
+		vkResetFences(m_device, 1, &m_fence);
+		m_inFlight = false;
+
+		for (auto& image : m_retired) {
+			gpu::DestroyImage(m_device, m_pAllocator, image);
+		}
+		m_retired.clear();
+	}
+	m_stagingUsed = 0;
+
+	//Not drawn this frame - wants only its tail again, the rest is makeRoom's to take
+	for (auto& texture : m_textures) {
+		if (texture.hasFile && texture.lastUsedFrame != m_frame) {
+			texture.wantedMip = texture.tailMip;
+		}
+	}
+
+	//What the budget could give back, for textures it stopped short
+	VkDeviceSize reclaimable = 0;
+	for (const auto& texture : m_textures) {
+		if (texture.hasFile && texture.residentMip < texture.tailMip) {
+			reclaimable += streamedBytes(texture, texture.residentMip) - streamedBytes(texture, std::max(texture.residentMip, evictFloor(texture)));
+		}
+	}
+
+	//Read again whatever drawn this frame wants finer levels than it holds
+	std::vector<TextureHandle> ready;
+	for (TextureHandle handle = 0; handle < m_textures.size(); handle++) {
+		Texture& texture = m_textures[handle];
+		if (!texture.hasFile || texture.failed) continue;
+
+		if (!texture.data.empty()) {
+			ready.push_back(handle);
+		}
+		else if (texture.wantedMip < texture.residentMip && !texture.loading &&
+			(texture.budgetMip != texture.residentMip || budgetHasRoom(texture, reclaimable))) {
+			requestRead(handle);
+		}
+	}
+
+	//Most recently drawn first, the staging space runs out on whatever was drawn least
+	std::sort(ready.begin(), ready.end(), [this](TextureHandle a, TextureHandle b) {
+		return m_textures[a].lastUsedFrame > m_textures[b].lastUsedFrame;
+	});
+
+	for (TextureHandle handle : ready) {
+		Texture& texture = m_textures[handle];
+
+		uint32_t target = std::min(texture.wantedMip, texture.tailMip);
+		if (target >= texture.residentMip) {
+			texture.data.clear();
+			continue;
+		}
+
+		//Coarsest levels first when the staging space can't take them all
+		auto uploadBytes = [&](uint32_t mip) {
+			VkDeviceSize bytes = 0;
+			for (uint32_t level = mip; level < texture.residentMip; level++) {
+				bytes += (tex::MipSize(texture.file.format, texture.file.mips[level].extent) + kStagingAlignment - 1) & ~(kStagingAlignment - 1);
+			}
+			return bytes;
+		};
+		while (target < texture.residentMip && m_stagingUsed + uploadBytes(target) > m_staging.size) {
+			target++;
+		}
+		if (target >= texture.residentMip) continue;
+
+		//Only levels finer than the tail count against the budget
+		const VkDeviceSize growth = streamedBytes(texture, target) - streamedBytes(texture, texture.residentMip);
+		bool budgetLimited = false;
+		if (growth > 0 && m_streamedBytes + growth > kTextureMemoryBudget && !makeRoom(growth, &texture)) {
+			budgetLimited = true;
+			while (target < texture.tailMip && m_streamedBytes + streamedBytes(texture, target) - streamedBytes(texture, texture.residentMip) > kTextureMemoryBudget) {
+				target++;
+			}
+			if (target >= texture.residentMip) {
+				texture.budgetMip = texture.residentMip;
+				texture.data.clear();
+				continue;
+			}
+		}
+
+		if (!reallocate(texture, target)) {
+			texture.failed = true;
+			texture.data.clear();
+			continue;
+		}
+
+		if (budgetLimited) {
+			texture.budgetMip = texture.residentMip;
+		}
+
+		//Kept while staging alone held it back, the rest of the levels go next frame
+		if (texture.residentMip <= texture.wantedMip || budgetLimited) {
+			texture.data.clear();
+		}
+	}
+
+	submitBatch();
+	m_frame++;
+}
+
+const VkImageView TextureStreamer::getView(TextureHandle handle) const
+{
+	const VkImageView view = m_textures[handle].image.view;
+	return view != VK_NULL_HANDLE ? view : m_fallback.view;
+}
+
+const uint32_t TextureStreamer::getResidentMip(TextureHandle handle) const
+{
+	const Texture& texture = m_textures[handle];
+	return texture.image.image != VK_NULL_HANDLE ? texture.residentMip : kNotResident;
+}
+
+const VkDeviceSize TextureStreamer::getResidentBytes() const
+{
+	return m_residentBytes;
+}
+
+int TextureStreamer::reallocate(Texture& texture, uint32_t mip)
+{
+	const uint32_t count = static_cast<uint32_t>(texture.file.mips.size());
+
+	GpuImage image;
+	if (!gpu::CreateImage2D(m_physDevice, m_device, m_pAllocator, texture.file.mips[mip].extent, count - mip, texture.file.format,
+		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, image)) {
+		errorF("Failed to allocate mips %u+ of %s!", mip, texture.filename.c_str());
+		return 0;
+	}
+
+	beginBatch();
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image.image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, image.mipLevels, 0, 1 };
+
+	vkCmdPipelineBarrier(m_cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	//Levels resident before and after come across from the old image
+	const uint32_t keptFirst = std::max(mip, texture.residentMip);
+	if (texture.image.image != VK_NULL_HANDLE && keptFirst < count) {
+		//Only has to wait for last frame's sampling, nothing was written
+		VkImageMemoryBarrier source = barrier;
+		source.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		source.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		source.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		source.image = texture.image.image;
+		source.subresourceRange.levelCount = texture.image.mipLevels;
+
+		vkCmdPipelineBarrier(m_cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &source);
+
+		std::vector<VkImageCopy> copies;
+		for (uint32_t level = keptFirst; level < count; level++) {
+			const VkExtent2D extent = texture.file.mips[level].extent;
+
+			VkImageCopy copy = {};
+			copy.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - texture.residentMip, 0, 1 };
+			copy.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - mip, 0, 1 };
+			copy.extent = { extent.width, extent.height, 1 };
+			copies.push_back(copy);
+		}
+
+		vkCmdCopyImage(m_cmd, texture.image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(copies.size()), copies.data());
+	}
+
+	//Levels new to the GPU come from the file through staging
+	if (mip < texture.residentMip) {
+		std::vector<VkBufferImageCopy> regions;
+		for (uint32_t level = mip; level < std::min(texture.residentMip, count); level++) {
+			const TextureMip& source = texture.file.mips[level];
+
+			std::memcpy(static_cast<char*>(m_staging.mapped) + m_stagingUsed, texture.data.data() + source.offset, source.size);
+
+			VkBufferImageCopy region = {};
+			region.bufferOffset = m_stagingUsed;
+			region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - mip, 0, 1 };
+			region.imageExtent = { source.extent.width, source.extent.height, 1 };
+			regions.push_back(region);
+
+			m_stagingUsed += (source.size + kStagingAlignment - 1) & ~(kStagingAlignment - 1);
+		}
+
+		vkCmdCopyBufferToImage(m_cmd, m_staging.buffer, image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(regions.size()), regions.data());
+	}
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	vkCmdPipelineBarrier(m_cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	//Old image lives until the batch copying out of it is done
+	if (texture.image.image != VK_NULL_HANDLE) {
+		m_retired.push_back(texture.image);
+	}
+
+	m_residentBytes += chainBytes(texture, mip);
+	m_residentBytes -= chainBytes(texture, texture.residentMip);
+	m_streamedBytes += streamedBytes(texture, mip);
+	m_streamedBytes -= streamedBytes(texture, texture.residentMip);
+
+	texture.image = image;
+	texture.residentMip = mip;
+
+	return 1;
+}
+
+bool TextureStreamer::makeRoom(VkDeviceSize bytes, const Texture* keep)
+{
+	//Least recently drawn first. What was drawn this frame only gives up levels
+	//finer than it asked for, the rest fall back to their tails.
+	std::vector<Texture*> candidates;
+	for (auto& texture : m_textures) {
+		if (&texture != keep && texture.residentMip < texture.tailMip) {
+			candidates.push_back(&texture);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const Texture* a, const Texture* b) {
+		return a->lastUsedFrame < b->lastUsedFrame;
+	});
+
+	for (Texture* texture : candidates) {
+		if (m_streamedBytes + bytes <= kTextureMemoryBudget) break;
+
+		const uint32_t floor = evictFloor(*texture);
+		if (floor <= texture->residentMip) continue;
+
+		//Just enough levels off to fit, or down to the floor
+		uint32_t mip = texture->residentMip + 1;
+		const VkDeviceSize current = chainBytes(*texture, texture->residentMip);
+		while (mip < floor && m_streamedBytes - (current - chainBytes(*texture, mip)) + bytes > kTextureMemoryBudget) {
+			mip++;
+		}
+
+		reallocate(*texture, mip);
+	}
+
+	return m_streamedBytes + bytes <= kTextureMemoryBudget;
+}
+
+uint32_t TextureStreamer::evictFloor(const Texture& texture) const
+{
+	return texture.lastUsedFrame == m_frame ? std::min(texture.wantedMip, texture.tailMip) : texture.tailMip;
+}
+
+bool TextureStreamer::budgetHasRoom(const Texture& texture, VkDeviceSize reclaimable) const
+{
+	const VkDeviceSize growth = streamedBytes(texture, texture.residentMip - 1) - streamedBytes(texture, texture.residentMip);
+	return m_streamedBytes + growth <= kTextureMemoryBudget + reclaimable;
+}
+
+VkDeviceSize TextureStreamer::chainBytes(const Texture& texture, uint32_t mip) const
+{
+	//The file's packed sizes - the driver's allocations run a little over
+	VkDeviceSize bytes = 0;
+	for (uint32_t level = mip; level < texture.file.mips.size(); level++) {
+		bytes += texture.file.mips[level].size;
+	}
+	return bytes;
+}
+
+VkDeviceSize TextureStreamer::streamedBytes(const Texture& texture, uint32_t mip) const
+{
+	return mip < texture.tailMip ? chainBytes(texture, mip) - chainBytes(texture, texture.tailMip) : 0;
+}
+
+void TextureStreamer::requestRead(TextureHandle handle)
+{
+	m_textures[handle].loading = true;
+
+	//Callbacks run from IOService::pump on the main thread, between updates
+	m_io->readAsync(m_textures[handle].filename, [this, handle](bool ok, std::vector<char>&& data) {
+		if (handle >= m_textures.size()) return;
+
+		Texture& texture = m_textures[handle];
+		texture.loading = false;
+
+		if (!ok) {
+			errorF("Failed to read texture %s!", texture.filename.c_str());
+			texture.failed = true;
+			return;
+		}
+
+		TextureFile file;
+		if (!tex::Parse(data.data(), data.size(), file)) {
+			errorF("Failed to parse texture %s!", texture.filename.c_str());
+			texture.failed = true;
+			return;
+		}
+
+		//Block compressed levels go up as they are, so the device has to sample them
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(m_physDevice, file.format, &properties);
+		if (!(properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+			errorF("Texture %s is in a format this device can't sample!", texture.filename.c_str());
+			texture.failed = true;
+			return;
+		}
+
+		if (!texture.hasFile) {
+			texture.file = file;
+			texture.hasFile = true;
+
+			const uint32_t count = static_cast<uint32_t>(file.mips.size());
+			texture.residentMip = count;
+			texture.tailMip = count - 1;
+			for (uint32_t level = 0; level < count; level++) {
+				if (std::max(file.mips[level].extent.width, file.mips[level].extent.height) <= kTextureTailSize) {
+					texture.tailMip = level;
+					break;
+				}
+			}
+			texture.wantedMip = texture.tailMip;
+
+			//A level bigger than the whole staging buffer could never be uploaded
+			texture.finestMip = 0;
+			while (texture.finestMip < texture.tailMip && file.mips[texture.finestMip].size > kTextureStagingSize) {
+				texture.finestMip++;
+			}
+			if (texture.finestMip > 0) {
+				errorF("Texture %s levels finer than %u don't fit the staging buffer and won't stream", texture.filename.c_str(), texture.finestMip);
+			}
+		}
+		else if (file.format != texture.file.format || file.mips.size() != texture.file.mips.size() ||
+			file.extent.width != texture.file.extent.width || file.extent.height != texture.file.extent.height) {
+			errorF("Texture %s changed on disk, keeping what is resident", texture.filename.c_str());
+			return;
+		}
+
+		texture.data = std::move(data);
+	});
+}
+
+int TextureStreamer::createFallback()
+{
+	if (!gpu::CreateImage2D(m_physDevice, m_device, m_pAllocator, { 1, 1 }, 1, VK_FORMAT_R8G8B8A8_UNORM,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, m_fallback)) {
+		return 0;
+	}
+
+	const uint32_t white = 0xffffffff;
+	std::memcpy(m_staging.mapped, &white, sizeof(white));
+
+	beginBatch();
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = m_fallback.image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	vkCmdPipelineBarrier(m_cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy region = {};
+	region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.imageExtent = { 1, 1, 1 };
+	vkCmdCopyBufferToImage(m_cmd, m_staging.buffer, m_fallback.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	vkCmdPipelineBarrier(m_cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	//Done once at init, so just wait for it
+	submitBatch();
+	vkWaitForFences(m_device, 1, &m_fence, VK_TRUE, UINT64_MAX);
+	vkResetFences(m_device, 1, &m_fence);
+	m_inFlight = false;
+
+	return 1;
+}
+
+void TextureStreamer::beginBatch()
+{
+	if (m_recording) return;
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(m_cmd, &beginInfo);
+	m_recording = true;
+}
+
+void TextureStreamer::submitBatch()
+{
+	if (!m_recording) return;
+
+	vkEndCommandBuffer(m_cmd);
+	m_recording = false;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &m_cmd;
+
+	if (vkQueueSubmit(m_queue, 1, &submitInfo, m_fence) != VK_SUCCESS) {
+		errorF("Failed to submit texture uploads!");
+		return;
+	}
+	m_inFlight = true;
+}
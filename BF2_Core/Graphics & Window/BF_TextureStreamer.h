@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BF_GpuBuffer.h"
+#include "BF_GpuImage.h"
+#include "BF_TextureFile.h"
+
+class IOService;
+
+using TextureHandle = uint32_t;
+
+//Streams texture mips in by on-screen demand under a device memory budget.
+//A texture starts with only its mip tail (levels kTextureTailSize and under);
+//finer levels load once something draws it big enough to need them. Each
+//texture's image holds one contiguous run of levels, so a change of residency
+//reallocates it - the kept levels are copied across on the GPU and only the
+//new ones come from the file. Past the budget, the least recently drawn
+//textures give up their finest levels first.
+class TextureStreamer {
+public:
+	TextureStreamer();
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	int init(VkPhysicalDevice, VkDevice, const VkAllocationCallbacks*, uint32_t queueFamily, VkQueue, IOService&);
+	void shutdown();
+
+	//Starts reading the file, its mip tail is resident a frame or two later
+	TextureHandle load(const std::string& filename);
+
+	//Report each frame the texture is drawn - pixels is the on-screen size its
+	//full extent would cover. The largest report in a frame wins.
+	void requestSize(TextureHandle, float pixels);
+
+	//Once per frame - retires last frame's copies, then evicts and uploads
+	void update();
+
+	//Whole resident chain in SHADER_READ_ONLY_OPTIMAL, a white texel until the tail arrives.
+	//Changes when residency does, so fetch it each frame.
+	const VkImageView getView(TextureHandle) const;
+
+	//Finest level resident, 0 being the file's full size - kNotResident before the tail arrives
+	static constexpr uint32_t kNotResident = UINT32_MAX;
+	const uint32_t getResidentMip(TextureHandle) const;
+
+	const VkDeviceSize getResidentBytes() const;
+
+private:
+	struct Texture {
+		std::string filename;
+		TextureFile file;
+		std::vector<char> data;		//file bytes, held only between a read and its upload
+
+		GpuImage image;				//levels [residentMip, mip count)
+		uint32_t residentMip;
+		uint32_t wantedMip;
+		uint32_t tailMip;			//first level kTextureTailSize or smaller - never evicted
+		uint32_t finestMip;			//finest level the staging buffer can take - never wanted past it
+		uint32_t budgetMip;			//where the budget last stopped it, kNotResident if it hasn't
+		uint64_t lastUsedFrame;
+
+		bool hasFile;				//file header parsed
+		bool loading;
+		bool failed;
+	};
+
+	//Recreates the texture's image holding [mip, count) - copies what stays
+	//resident, uploads the rest from its data. Records into m_cmd.
+	int reallocate(Texture&, uint32_t mip);
+
+	//Trims least recently used textures until bytes more fit, never touching keep
+	bool makeRoom(VkDeviceSize bytes, const Texture* keep);
+
+	//Coarsest level makeRoom may trim the texture to
+	uint32_t evictFloor(const Texture&) const;
+
+	//Budget stopped it at what it holds - worth reading again only once its next
+	//level fits, counting what makeRoom could take back from the rest
+	bool budgetHasRoom(const Texture&, VkDeviceSize reclaimable) const;
+
+	VkDeviceSize chainBytes(const Texture&, uint32_t mip) const;
+	VkDeviceSize streamedBytes(const Texture&, uint32_t mip) const;	//the part of chainBytes finer than the tail
+	void requestRead(TextureHandle);
+	int createFallback();
+
+	void beginBatch();
+	void submitBatch();
+
+	VkPhysicalDevice				m_physDevice;
+	VkDevice						m_device;
+	const VkAllocationCallbacks*	m_pAllocator;
+	VkQueue							m_queue;
+	IOService*						m_io;
+
+	//One batch of copies in flight, retired at the start of the next update
+	VkCommandPool		m_commandPool;
+	VkCommandBuffer		m_cmd;
+	VkFence				m_fence;
+	bool				m_recording;
+	bool				m_inFlight;
+
+	GpuBuffer			m_staging;
+	VkDeviceSize		m_stagingUsed;
+
+	//Images replaced this frame, destroyed once the copies out of them finish
+	std::vector<GpuImage> m_retired;
+
+	std::vector<Texture> m_textures;
+	GpuImage			m_fallback;
+
+	VkDeviceSize		m_residentBytes;
+	VkDeviceSize		m_streamedBytes;		//the part finer than the tails, held to kTextureMemoryBudget
+	uint64_t			m_frame;
+};
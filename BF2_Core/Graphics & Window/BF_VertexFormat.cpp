@@ -0,0 +1,130 @@
+#include "BF_VertexFormat.h"
+#include "../Utils/BF_Error.h"
+#include "../Utils/BF_Vertex_Pos3Col3Uv2.h"
+#include "../Utils/BF_Vertex_Pos4hCol4Uv2h.h"
+#include "../Utils/BF_Vertex_Pos4sNrm2sUv2h.h"
+
+#include <cstddef>
+
+namespace {
+	//How one input location is stored
+	struct Attribute {
+		uint32_t location;
+		VkFormat format;
+		uint32_t offset;
+		bool integer;
+	};
+
+	struct FormatInfo {
+		const char* name;
+		uint32_t stride;
+		std::vector<Attribute> attributes;
+	};
+
+	//Straight from the vertex type's compile time layout
+	template<typename Vertex>
+	FormatInfo makeInfo(const char* name)
+	{
+		using Layout = typename Vertex::Layout;
+
+		FormatInfo info = { name, Layout::kStride, {} };
+		for (size_t i = 0; i < Layout::kCount; i++) {
+			info.attributes.push_back({ Layout::kLocations[i], Layout::kFormats[i], Layout::kOffsets[i], Layout::kInteger[i] });
+		}
+		return info;
+	}
+
+	const FormatInfo& getInfo(VertexFormat format)
+	{
+		static const FormatInfo s_formats[] = {
+			makeInfo<Vertex_Pos3Col3Uv2>("Pos3Col3Uv2"),
+			makeInfo<Vertex_Pos4hCol4Uv2h>("Pos4hCol4Uv2h"),
+			makeInfo<Vertex_Pos4sNrm2sUv2h>("Pos4sNrm2sUv2h"),
+		};
+		static_assert(sizeof(s_formats) / sizeof(s_formats[0]) == static_cast<size_t>(VertexFormat::Count), "a VertexFormat is missing its layout");
+
+		return s_formats[static_cast<uint32_t>(format)];
+	}
+
+	//Reflected shader inputs are only ever 32 bit int/uint/float
+	bool isIntegerInput(VkFormat format)
+	{
+		switch (format) {
+		case VK_FORMAT_R32_SINT: case VK_FORMAT_R32G32_SINT: case VK_FORMAT_R32G32B32_SINT: case VK_FORMAT_R32G32B32A32_SINT:
+		case VK_FORMAT_R32_UINT: case VK_FORMAT_R32G32_UINT: case VK_FORMAT_R32G32B32_UINT: case VK_FORMAT_R32G32B32A32_UINT:
+			return true;
+		default:
+			return false;
+		}
+	}
+}
+
+const char* vertex::GetFormatName(VertexFormat format)
+{
+	return getInfo(format).name;
+}
+
+const uint32_t vertex::GetStride(VertexFormat format)
+{
+	return getInfo(format).stride;
+}
+
+const bool vertex::HasColour(VertexFormat format)
+{
+	for (const auto& attribute : getInfo(format).attributes) {
+		if (attribute.location == 1) return true;
+	}
+	return false;
+}
+
+std::vector<std::string> vertex::GetShaderDefines(VertexFormat format)
+{
+	std::vector<std::string> defines;
+
+	if (!HasColour(format)) {
+		defines.push_back("NO_VERTEX_COLOUR");
+	}
+
+	return defines;
+}
+
+VertexInputDesc vertex::BuildInput(VertexFormat format, const ShaderReflection& vertexStage, uint32_t binding)
+{
+	const FormatInfo& info = getInfo(format);
+
+	VertexInputDesc desc = {};
+	desc.binding.binding = binding;
+	desc.binding.stride = info.stride;
+	desc.binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	//Only what the shader reads - a stored normal is skipped by unlit shaders
+	for (const auto& input : vertexStage.inputs) {
+		const Attribute* found = nullptr;
+		for (const auto& attribute : info.attributes) {
+			if (attribute.location == input.location) {
+				found = &attribute;
+				break;
+			}
+		}
+
+		if (!found) {
+			errorF("vertex::BuildInput() - %s has nothing for shader input location %u", info.name, input.location);
+			continue;
+		}
+
+		//Normalized/float data can't feed an int input, nor the other way round
+		if (found->integer != isIntegerInput(input.format)) {
+			errorF("vertex::BuildInput() - %s location %u is %s, the shader reads %s", info.name, input.location,
+				found->integer ? "integer" : "float", isIntegerInput(input.format) ? "integer" : "float");
+		}
+
+		VkVertexInputAttributeDescription attribute = {};
+		attribute.binding = binding;
+		attribute.location = found->location;
+		attribute.format = found->format;
+		attribute.offset = found->offset;
+		desc.attributes.push_back(attribute);
+	}
+
+	return desc;
+}
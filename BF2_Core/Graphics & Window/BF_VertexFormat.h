@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BF_ShaderReflection.h"
+
+//Vertex layouts a mesh can be stored in, chosen per mesh. Each shader input
+//location has a fixed meaning (0 position, 1 colour, 2 uv, 3 normal) - the
+//format says how that location is stored, the shader sees floats either way.
+enum class VertexFormat : uint32_t {
+	Pos3Col3Uv2,		//32 bytes, all float
+	Pos4hCol4Uv2h,		//16 bytes, half position and uv, RGBA8 colour
+	Pos4sNrm2sUv2h,		//16 bytes, snorm position (dequantized by the model matrix), octahedral normal, half uv
+
+	Count
+};
+
+namespace vertex {
+	const char* GetFormatName(VertexFormat);
+	const uint32_t GetStride(VertexFormat);
+	const bool HasColour(VertexFormat);
+
+	//Vertex shader defines for a format - inputs it doesn't store are compiled out
+	std::vector<std::string> GetShaderDefines(VertexFormat);
+
+	//Attributes for every input the vertex shader declares, stored as format
+	//describes. Inputs the format doesn't have are reported and left out.
+	VertexInputDesc BuildInput(VertexFormat, const ShaderReflection& vertexStage, uint32_t binding = 0);
+}
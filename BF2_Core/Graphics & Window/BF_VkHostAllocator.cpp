@@ -0,0 +1,298 @@
+#include "BF_VkHostAllocator.h"
+#include "../Utils/BF_Consts.h"
+#include "../Utils/BF_Error.h"
+#include "../Utils/BF_MemTrack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+static constexpr uint32_t kScopeCount = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+static constexpr uint8_t kHeapClass = 0xFF;
+
+//Largest alignment a pool guarantees, above this requests go to the heap
+static constexpr size_t kMaxPoolAlignment = 64;
+static constexpr size_t kPoolChunkBytes = 64 * 1024;
+
+static const char* const kScopeNames[kScopeCount] = { "Command", "Object", "Cache", "Device", "Instance" };
+
+namespace {
+	//Directly in front of every block handed to the driver - pfnFree only gives us the pointer
+	struct BlockHeader {
+		uint64_t size;
+		uint32_t offset;		//back to the start of the block, also its alignment
+		uint8_t sizeClass;
+		uint8_t scope;
+		uint8_t pad[2];
+	};
+
+	static_assert(sizeof(BlockHeader) == 16, "BlockHeader must stay 16 bytes");
+
+	size_t classSize(uint32_t sizeClass)
+	{
+		return kVkHostSmallestClass << sizeClass;
+	}
+
+	size_t classAlignment(uint32_t sizeClass)
+	{
+		return std::min(classSize(sizeClass), kMaxPoolAlignment);
+	}
+
+	BlockHeader* headerOf(void* p)
+	{
+		return static_cast<BlockHeader*>(p) - 1;
+	}
+}
+
+void VkHostAllocator::addLive(Counters & counters, size_t size)
+{
+	const size_t live = counters.live.fetch_add(size) + size;
+
+	size_t peak = counters.peak.load();
+	while (live > peak && !counters.peak.compare_exchange_weak(peak, live)) {
+	}
+}
+
+VkHostAllocator::VkHostAllocator() : m_callbacks{}, m_initialised(false)
+{
+	for (auto& counters : m_counters) {
+		counters.live = 0;
+		counters.peak = 0;
+		counters.count = 0;
+		counters.total = 0;
+		counters.reallocs = 0;
+		counters.internal = 0;
+	}
+}
+
+void VkHostAllocator::init()
+{
+	for (uint32_t i = 0; i < kVkHostSizeClasses; i++) {
+		const size_t size = classSize(i);
+		m_classes[i].pool = std::make_unique<mem::Pool>(size, std::max<size_t>(kPoolChunkBytes / size, 16), classAlignment(i));
+	}
+
+	m_callbacks.pUserData = this;
+	m_callbacks.pfnAllocation = &VkHostAllocator::allocation;
+	m_callbacks.pfnReallocation = &VkHostAllocator::reallocation;
+	m_callbacks.pfnFree = &VkHostAllocator::free;
+	m_callbacks.pfnInternalAllocation = &VkHostAllocator::internalAllocation;
+	m_callbacks.pfnInternalFree = &VkHostAllocator::internalFree;
+
+	m_initialised = true;
+}
+
+void VkHostAllocator::shutdown()
+{
+	if (!m_initialised) return;
+
+	//Everything should have been handed back by vkDestroyInstance
+	for (uint32_t i = 0; i < kScopeCount; i++) {
+		const size_t count = m_counters[i].count.load();
+		if (count > 0) {
+			errorF("VkHostAllocator - %llu %s scope allocations (%llu bytes) still live at shutdown", static_cast<unsigned long long>(count),
+				kScopeNames[i], static_cast<unsigned long long>(m_counters[i].live.load()));
+		}
+	}
+
+	for (auto& sizeClass : m_classes) {
+		sizeClass.pool.reset();
+	}
+
+	m_initialised = false;
+}
+
+const VkAllocationCallbacks * VkHostAllocator::getCallbacks() const
+{
+	return (m_initialised && kUseVkHostAllocator) ? &m_callbacks : nullptr;
+}
+
+VkHostAllocator::ScopeStats VkHostAllocator::getScopeStats(VkSystemAllocationScope scope) const
+{
+	const Counters& counters = m_counters[scope];
+
+	ScopeStats stats = {};
+	stats.liveBytes = counters.live.load();
+	stats.peakBytes = counters.peak.load();
+	stats.liveAllocations = counters.count.load();
+	stats.totalAllocations = counters.total.load();
+	stats.reallocations = counters.reallocs.load();
+	stats.internalBytes = counters.internal.load();
+
+	return stats;
+}
+
+VkHostAllocator::PoolStats VkHostAllocator::getPoolStats(uint32_t sizeClass) const
+{
+	PoolStats stats = {};
+	stats.elementSize = classSize(sizeClass);
+
+	const SizeClass& entry = m_classes[sizeClass];
+	std::lock_guard<std::mutex> lock(entry.mutex);
+
+	if (entry.pool) {
+		stats.liveElements = entry.pool->getLiveCount();
+		stats.reservedBytes = entry.pool->getReservedBytes();
+	}
+
+	return stats;
+}
+
+void VkHostAllocator::report() const
+{
+	debugF("Vulkan host memory by scope:");
+	debugF("%-10s %12s %12s %10s %12s %10s %12s", "Scope", "Live KB", "Peak KB", "Live", "Total", "Reallocs", "Internal KB");
+
+	for (uint32_t i = 0; i < kScopeCount; i++) {
+		const ScopeStats stats = getScopeStats(static_cast<VkSystemAllocationScope>(i));
+
+		debugF("%-10s %12.1f %12.1f %10llu %12llu %10llu %12.1f", kScopeNames[i],
+			stats.liveBytes / 1024.0, stats.peakBytes / 1024.0,
+			static_cast<unsigned long long>(stats.liveAllocations),
+			static_cast<unsigned long long>(stats.totalAllocations),
+			static_cast<unsigned long long>(stats.reallocations),
+			stats.internalBytes / 1024.0);
+	}
+
+	debugF("Vulkan host pools:");
+	debugF("%-10s %10s %12s %12s", "Class", "Live", "Reserved KB", "Used %");
+
+	for (uint32_t i = 0; i < kVkHostSizeClasses; i++) {
+		const PoolStats stats = getPoolStats(i);
+		const double used = stats.reservedBytes ? 100.0 * stats.liveElements * stats.elementSize / stats.reservedBytes : 0.0;
+
+		debugF("%-10llu %10llu %12.1f %11.1f%%", static_cast<unsigned long long>(stats.elementSize),
+			static_cast<unsigned long long>(stats.liveElements), stats.reservedBytes / 1024.0, used);
+	}
+}
+
+//--- Callbacks ---
+
+void * VkHostAllocator::allocation(void * pUserData, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	return static_cast<VkHostAllocator*>(pUserData)->allocate(size, alignment, scope);
+}
+
+void * VkHostAllocator::reallocation(void * pUserData, void * pOriginal, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	return static_cast<VkHostAllocator*>(pUserData)->reallocate(pOriginal, size, alignment, scope);
+}
+
+void VkHostAllocator::free(void * pUserData, void * pMemory)
+{
+	static_cast<VkHostAllocator*>(pUserData)->deallocate(pMemory);
+}
+
+void VkHostAllocator::internalAllocation(void * pUserData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+{
+	static_cast<VkHostAllocator*>(pUserData)->m_counters[scope].internal += size;
+}
+
+void VkHostAllocator::internalFree(void * pUserData, size_t size, VkInternalAllocationType, VkSystemAllocationScope scope)
+{
+	static_cast<VkHostAllocator*>(pUserData)->m_counters[scope].internal -= size;
+}
+
+void * VkHostAllocator::allocate(size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	if (size == 0) return nullptr;
+
+	mem::TagScope tag(mem::Tag::Graphics);
+
+	//Header goes in the space in front of the block, keeping the block aligned
+	alignment = std::max(alignment, sizeof(BlockHeader));
+	const size_t offset = alignment;
+	const size_t total = size + offset;
+
+	char* base = nullptr;
+	uint8_t sizeClass = kHeapClass;
+
+	for (uint32_t i = 0; i < kVkHostSizeClasses; i++) {
+		if (total <= classSize(i) && alignment <= classAlignment(i)) {
+			std::lock_guard<std::mutex> lock(m_classes[i].mutex);
+			base = static_cast<char*>(m_classes[i].pool->allocate());
+			sizeClass = static_cast<uint8_t>(i);
+			break;
+		}
+	}
+
+	if (!base) {
+		base = static_cast<char*>(::operator new(total, std::align_val_t(alignment), std::nothrow));
+		if (!base) {
+			//Vulkan turns this into VK_ERROR_OUT_OF_HOST_MEMORY
+			return nullptr;
+		}
+	}
+
+	char* user = base + offset;
+
+	BlockHeader* header = headerOf(user);
+	header->size = size;
+	header->offset = static_cast<uint32_t>(offset);
+	header->sizeClass = sizeClass;
+	header->scope = static_cast<uint8_t>(scope);
+
+	Counters& counters = m_counters[scope];
+	addLive(counters, size);
+	counters.count++;
+	counters.total++;
+
+	return user;
+}
+
+void VkHostAllocator::deallocate(void * p)
+{
+	if (!p) return;
+
+	const BlockHeader header = *headerOf(p);
+	char* base = static_cast<char*>(p) - header.offset;
+
+	Counters& counters = m_counters[header.scope];
+	counters.live -= static_cast<size_t>(header.size);
+	counters.count--;
+
+	if (header.sizeClass == kHeapClass) {
+		::operator delete(base, std::align_val_t(header.offset));
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_classes[header.sizeClass].mutex);
+	m_classes[header.sizeClass].pool->free(base);
+}
+
+void * VkHostAllocator::reallocate(void * original, size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	if (!original) {
+		return allocate(size, alignment, scope);
+	}
+
+	if (size == 0) {
+		deallocate(original);
+		return nullptr;
+	}
+
+	//Still fits where it is - same pool element, same alignment
+	BlockHeader* header = headerOf(original);
+	if (header->sizeClass != kHeapClass && header->offset >= alignment && header->offset + size <= classSize(header->sizeClass)) {
+		Counters& counters = m_counters[header->scope];
+		counters.live -= static_cast<size_t>(header->size);
+		addLive(counters, size);
+		counters.reallocs++;
+
+		header->size = size;
+		return original;
+	}
+
+	void* moved = allocate(size, alignment, scope);
+	if (!moved) {
+		//Original must stay valid on failure
+		return nullptr;
+	}
+
+	std::memcpy(moved, original, std::min(static_cast<size_t>(header->size), size));
+	deallocate(original);
+
+	m_counters[scope].reallocs++;
+
+	return moved;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include "../Utils/BF_Memory.h"
+
+//Size classes served from pools, largest first falls back to the heap
+constexpr uint32_t kVkHostSizeClasses = 8;
+constexpr size_t kVkHostSmallestClass = 32;
+
+//Driver host memory (pAllocator on every vkCreate*/vkDestroy*). Small
+//requests come from per size class pools, the rest from the aligned heap,
+//and everything is charged to mem::Tag::Graphics. Live/peak bytes are kept
+//per VkSystemAllocationScope so driver-side growth can be watched over a session.
+class VkHostAllocator {
+public:
+	struct ScopeStats {
+		size_t liveBytes;
+		size_t peakBytes;
+		size_t liveAllocations;
+		uint64_t totalAllocations;
+		uint64_t reallocations;
+		size_t internalBytes;	//driver-owned (executable) memory it told us about
+	};
+
+	//Pool occupancy - reserved but unused bytes are fragmentation/slack
+	struct PoolStats {
+		size_t elementSize;
+		size_t liveElements;
+		size_t reservedBytes;
+	};
+
+	VkHostAllocator();
+	VkHostAllocator(const VkHostAllocator&) = delete;
+	VkHostAllocator& operator=(const VkHostAllocator&) = delete;
+
+	void init();
+	void shutdown();
+
+	//nullptr before init or when disabled - the driver then uses its own allocator
+	const VkAllocationCallbacks* getCallbacks() const;
+
+	ScopeStats getScopeStats(VkSystemAllocationScope) const;
+	PoolStats getPoolStats(uint32_t sizeClass) const;
+
+	//Per scope and per pool tables through debugF
+	void report() const;
+
+private:
+	static VKAPI_ATTR void* VKAPI_CALL allocation(void* pUserData, size_t size, size_t alignment, VkSystemAllocationScope);
+	static VKAPI_ATTR void* VKAPI_CALL reallocation(void* pUserData, void* pOriginal, size_t size, size_t alignment, VkSystemAllocationScope);
+	static VKAPI_ATTR void VKAPI_CALL free(void* pUserData, void* pMemory);
+	static VKAPI_ATTR void VKAPI_CALL internalAllocation(void* pUserData, size_t size, VkInternalAllocationType, VkSystemAllocationScope);
+	static VKAPI_ATTR void VKAPI_CALL internalFree(void* pUserData, size_t size, VkInternalAllocationType, VkSystemAllocationScope);
+
+	void* allocate(size_t size, size_t alignment, VkSystemAllocationScope);
+	void deallocate(void*);
+	void* reallocate(void* original, size_t size, size_t alignment, VkSystemAllocationScope);
+
+	struct Counters {
+		std::atomic<size_t> live;
+		std::atomic<size_t> peak;
+		std::atomic<size_t> count;
+		std::atomic<uint64_t> total;
+		std::atomic<uint64_t> reallocs;
+		std::atomic<size_t> internal;
+	};
+
+	static void addLive(Counters&, size_t size);
+
+	struct SizeClass {
+		std::unique_ptr<mem::Pool> pool;
+		mutable std::mutex mutex;
+	};
+
+	VkAllocationCallbacks	m_callbacks;
+	bool					m_initialised;
+
+	SizeClass				m_classes[kVkHostSizeClasses];
+	Counters				m_counters[VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1];
+};
@@ -0,0 +1,109 @@
+#pragma once
+#define GLM_FORCE_CTOR_INIT
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <algorithm>
+#include <cfloat>
+#include "BF_Transform.h"
+
+//Axis aligned box - starts inverted, so the first grow() sets it
+struct Aabb {
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	bool isEmpty() const {
+		return min.x > max.x;
+	}
+
+	void grow(const glm::vec3& p) {
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	}
+
+	void grow(const Aabb& box) {
+		min = glm::min(min, box.min);
+		max = glm::max(max, box.max);
+	}
+
+	glm::vec3 centre() const {
+		return (min + max) * 0.5f;
+	}
+
+	//Half size
+	glm::vec3 extent() const {
+		return (max - min) * 0.5f;
+	}
+
+	//The SAH weight - 0 for an empty box
+	float surfaceArea() const {
+		if (isEmpty()) return 0.0f;
+		const glm::vec3 d = max - min;
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+	bool overlaps(const Aabb& box) const {
+		return min.x <= box.max.x && max.x >= box.min.x &&
+			min.y <= box.max.y && max.y >= box.min.y &&
+			min.z <= box.max.z && max.z >= box.min.z;
+	}
+
+	bool operator==(const Aabb& box) const {
+		return min == box.min && max == box.max;
+	}
+
+	bool operator!=(const Aabb& box) const {
+		return !(*this == box);
+	}
+
+	//Slab test, inverseDirection is 1 / the ray direction. tNear is where the ray
+	//enters, 0 when it starts inside.
+	bool intersectRay(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxT, float& tNear) const {
+		float t0 = 0.0f, t1 = maxT;
+		for (int axis = 0; axis < 3; axis++) {
+			float a = (min[axis] - origin[axis]) * inverseDirection[axis];
+			float b = (max[axis] - origin[axis]) * inverseDirection[axis];
+			if (a > b) std::swap(a, b);
+
+			//NaN from a zero direction on the slab's face keeps the old bound
+			t0 = a > t0 ? a : t0;
+			t1 = b < t1 ? b : t1;
+			if (t0 > t1) return false;
+		}
+		tNear = t0;
+		return true;
+	}
+
+	//Against normalized, inward facing planes - -1 outside, 0 crossing, 1 inside
+	int classify(const glm::vec4 planes[6]) const {
+		const glm::vec3 c = centre();
+		const glm::vec3 e = extent();
+
+		int result = 1;
+		for (int i = 0; i < 6; i++) {
+			const glm::vec3 normal(planes[i]);
+			const float d = glm::dot(normal, c) + planes[i].w;
+			const float r = glm::dot(glm::abs(normal), e);
+
+			if (d < -r) return -1;
+			if (d < r) result = 0;
+		}
+		return result;
+	}
+
+	//Box around this one once scaled, rotated and moved - the rotated extent
+	//is the absolute rotation matrix applied to the scaled one (Arvo)
+	Aabb transformed(const Transform& transform) const {
+		if (isEmpty()) return *this;
+
+		const glm::mat3 rotation = glm::mat3_cast(transform.rotation);
+		const glm::vec3 c = transform.position + transform.rotation * (centre() * transform.scale);
+		const glm::vec3 e = extent() * glm::abs(transform.scale);
+
+		const glm::vec3 rotated = glm::abs(rotation[0]) * e.x + glm::abs(rotation[1]) * e.y + glm::abs(rotation[2]) * e.z;
+
+		Aabb result;
+		result.min = c - rotated;
+		result.max = c + rotated;
+		return result;
+	}
+};
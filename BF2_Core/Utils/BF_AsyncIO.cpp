@@ -0,0 +1,459 @@
+#include "BF_AsyncIO.h"
+#include "BF_Error.h"
+#include "BF_Profiler.h"
+#include "BF_MemTrack.h"
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__linux__) && defined(BF_USE_IO_URING)
+	#include <liburing.h>
+	#include <fcntl.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace {
+	bool readWholeFile(const std::string& filename, std::vector<char>& data)
+	{
+		std::ifstream file(filename, std::ios::ate | std::ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		data.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(data.data(), data.size());
+
+		return !file.fail();
+	}
+
+	//Portable fallback - blocking reads on a few worker threads
+	class ThreadPoolBackend : public IOService::Backend {
+	public:
+		ThreadPoolBackend() : m_pService(nullptr), m_exit(false)
+		{
+		}
+
+		bool init(IOService& service, uint32_t threads) override
+		{
+			m_pService = &service;
+
+			for (uint32_t i = 0; i < (threads > 0 ? threads : 1); i++)
+			{
+				m_workers.emplace_back(&ThreadPoolBackend::run, this);
+			}
+
+			return true;
+		}
+
+		void shutdown() override
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_exit = true;
+			}
+			m_wake.notify_all();
+
+			for (auto& worker : m_workers)
+			{
+				worker.join();
+			}
+			m_workers.clear();
+		}
+
+		void submit(std::unique_ptr<IOService::Request> request) override
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_queue.push_back(std::move(request));
+			}
+			m_wake.notify_one();
+		}
+
+	private:
+		void run()
+		{
+			prof::SetThreadName("IO Worker");
+
+			//File contents are charged to Assets, whoever ends up owning them
+			mem::SetCurrentTag(mem::Tag::Assets);
+
+			while (true)
+			{
+				std::unique_ptr<IOService::Request> request;
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					m_wake.wait(lock, [this]() { return m_exit || !m_queue.empty(); });
+
+					//Drain the queue before exiting so no future is left hanging
+					if (m_queue.empty())
+					{
+						return;
+					}
+
+					request = std::move(m_queue.front());
+					m_queue.pop_front();
+				}
+
+				{
+					BF_PROFILE_ZONE("IO::read");
+					request->ok = readWholeFile(request->filename, request->data);
+				}
+
+				m_pService->complete(std::move(request));
+			}
+		}
+
+		IOService* m_pService;
+
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::deque<std::unique_ptr<IOService::Request>> m_queue;
+		std::vector<std::thread> m_workers;
+		bool m_exit;
+	};
+
+#if defined(__linux__) && defined(BF_USE_IO_URING)
+	constexpr unsigned kUringEntries = 64;
+
+	//One thread owns the ring - opens files, queues reads and reaps completions
+	class UringBackend : public IOService::Backend {
+	public:
+		UringBackend() : m_pService(nullptr), m_exit(false), m_inFlight(0)
+		{
+		}
+
+		bool init(IOService& service, uint32_t threads) override
+		{
+			m_pService = &service;
+
+			if (io_uring_queue_init(kUringEntries, &m_ring, 0) < 0)
+			{
+				return false;
+			}
+
+			m_thread = std::thread(&UringBackend::run, this);
+			return true;
+		}
+
+		void shutdown() override
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_exit = true;
+			}
+			m_wake.notify_all();
+
+			m_thread.join();
+			io_uring_queue_exit(&m_ring);
+		}
+
+		void submit(std::unique_ptr<IOService::Request> request) override
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_queue.push_back(std::move(request));
+			}
+			m_wake.notify_one();
+		}
+
+	private:
+		struct Operation {
+			std::unique_ptr<IOService::Request> request;
+			int fd;
+			size_t offset;
+		};
+
+		void run()
+		{
+			prof::SetThreadName("IO uring");
+			mem::SetCurrentTag(mem::Tag::Assets);
+
+			while (true)
+			{
+				std::deque<std::unique_ptr<IOService::Request>> incoming;
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+
+					//Only sleep on the condition when nothing is in flight
+					if (m_inFlight == 0)
+					{
+						m_wake.wait(lock, [this]() { return m_exit || !m_queue.empty(); });
+					}
+
+					if (m_exit && m_queue.empty() && m_inFlight == 0)
+					{
+						return;
+					}
+
+					incoming.swap(m_queue);
+				}
+
+				for (auto& request : incoming)
+				{
+					start(std::move(request));
+				}
+				io_uring_submit(&m_ring);
+
+				if (m_inFlight > 0)
+				{
+					//Short timeout so newly queued requests are picked up promptly
+					__kernel_timespec timeout = { 0, 1000000 };
+					io_uring_cqe* cqe = nullptr;
+
+					if (io_uring_wait_cqe_timeout(&m_ring, &cqe, &timeout) == 0)
+					{
+						reap();
+					}
+				}
+			}
+		}
+
+		void start(std::unique_ptr<IOService::Request> request)
+		{
+			const int fd = open(request->filename.c_str(), O_RDONLY);
+			if (fd < 0)
+			{
+				finish(std::move(request), false);
+				return;
+			}
+
+			struct stat st;
+			if (fstat(fd, &st) != 0)
+			{
+				close(fd);
+				finish(std::move(request), false);
+				return;
+			}
+
+			request->data.resize(static_cast<size_t>(st.st_size));
+			if (request->data.empty())
+			{
+				close(fd);
+				finish(std::move(request), true);
+				return;
+			}
+
+			queueRead(new Operation{ std::move(request), fd, 0 });
+		}
+
+		void queueRead(Operation* op)
+		{
+			io_uring_sqe* sqe = io_uring_get_sqe(&m_ring);
+			if (!sqe)
+			{
+				//Ring full - flush what we have and try again
+				io_uring_submit(&m_ring);
+				sqe = io_uring_get_sqe(&m_ring);
+			}
+
+			//Submit failed to free a slot - fail this read rather than stall the ring
+			if (!sqe)
+			{
+				close(op->fd);
+				finish(std::move(op->request), false);
+				delete op;
+				return;
+			}
+
+			std::vector<char>& data = op->request->data;
+			io_uring_prep_read(sqe, op->fd, data.data() + op->offset, static_cast<unsigned>(data.size() - op->offset), op->offset);
+			io_uring_sqe_set_data(sqe, op);
+			m_inFlight++;
+		}
+
+		void reap()
+		{
+			bool resubmit = false;
+
+			io_uring_cqe* cqe = nullptr;
+			while (io_uring_peek_cqe(&m_ring, &cqe) == 0)
+			{
+				Operation* op = static_cast<Operation*>(io_uring_cqe_get_data(cqe));
+				const int res = cqe->res;
+				io_uring_cqe_seen(&m_ring, cqe);
+				m_inFlight--;
+
+				if (res < 0)
+				{
+					close(op->fd);
+					finish(std::move(op->request), false);
+					delete op;
+					continue;
+				}
+
+				op->offset += static_cast<size_t>(res);
+
+				//Short read - queue the remainder, unless the file shrank under us
+				if (res > 0 && op->offset < op->request->data.size())
+				{
+					queueRead(op);
+					resubmit = true;
+					continue;
+				}
+
+				op->request->data.resize(op->offset);
+				close(op->fd);
+				finish(std::move(op->request), true);
+				delete op;
+			}
+
+			if (resubmit)
+			{
+				io_uring_submit(&m_ring);
+			}
+		}
+
+		void finish(std::unique_ptr<IOService::Request> request, bool ok)
+		{
+			request->ok = ok;
+			m_pService->complete(std::move(request));
+		}
+
+		IOService* m_pService;
+		io_uring m_ring;
+
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::deque<std::unique_ptr<IOService::Request>> m_queue;
+		std::thread m_thread;
+		bool m_exit;
+
+		//Only touched by the ring thread
+		uint32_t m_inFlight;
+	};
+#endif
+}
+
+IOService::IOService() : m_pending(0)
+{
+}
+
+IOService::~IOService()
+{
+	shutdown();
+}
+
+void IOService::init(uint32_t workerThreads)
+{
+#if defined(__linux__) && defined(BF_USE_IO_URING)
+	m_pBackend = std::make_unique<UringBackend>();
+	if (m_pBackend->init(*this, workerThreads))
+	{
+		return;
+	}
+
+	errorF("IOService - io_uring unavailable, falling back to worker threads");
+#endif
+
+	m_pBackend = std::make_unique<ThreadPoolBackend>();
+	m_pBackend->init(*this, workerThreads);
+}
+
+void IOService::shutdown()
+{
+	if (!m_pBackend) return;
+
+	//Backends finish what was queued before stopping
+	m_pBackend->shutdown();
+	m_pBackend.reset();
+
+	//Nobody is left to care about callbacks that didn't get pumped
+	std::lock_guard<std::mutex> lock(m_completedMutex);
+	m_completed.clear();
+	m_pending = 0;
+}
+
+void IOService::readAsync(const std::string & filename, Callback callback)
+{
+	mem::TagScope tag(mem::Tag::IO);
+
+	auto request = std::make_unique<Request>();
+	request->filename = filename;
+	request->ok = false;
+	request->callback = std::move(callback);
+	request->usePromise = false;
+
+	submit(std::move(request));
+}
+
+std::future<std::vector<char>> IOService::readAsync(const std::string & filename)
+{
+	mem::TagScope tag(mem::Tag::IO);
+
+	auto request = std::make_unique<Request>();
+	request->filename = filename;
+	request->ok = false;
+	request->usePromise = true;
+
+	std::future<std::vector<char>> future = request->promise.get_future();
+	submit(std::move(request));
+
+	return future;
+}
+
+void IOService::submit(std::unique_ptr<Request> request)
+{
+	m_pending++;
+
+	if (!m_pBackend)
+	{
+		errorF("IOService - read of %s requested before init", request->filename.c_str());
+		complete(std::move(request));
+		return;
+	}
+
+	m_pBackend->submit(std::move(request));
+}
+
+void IOService::complete(std::unique_ptr<Request> request)
+{
+	if (request->usePromise)
+	{
+		if (request->ok)
+		{
+			request->promise.set_value(std::move(request->data));
+		}
+		else
+		{
+			request->promise.set_exception(std::make_exception_ptr(std::runtime_error("IOService - failed to read " + request->filename)));
+		}
+
+		m_pending--;
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_completedMutex);
+	m_completed.push_back(std::move(request));
+}
+
+void IOService::pump()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_completedMutex);
+		m_dispatching.swap(m_completed);
+	}
+
+	//Callbacks may queue more reads, so run them outside the lock
+	for (auto& request : m_dispatching)
+	{
+		if (request->callback)
+		{
+			request->callback(request->ok, std::move(request->data));
+		}
+
+		m_pending--;
+	}
+
+	m_dispatching.clear();
+}
+
+const uint32_t IOService::getPendingCount() const
+{
+	return m_pending.load();
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <functional>
+#include <atomic>
+
+//Asynchronous whole-file reads. Requests are queued to a backend - a thread
+//pool everywhere, or io_uring on Linux when built with BF_USE_IO_URING
+//(links liburing) - so loads never block the frame thread.
+class IOService {
+public:
+	//ok is false if the file couldn't be read, data is then empty
+	using Callback = std::function<void(bool ok, std::vector<char>&& data)>;
+
+	struct Request {
+		std::string filename;
+		std::vector<char> data;
+		bool ok;
+
+		//Either a callback (run from pump) or a promise (fulfilled on completion)
+		Callback callback;
+		std::promise<std::vector<char>> promise;
+		bool usePromise;
+	};
+
+	//Implemented per platform in BF_AsyncIO.cpp
+	class Backend {
+	public:
+		virtual ~Backend() {}
+		virtual bool init(IOService& service, uint32_t threads) = 0;
+		virtual void shutdown() = 0;
+		virtual void submit(std::unique_ptr<Request>) = 0;
+	};
+
+	IOService();
+	IOService(const IOService&) = delete;
+	IOService& operator=(const IOService&) = delete;
+
+	~IOService();
+
+	void init(uint32_t workerThreads);
+	void shutdown();
+
+	//Callback runs on whichever thread calls pump()
+	void readAsync(const std::string& filename, Callback callback);
+
+	//Future is fulfilled as soon as the read finishes, no pump needed.
+	//A failed read stores an exception in the future.
+	std::future<std::vector<char>> readAsync(const std::string& filename);
+
+	//Run callbacks for finished reads - once per frame on the main thread
+	void pump();
+
+	const uint32_t getPendingCount() const;
+
+	//Backends hand finished requests back through here (any thread)
+	void complete(std::unique_ptr<Request>);
+
+private:
+	void submit(std::unique_ptr<Request>);
+
+	std::unique_ptr<Backend> m_pBackend;
+
+	std::mutex m_completedMutex;
+	std::vector<std::unique_ptr<Request>> m_completed;
+	std::vector<std::unique_ptr<Request>> m_dispatching;
+
+	std::atomic<uint32_t> m_pending;
+};
@@ -0,0 +1,301 @@
+#include "BF_BlockCompress.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+//Power iterations finding a block's principal colour axis - the axis
+//converges fast on the small, well separated spreads texture blocks have
+static constexpr int kAxisIterations = 8;
+
+//Weight of the first endpoint for each BC1 index in four colour mode
+static constexpr float kBC1Weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+static uint16_t Pack565(const float rgb[3])
+{
+	auto quantise = [](float value, float levels) {
+		return static_cast<uint16_t>(std::lround(std::max(0.0f, std::min(255.0f, value)) * levels / 255.0f));
+	};
+	return static_cast<uint16_t>((quantise(rgb[0], 31.0f) << 11) | (quantise(rgb[1], 63.0f) << 5) | quantise(rgb[2], 31.0f));
+}
+
+//The 8 bit values the GPU expands a 565 colour to
+static void Unpack565(uint16_t packed, float rgb[3])
+{
+	const uint32_t r = (packed >> 11) & 31;
+	const uint32_t g = (packed >> 5) & 63;
+	const uint32_t b = packed & 31;
+	rgb[0] = static_cast<float>((r << 3) | (r >> 2));
+	rgb[1] = static_cast<float>((g << 2) | (g >> 4));
+	rgb[2] = static_cast<float>((b << 3) | (b >> 2));
+}
+
+//Endpoints snapped to 565, four colour order and the nearest index per texel.
+//Returns the block's squared error.
+static float FitBC1(const float texels[16][3], const float first[3], const float second[3], uint16_t& colour0, uint16_t& colour1, uint32_t& indices)
+{
+	colour0 = Pack565(first);
+	colour1 = Pack565(second);
+
+	//Four colour mode needs colour0 above colour1, equal ones fall to index 0 everywhere
+	if (colour0 < colour1) std::swap(colour0, colour1);
+
+	float palette[4][3];
+	Unpack565(colour0, palette[0]);
+	Unpack565(colour1, palette[1]);
+	for (int channel = 0; channel < 3; channel++) {
+		palette[2][channel] = (2.0f * palette[0][channel] + palette[1][channel]) / 3.0f;
+		palette[3][channel] = (palette[0][channel] + 2.0f * palette[1][channel]) / 3.0f;
+	}
+
+	const uint32_t candidates = colour0 == colour1 ? 1 : 4;
+	float error = 0.0f;
+	indices = 0;
+
+	for (uint32_t texel = 0; texel < 16; texel++) {
+		uint32_t best = 0;
+		float bestDistance = 0.0f;
+
+		for (uint32_t index = 0; index < candidates; index++) {
+			float distance = 0.0f;
+			for (int channel = 0; channel < 3; channel++) {
+				const float delta = texels[texel][channel] - palette[index][channel];
+				distance += delta * delta;
+			}
+			if (index == 0 || distance < bestDistance) {
+				best = index;
+				bestDistance = distance;
+			}
+		}
+
+		indices |= best << (texel * 2);
+		error += bestDistance;
+	}
+
+	return error;
+}
+
+static void WriteBC1(uint16_t colour0, uint16_t colour1, uint32_t indices, uint8_t out[8])
+{
+	out[0] = static_cast<uint8_t>(colour0);
+	out[1] = static_cast<uint8_t>(colour0 >> 8);
+	out[2] = static_cast<uint8_t>(colour1);
+	out[3] = static_cast<uint8_t>(colour1 >> 8);
+	for (int i = 0; i < 4; i++) {
+		out[4 + i] = static_cast<uint8_t>(indices >> (i * 8));
+	}
+}
+
+uint32_t bc::BlockBytes(Format format)
+{
+	return format == Format::BC1 || format == Format::BC4 ? 8 : 16;
+}
+
+void bc::EncodeBC1(const uint8_t block[64], uint8_t out[8])
+{
+	float texels[16][3];
+	float mean[3] = {};
+	for (int texel = 0; texel < 16; texel++) {
+		for (int channel = 0; channel < 3; channel++) {
+			texels[texel][channel] = block[texel * 4 + channel];
+			mean[channel] += texels[texel][channel] / 16.0f;
+		}
+	}
+
+	//Covariance - xx, xy, xz, yy, yz, zz
+	float covariance[6] = {};
+	float low[3] = { 255.0f, 255.0f, 255.0f };
+	float high[3] = {};
+	for (int texel = 0; texel < 16; texel++) {
+		const float x = texels[texel][0] - mean[0];
+		const float y = texels[texel][1] - mean[1];
+		const float z = texels[texel][2] - mean[2];
+		covariance[0] += x * x;
+		covariance[1] += x * y;
+		covariance[2] += x * z;
+		covariance[3] += y * y;
+		covariance[4] += y * z;
+		covariance[5] += z * z;
+
+		for (int channel = 0; channel < 3; channel++) {
+			low[channel] = std::min(low[channel], texels[texel][channel]);
+			high[channel] = std::max(high[channel], texels[texel][channel]);
+		}
+	}
+
+	//Principal axis, starting from the covariance row of the widest channel. The
+	//bounding box diagonal can sit orthogonal to the axis (a red/green checker),
+	//where the iteration would never leave zero.
+	const float rows[3][3] = {
+		{ covariance[0], covariance[1], covariance[2] },
+		{ covariance[1], covariance[3], covariance[4] },
+		{ covariance[2], covariance[4], covariance[5] },
+	};
+	const int widest = covariance[0] >= covariance[3] && covariance[0] >= covariance[5] ? 0 : covariance[3] >= covariance[5] ? 1 : 2;
+	float axis[3] = { rows[widest][0], rows[widest][1], rows[widest][2] };
+	for (int iteration = 0; iteration < kAxisIterations; iteration++) {
+		const float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+		const float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+		const float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+
+		const float largest = std::max(std::fabs(x), std::max(std::fabs(y), std::fabs(z)));
+		if (largest <= 0.0f) break;
+
+		axis[0] = x / largest;
+		axis[1] = y / largest;
+		axis[2] = z / largest;
+	}
+
+	const float axisLength = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+	//Endpoints at the extremes of the texels along the axis
+	float minimum = 0.0f, maximum = 0.0f;
+	if (axisLength > 0.0f) {
+		for (int texel = 0; texel < 16; texel++) {
+			const float t = ((texels[texel][0] - mean[0]) * axis[0] + (texels[texel][1] - mean[1]) * axis[1] + (texels[texel][2] - mean[2]) * axis[2]) / axisLength;
+			minimum = std::min(minimum, t);
+			maximum = std::max(maximum, t);
+		}
+	}
+
+	//No spread along it - the bounding box corners, which are the mean for a flat block
+	float first[3] = { high[0], high[1], high[2] };
+	float second[3] = { low[0], low[1], low[2] };
+	if (maximum > minimum) {
+		for (int channel = 0; channel < 3; channel++) {
+			first[channel] = mean[channel] + axis[channel] * maximum;
+			second[channel] = mean[channel] + axis[channel] * minimum;
+		}
+	}
+
+	uint16_t colour0, colour1;
+	uint32_t indices;
+	float error = FitBC1(texels, first, second, colour0, colour1, indices);
+
+	//One least squares pass - the endpoints best reproducing the texels for the chosen indices
+	if (colour0 != colour1) {
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[3] = {}, bx[3] = {};
+		for (int texel = 0; texel < 16; texel++) {
+			const float a = kBC1Weights[(indices >> (texel * 2)) & 3];
+			const float b = 1.0f - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int channel = 0; channel < 3; channel++) {
+				ax[channel] += a * texels[texel][channel];
+				bx[channel] += b * texels[texel][channel];
+			}
+		}
+
+		const float determinant = aa * bb - ab * ab;
+		if (std::fabs(determinant) > 1e-6f) {
+			for (int channel = 0; channel < 3; channel++) {
+				first[channel] = (ax[channel] * bb - bx[channel] * ab) / determinant;
+				second[channel] = (bx[channel] * aa - ax[channel] * ab) / determinant;
+			}
+
+			uint16_t refined0, refined1;
+			uint32_t refinedIndices;
+			const float refinedError = FitBC1(texels, first, second, refined0, refined1, refinedIndices);
+			if (refinedError < error) {
+				colour0 = refined0;
+				colour1 = refined1;
+				indices = refinedIndices;
+				error = refinedError;
+			}
+		}
+	}
+
+	WriteBC1(colour0, colour1, indices, out);
+}
+
+void bc::EncodeBC3(const uint8_t block[64], uint8_t out[16])
+{
+	EncodeBC4(block, 3, out);
+	EncodeBC1(block, out + 8);
+}
+
+void bc::EncodeBC4(const uint8_t block[64], uint32_t channel, uint8_t out[8])
+{
+	uint8_t low = 255, high = 0;
+	for (int texel = 0; texel < 16; texel++) {
+		low = std::min(low, block[texel * 4 + channel]);
+		high = std::max(high, block[texel * 4 + channel]);
+	}
+
+	//Eight value mode (first endpoint above the second) - index 0 is the
+	//first, 1 the second, 2-7 the steps between from the first onward
+	uint64_t indices = 0;
+	if (high > low) {
+		const float scale = 7.0f / static_cast<float>(high - low);
+		for (int texel = 0; texel < 16; texel++) {
+			const uint32_t step = static_cast<uint32_t>(std::lround((high - block[texel * 4 + channel]) * scale));
+			const uint64_t index = step == 0 ? 0 : step == 7 ? 1 : step + 1;
+			indices |= index << (texel * 3);
+		}
+	}
+
+	out[0] = high;
+	out[1] = low;
+	for (int i = 0; i < 6; i++) {
+		out[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+	}
+}
+
+void bc::EncodeBC5(const uint8_t block[64], uint8_t out[16])
+{
+	EncodeBC4(block, 0, out);
+	EncodeBC4(block, 1, out + 8);
+}
+
+std::vector<char> bc::Compress(const uint8_t* rgba, uint32_t width, uint32_t height, Format format, uint32_t threads)
+{
+	const uint32_t blocksWide = (width + 3) / 4;
+	const uint32_t blocksHigh = (height + 3) / 4;
+	const uint32_t blockBytes = BlockBytes(format);
+
+	std::vector<char> out(static_cast<size_t>(blocksWide) * blocksHigh * blockBytes);
+
+	auto encodeRows = [&](uint32_t firstRow, uint32_t endRow) {
+		uint8_t block[64];
+		for (uint32_t by = firstRow; by < endRow; by++) {
+			for (uint32_t bx = 0; bx < blocksWide; bx++) {
+				for (uint32_t y = 0; y < 4; y++) {
+					const uint32_t sy = std::min(by * 4 + y, height - 1);
+					for (uint32_t x = 0; x < 4; x++) {
+						const uint32_t sx = std::min(bx * 4 + x, width - 1);
+						std::memcpy(block + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+					}
+				}
+
+				uint8_t* destination = reinterpret_cast<uint8_t*>(out.data()) + (static_cast<size_t>(by) * blocksWide + bx) * blockBytes;
+				switch (format) {
+				case Format::BC1: EncodeBC1(block, destination); break;
+				case Format::BC3: EncodeBC3(block, destination); break;
+				case Format::BC4: EncodeBC4(block, 0, destination); break;
+				case Format::BC5: EncodeBC5(block, destination); break;
+				}
+			}
+		}
+	};
+
+	if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+	threads = std::max(1u, std::min(threads, blocksHigh));
+
+	//Contiguous bands of block rows, the caller taking the first
+	const uint32_t band = (blocksHigh + threads - 1) / threads;
+	std::vector<std::thread> workers;
+	for (uint32_t thread = 1; thread < threads; thread++) {
+		const uint32_t first = std::min(blocksHigh, thread * band);
+		workers.emplace_back(encodeRows, first, std::min(blocksHigh, first + band));
+	}
+	encodeRows(0, std::min(blocksHigh, band));
+
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	return out;
+}
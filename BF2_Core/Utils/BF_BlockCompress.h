@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//CPU encoders for the BCn block formats. Blocks are 4x4 texels of 8 bit RGBA,
+//row by row, and each encodes to 8 or 16 bytes laid out as the GPU reads them.
+namespace bc {
+	enum class Format : uint32_t {
+		BC1,	//RGB, 8 bytes - opaque colour
+		BC3,	//RGBA, 16 bytes - BC4 alpha then a BC1 colour block
+		BC4,	//R, 8 bytes - masks, roughness
+		BC5,	//RG, 16 bytes - tangent space normals
+	};
+
+	uint32_t BlockBytes(Format);
+
+	void EncodeBC1(const uint8_t block[64], uint8_t out[8]);
+	void EncodeBC3(const uint8_t block[64], uint8_t out[16]);
+
+	//One channel of the block, 0-3 for RGBA
+	void EncodeBC4(const uint8_t block[64], uint32_t channel, uint8_t out[8]);
+	void EncodeBC5(const uint8_t block[64], uint8_t out[16]);
+
+	//Whole image, edge blocks padded by repeating the last row and column.
+	//Block rows are spread over threads (0 for one per core).
+	std::vector<char> Compress(const uint8_t* rgba, uint32_t width, uint32_t height, Format, uint32_t threads = 0);
+}
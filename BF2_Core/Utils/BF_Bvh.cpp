@@ -0,0 +1,412 @@
+#include "BF_Bvh.h"
+#include "BF_Consts.h"
+#include "BF_Profiler.h"
+
+#include <algorithm>
+#include <numeric>
+
+//Leaves hold at most this many ids, and the SAH sweep considers this many split planes per axis
+static constexpr uint32_t kBvhMaxLeafSize = 4;
+static constexpr uint32_t kBvhBins = 16;
+
+//Pending ids are folded in once they reach this share (1/n) of the tree
+static constexpr size_t kBvhPendingShare = 8;
+
+Bvh::Bvh()
+{
+}
+
+void Bvh::build(const Aabb* boxes, size_t count)
+{
+	m_boxes.assign(boxes, boxes + count);
+	buildTree();
+}
+
+void Bvh::clear()
+{
+	m_nodes.clear();
+	m_freePairs.clear();
+	m_items.clear();
+	m_boxes.clear();
+	m_leafOf.clear();
+	m_pending.clear();
+}
+
+void Bvh::insert(uint32_t id, const Aabb& box)
+{
+	if (id >= m_boxes.size()) {
+		m_boxes.resize(id + 1);
+		m_leafOf.resize(id + 1, kNone);
+	}
+
+	m_boxes[id] = box;
+	m_pending.push_back(id);
+}
+
+void Bvh::update(uint32_t id, const Aabb& box)
+{
+	if (m_boxes[id] == box) return;
+	m_boxes[id] = box;
+
+	//Mark the way up - stops early where another moved id already has
+	for (uint32_t node = m_leafOf[id]; node != kNone && !m_nodes[node].dirty; node = m_nodes[node].parent) {
+		m_nodes[node].dirty = true;
+	}
+}
+
+void Bvh::refit()
+{
+	BF_PROFILE_ZONE("Bvh::refit");
+
+	//A full build is cheap next to scanning a large pending list every query
+	if (!m_pending.empty() && (m_boxes.size() <= kBvhRebuildBudget || m_pending.size() * kBvhPendingShare >= m_boxes.size())) {
+		buildTree();
+		return;
+	}
+
+	if (m_nodes.empty()) return;
+
+	uint32_t budget = kBvhRebuildBudget;
+	refitNode(0, budget);
+}
+
+void Bvh::queryBox(const Aabb& box, std::vector<uint32_t>& out) const
+{
+	if (!m_nodes.empty()) {
+		std::vector<uint32_t> stack(1, 0);
+		while (!stack.empty()) {
+			const Node& node = m_nodes[stack.back()];
+			stack.pop_back();
+
+			if (!node.bounds.overlaps(box)) continue;
+
+			if (node.child != kNone) {
+				stack.push_back(node.child);
+				stack.push_back(node.child + 1);
+				continue;
+			}
+
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				if (m_boxes[m_items[i]].overlaps(box)) out.push_back(m_items[i]);
+			}
+		}
+	}
+
+	for (uint32_t id : m_pending) {
+		if (m_boxes[id].overlaps(box)) out.push_back(id);
+	}
+}
+
+void Bvh::queryFrustum(const glm::vec4 planes[6], std::vector<uint32_t>& out) const
+{
+	if (!m_nodes.empty()) {
+		std::vector<uint32_t> stack(1, 0);
+		while (!stack.empty()) {
+			const Node& node = m_nodes[stack.back()];
+			stack.pop_back();
+
+			const int side = node.bounds.classify(planes);
+			if (side < 0) continue;
+
+			//Wholly inside - everything below is in without another test
+			if (side > 0) {
+				out.insert(out.end(), m_items.begin() + node.first, m_items.begin() + node.first + node.count);
+				continue;
+			}
+
+			if (node.child != kNone) {
+				stack.push_back(node.child);
+				stack.push_back(node.child + 1);
+				continue;
+			}
+
+			for (uint32_t i = node.first; i < node.first + node.count; i++) {
+				if (m_boxes[m_items[i]].classify(planes) >= 0) out.push_back(m_items[i]);
+			}
+		}
+	}
+
+	for (uint32_t id : m_pending) {
+		if (m_boxes[id].classify(planes) >= 0) out.push_back(id);
+	}
+}
+
+bool Bvh::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, uint32_t& id, float& distance) const
+{
+	const glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	bool hit = false;
+	float nearest = maxDistance;
+
+	auto test = [&](uint32_t item) {
+		float t;
+		if (m_boxes[item].intersectRay(origin, inverseDirection, nearest, t) && (!hit || t < nearest)) {
+			hit = true;
+			nearest = t;
+			id = item;
+		}
+	};
+
+	if (!m_nodes.empty()) {
+		std::vector<uint32_t> stack(1, 0);
+		while (!stack.empty()) {
+			const Node& node = m_nodes[stack.back()];
+			stack.pop_back();
+
+			//Re-tested against the nearest hit so far, which may have closed in since the push
+			float t;
+			if (!node.bounds.intersectRay(origin, inverseDirection, nearest, t)) continue;
+
+			if (node.child == kNone) {
+				for (uint32_t i = node.first; i < node.first + node.count; i++) {
+					test(m_items[i]);
+				}
+				continue;
+			}
+
+			//Nearer child on top, so its hits can prune the other
+			float tLeft, tRight;
+			const bool left = m_nodes[node.child].bounds.intersectRay(origin, inverseDirection, nearest, tLeft);
+			const bool right = m_nodes[node.child + 1].bounds.intersectRay(origin, inverseDirection, nearest, tRight);
+
+			if (left && right) {
+				const bool leftFirst = tLeft <= tRight;
+				stack.push_back(leftFirst ? node.child + 1 : node.child);
+				stack.push_back(leftFirst ? node.child : node.child + 1);
+			}
+			else if (left) {
+				stack.push_back(node.child);
+			}
+			else if (right) {
+				stack.push_back(node.child + 1);
+			}
+		}
+	}
+
+	for (uint32_t item : m_pending) {
+		test(item);
+	}
+
+	if (hit) distance = nearest;
+	return hit;
+}
+
+const Aabb& Bvh::getBox(uint32_t id) const
+{
+	return m_boxes[id];
+}
+
+const size_t Bvh::getNodeCount() const
+{
+	return m_nodes.size() - m_freePairs.size() * 2;
+}
+
+void Bvh::buildTree()
+{
+	BF_PROFILE_ZONE("Bvh::build");
+
+	const uint32_t count = static_cast<uint32_t>(m_boxes.size());
+
+	m_items.resize(count);
+	std::iota(m_items.begin(), m_items.end(), 0u);
+	m_leafOf.assign(count, kNone);
+	m_pending.clear();
+
+	m_nodes.clear();
+	m_freePairs.clear();
+	if (count == 0) return;
+
+	//2n - 1 nodes at most with single id leaves
+	m_nodes.reserve(count * 2);
+	m_nodes.resize(1);
+	m_nodes[0].parent = kNone;
+
+	buildNode(0, 0, count);
+}
+
+void Bvh::buildNode(uint32_t node, uint32_t first, uint32_t count)
+{
+	//m_nodes can grow below, so no references are held across the recursion
+	Aabb bounds, centroids;
+	for (uint32_t i = first; i < first + count; i++) {
+		const Aabb& box = m_boxes[m_items[i]];
+		bounds.grow(box);
+		centroids.grow(box.centre());
+	}
+
+	{
+		Node& n = m_nodes[node];
+		n.bounds = bounds;
+		n.builtArea = bounds.surfaceArea();
+		n.child = kNone;
+		n.first = first;
+		n.count = count;
+		n.dirty = false;
+	}
+
+	if (count <= kBvhMaxLeafSize) {
+		for (uint32_t i = first; i < first + count; i++) {
+			m_leafOf[m_items[i]] = node;
+		}
+		return;
+	}
+
+	//Binned SAH - centroids into kBvhBins slabs per axis, all three in one pass
+	//over the ids, then the plane between slabs minimizing area * count both sides
+	glm::vec3 scale(0.0f);
+	for (int axis = 0; axis < 3; axis++) {
+		const float size = centroids.max[axis] - centroids.min[axis];
+		scale[axis] = size > 0.0f ? kBvhBins / size : 0.0f;
+	}
+
+	Aabb binBounds[3][kBvhBins];
+	uint32_t binCounts[3][kBvhBins] = {};
+	for (uint32_t i = first; i < first + count; i++) {
+		const Aabb& box = m_boxes[m_items[i]];
+		const glm::vec3 c = box.centre();
+
+		for (int axis = 0; axis < 3; axis++) {
+			const uint32_t bin = std::min(kBvhBins - 1, static_cast<uint32_t>((c[axis] - centroids.min[axis]) * scale[axis]));
+			binBounds[axis][bin].grow(box);
+			binCounts[axis][bin]++;
+		}
+	}
+
+	int bestAxis = -1;
+	uint32_t bestSplit = 0;
+	float bestCost = FLT_MAX;
+
+	for (int axis = 0; axis < 3; axis++) {
+		//Flat axis, everything landed in bin 0
+		if (scale[axis] <= 0.0f) continue;
+
+		//Right hand sides swept from the top, then the left ones met against them
+		float rightArea[kBvhBins];
+		uint32_t rightCount[kBvhBins];
+		Aabb sweep;
+		uint32_t swept = 0;
+		for (uint32_t bin = kBvhBins - 1; bin > 0; bin--) {
+			sweep.grow(binBounds[axis][bin]);
+			swept += binCounts[axis][bin];
+			rightArea[bin] = sweep.surfaceArea();
+			rightCount[bin] = swept;
+		}
+
+		sweep = Aabb();
+		swept = 0;
+		for (uint32_t bin = 0; bin + 1 < kBvhBins; bin++) {
+			sweep.grow(binBounds[axis][bin]);
+			swept += binCounts[axis][bin];
+			if (swept == 0 || rightCount[bin + 1] == 0) continue;
+
+			const float cost = sweep.surfaceArea() * swept + rightArea[bin + 1] * rightCount[bin + 1];
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = bin + 1;
+			}
+		}
+	}
+
+	uint32_t middle = first;
+	if (bestAxis >= 0) {
+		const float low = centroids.min[bestAxis];
+		const float axisScale = scale[bestAxis];
+
+		auto split = std::partition(m_items.begin() + first, m_items.begin() + first + count, [&](uint32_t id) {
+			const uint32_t bin = std::min(kBvhBins - 1, static_cast<uint32_t>((m_boxes[id].centre()[bestAxis] - low) * axisScale));
+			return bin < bestSplit;
+		});
+		middle = static_cast<uint32_t>(split - m_items.begin());
+	}
+
+	//Every centroid in one spot - halve by count on the widest axis instead
+	if (middle == first || middle == first + count) {
+		const glm::vec3 size = centroids.max - centroids.min;
+		const int axis = size.x >= size.y && size.x >= size.z ? 0 : (size.y >= size.z ? 1 : 2);
+
+		middle = first + count / 2;
+		std::nth_element(m_items.begin() + first, m_items.begin() + middle, m_items.begin() + first + count, [&](uint32_t a, uint32_t b) {
+			return m_boxes[a].centre()[axis] < m_boxes[b].centre()[axis];
+		});
+	}
+
+	const uint32_t child = allocatePair(node);
+	m_nodes[node].child = child;
+
+	buildNode(child, first, middle - first);
+	buildNode(child + 1, middle, first + count - middle);
+}
+
+void Bvh::refitNode(uint32_t node, uint32_t& budget)
+{
+	if (!m_nodes[node].dirty) return;
+
+	//A rebuild below can grow m_nodes, so copy what is needed out first
+	const uint32_t child = m_nodes[node].child;
+	const uint32_t first = m_nodes[node].first;
+	const uint32_t count = m_nodes[node].count;
+
+	//Judged on last refit's bounds, so a subtree is caught a frame after it bloats.
+	//Top-most first - rebuilding a parent covers its children too.
+	if (child != kNone && m_nodes[node].bounds.surfaceArea() > m_nodes[node].builtArea * kBvhRebuildRatio && count <= budget) {
+		budget -= count;
+		rebuildSubtree(node);
+		return;
+	}
+
+	m_nodes[node].dirty = false;
+
+	Aabb bounds;
+	if (child == kNone) {
+		for (uint32_t i = first; i < first + count; i++) {
+			bounds.grow(m_boxes[m_items[i]]);
+		}
+	}
+	else {
+		refitNode(child, budget);
+		refitNode(child + 1, budget);
+		bounds.grow(m_nodes[child].bounds);
+		bounds.grow(m_nodes[child + 1].bounds);
+	}
+
+	m_nodes[node].bounds = bounds;
+}
+
+void Bvh::rebuildSubtree(uint32_t node)
+{
+	BF_PROFILE_ZONE("Bvh::rebuildSubtree");
+
+	//Same ids, same range of m_items - only the shape below node changes
+	freeChildren(node);
+	buildNode(node, m_nodes[node].first, m_nodes[node].count);
+}
+
+void Bvh::freeChildren(uint32_t node)
+{
+	const uint32_t child = m_nodes[node].child;
+	if (child == kNone) return;
+
+	freeChildren(child);
+	freeChildren(child + 1);
+
+	m_freePairs.push_back(child);
+	m_nodes[node].child = kNone;
+}
+
+uint32_t Bvh::allocatePair(uint32_t parent)
+{
+	uint32_t child;
+	if (!m_freePairs.empty()) {
+		child = m_freePairs.back();
+		m_freePairs.pop_back();
+	}
+	else {
+		child = static_cast<uint32_t>(m_nodes.size());
+		m_nodes.resize(m_nodes.size() + 2);
+	}
+
+	m_nodes[child].parent = parent;
+	m_nodes[child + 1].parent = parent;
+	return child;
+}
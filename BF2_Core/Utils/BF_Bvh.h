@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "BF_Aabb.h"
+
+//Bounding volume hierarchy over dense ids (Scene entities). Built with the binned
+//surface area heuristic, refit in place as boxes move, and subtrees whose refits
+//have bloated them past kBvhRebuildRatio are rebuilt a budgeted few per refit.
+class Bvh {
+public:
+	Bvh();
+	Bvh(const Bvh&) = delete;
+	Bvh& operator=(const Bvh&) = delete;
+
+	//Full SAH build, boxes[i] is id i
+	void build(const Aabb* boxes, size_t count);
+	void clear();
+
+	//Adds id with its box. Held aside and tested linearly until enough have
+	//gathered that a refit folds them in with a full build.
+	void insert(uint32_t id, const Aabb&);
+
+	//Moves id's box, the tree catches up on the next refit
+	void update(uint32_t id, const Aabb&);
+
+	//Once per frame after the updates
+	void refit();
+
+	//Appends every id whose box overlaps
+	void queryBox(const Aabb&, std::vector<uint32_t>& out) const;
+
+	//Appends every id whose box is at least partly inside, planes normalized and facing inwards
+	void queryFrustum(const glm::vec4 planes[6], std::vector<uint32_t>& out) const;
+
+	//Nearest box along the ray, direction normalized
+	bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, uint32_t& id, float& distance) const;
+
+	const Aabb& getBox(uint32_t id) const;
+	const size_t getNodeCount() const;
+
+private:
+	struct Node {
+		Aabb bounds;
+		float builtArea;	//surface area when last built, refits are measured against it
+		uint32_t parent;
+		uint32_t child;		//left child, the right one follows it - kNone for leaves
+		uint32_t first;		//every subtree owns the contiguous m_items[first, first + count)
+		uint32_t count;
+		bool dirty;
+	};
+
+	static constexpr uint32_t kNone = ~0u;
+
+	void buildTree();
+	void buildNode(uint32_t node, uint32_t first, uint32_t count);
+	void refitNode(uint32_t node, uint32_t& budget);
+	void rebuildSubtree(uint32_t node);
+	void freeChildren(uint32_t node);
+	uint32_t allocatePair(uint32_t parent);
+
+	std::vector<Node> m_nodes;
+	std::vector<uint32_t> m_freePairs;
+
+	//Ids in leaf order, and per id its box and leaf (kNone while pending)
+	std::vector<uint32_t> m_items;
+	std::vector<Aabb> m_boxes;
+	std::vector<uint32_t> m_leafOf;
+
+	std::vector<uint32_t> m_pending;
+};
@@ -1,9 +1,69 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 //Version
 constexpr int kMajor = 0;
 constexpr int kMinor = 0;
 constexpr int kPatch = 1;
 
 //Window title
-constexpr const char* kWindowTitle = "BlastFurnace2";
\ No newline at end of file
+constexpr const char* kWindowTitle = "BlastFurnace2";
+
+//Frame time budget (hitches are frames over it) and stats report period in seconds
+constexpr double kFrameBudgetMs = 1000.0 / 60.0;
+constexpr double kFrameReportInterval = 5.0;
+
+//Shader locations - the pak is preferred when present (Media/pack.bat)
+constexpr const char* kShaderDirectory = "../Media/Shaders/";
+constexpr const char* kShaderPak = "../Media/Shaders.pak";
+
+//Recompile edited GLSL while running (glslangValidator from VULKAN_SDK or PATH)
+constexpr bool kShaderHotReload = true;
+
+//Alpha below this is discarded by pipelines built with kShaderAlphaTest
+constexpr float kAlphaTestCutoff = 0.5f;
+
+//Fixed simulation step, catch-up cap per rendered frame and largest frame delta banked
+constexpr double kFixedTimestep = 1.0 / 60.0;
+constexpr uint32_t kMaxSimStepsPerFrame = 5;
+constexpr double kMaxFrameDelta = 0.25;
+
+//Largest LOD error allowed on screen in pixels, and the fraction below that a
+//coarser level must project to before switching down (hysteresis against popping)
+constexpr float kLodPixelError = 1.0f;
+constexpr float kLodHysteresis = 0.25f;
+
+//Scene BVH - a subtree is rebuilt once refits grow its surface area past this
+//multiple of the built one, with at most this many entities rebuilt per frame
+constexpr float kBvhRebuildRatio = 2.0f;
+constexpr uint32_t kBvhRebuildBudget = 4096;
+
+//Scene uniform grid - cell edge in world units (around a typical entity's size),
+//and threads for a bulk rebuild, 0 for one per core
+constexpr float kGridCellSize = 4.0f;
+constexpr uint32_t kGridRebuildThreads = 0;
+
+//Frame limiter target in seconds, 0 for unlimited
+constexpr double kTargetFrameTime = 1.0 / 60.0;
+
+//Texture streaming - device memory for mips finer than the tails, and the
+//staging space for one frame's uploads (levels larger than it never stream in)
+constexpr size_t kTextureMemoryBudget = 256 * 1024 * 1024;
+constexpr size_t kTextureStagingSize = 64 * 1024 * 1024;
+
+//Threads servicing async file reads (io_uring builds use a single ring thread)
+constexpr uint32_t kIOWorkerThreads = 2;
+
+//Profiler capture written at shutdown (chrome://tracing / ui.perfetto.dev)
+constexpr bool kProfilerCaptureOnExit = true;
+constexpr const char* kProfilerTraceFile = "bf2_trace.json";
+
+//Live heap budgets per subsystem in bytes (mem::Tag), 0 for none
+constexpr size_t kGraphicsMemoryBudget = 256 * 1024 * 1024;
+constexpr size_t kSceneMemoryBudget = 64 * 1024 * 1024;
+constexpr size_t kAssetsMemoryBudget = 512 * 1024 * 1024;
+
+//Route Vulkan host allocations through the engine pools (VkHostAllocator)
+constexpr bool kUseVkHostAllocator = true;
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "BF_FrameLimiter.h"
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#ifdef _WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+	#include <timeapi.h>
+	#pragma comment(lib, "winmm")
+#endif
+
+//Restart the sleep statistics periodically so they follow changes in system load
+static constexpr uint32_t kSleepSamplesMax = 1000;
+
+FrameLimiter::FrameLimiter() : m_targetFrameTime(0.0), m_deadline(0.0),
+	m_sleepEstimate(0.005), m_sleepMean(0.005), m_sleepM2(0.0), m_sleepCount(1)
+{
+}
+
+void FrameLimiter::init(Clock clock, double targetFrameTime)
+{
+	m_clock = std::move(clock);
+	m_targetFrameTime = targetFrameTime;
+	m_deadline = m_clock();
+
+#ifdef _WIN32
+	//Default scheduler granularity is ~15.6ms, far too coarse to pace frames
+	timeBeginPeriod(1);
+#endif
+}
+
+void FrameLimiter::shutdown()
+{
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif
+}
+
+void FrameLimiter::setTargetFrameTime(double seconds)
+{
+	m_targetFrameTime = seconds;
+}
+
+const double FrameLimiter::getTargetFrameTime() const
+{
+	return m_targetFrameTime;
+}
+
+void FrameLimiter::wait()
+{
+	if (m_targetFrameTime <= 0.0 || !m_clock) return;
+
+	//Advance by whole frames so pacing doesn't drift
+	m_deadline += m_targetFrameTime;
+
+	//Fell more than a frame behind - resync rather than rushing to catch up
+	const double now = m_clock();
+	if (now > m_deadline + m_targetFrameTime)
+	{
+		m_deadline = now;
+		return;
+	}
+
+	sleepUntil(m_deadline);
+}
+
+void FrameLimiter::sleepUntil(double deadline)
+{
+	double now = m_clock();
+
+	//OS sleep while there is comfortably more time left than a sleep overshoots by
+	while (deadline - now > m_sleepEstimate)
+	{
+		const double start = now;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		now = m_clock();
+
+		//Welford's running mean/variance of the observed sleep
+		const double observed = now - start;
+		m_sleepCount++;
+		const double delta = observed - m_sleepMean;
+		m_sleepMean += delta / m_sleepCount;
+		m_sleepM2 += delta * (observed - m_sleepMean);
+
+		const double stddev = std::sqrt(m_sleepM2 / (m_sleepCount - 1));
+		m_sleepEstimate = m_sleepMean + stddev;
+
+		if (m_sleepCount > kSleepSamplesMax)
+		{
+			m_sleepCount = 1;
+			m_sleepMean = m_sleepEstimate;
+			m_sleepM2 = 0.0;
+		}
+	}
+
+	//Spin out the remainder for accuracy
+	while (m_clock() < deadline)
+	{
+		std::this_thread::yield();
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+class FrameLimiter {
+public:
+	//Clock returns seconds - the same clock the frame is timed with
+	using Clock = std::function<double()>;
+
+	FrameLimiter();
+	FrameLimiter(const FrameLimiter&) = delete;
+	FrameLimiter& operator=(const FrameLimiter&) = delete;
+
+	void init(Clock clock, double targetFrameTime);
+	void shutdown();
+
+	//0 disables limiting
+	void setTargetFrameTime(double seconds);
+	const double getTargetFrameTime() const;
+
+	//Block until the current frame's slot is over
+	void wait();
+
+private:
+	void sleepUntil(double deadline);
+
+	Clock m_clock;
+	double m_targetFrameTime;
+	double m_deadline;
+
+	//Running mean/variance of how long a 1ms sleep really takes, so we
+	//know when to stop sleeping and start spinning
+	double m_sleepEstimate;
+	double m_sleepMean;
+	double m_sleepM2;
+	uint32_t m_sleepCount;
+};
@@ -0,0 +1,147 @@
+#include "BF_FrameStats.h"
+#include "BF_Error.h"
+
+#include <algorithm>
+
+static uint32_t bucketOf(double ms)
+{
+	const double bucket = ms / kFrameStatsBucketMs;
+	return bucket >= kFrameStatsBucketCount - 1 ? kFrameStatsBucketCount - 1 : static_cast<uint32_t>(bucket);
+}
+
+FrameStats::FrameStats() : m_windowNext(0), m_windowCount(0), m_windowTotalMs(0.0), m_frameCount(0),
+	m_budgetMs(1000.0 / 60.0), m_intervalHitches(0), m_intervalFrames(0), m_reportInterval(0.0), m_sinceReport(0.0)
+{
+	m_histogram.fill(0);
+	m_window.fill(0.0f);
+}
+
+void FrameStats::setBudget(double ms)
+{
+	m_budgetMs = ms;
+}
+
+void FrameStats::setReportInterval(double seconds)
+{
+	m_reportInterval = seconds;
+}
+
+void FrameStats::setReportCallback(ReportCallback callback)
+{
+	m_reportCallback = std::move(callback);
+}
+
+void FrameStats::setHitchCallback(HitchCallback callback)
+{
+	m_hitchCallback = std::move(callback);
+}
+
+void FrameStats::addFrame(double seconds)
+{
+	const double ms = seconds * 1000.0;
+
+	//Window full - drop the oldest frame from the histogram
+	if (m_windowCount == kFrameStatsWindow)
+	{
+		const float oldest = m_window[m_windowNext];
+		m_histogram[bucketOf(oldest)]--;
+		m_windowTotalMs -= oldest;
+	}
+	else
+	{
+		m_windowCount++;
+	}
+
+	//Bucketed from the stored float, as eviction does - the double can land in
+	//the bucket below near an edge and the count would underflow on removal
+	const float stored = static_cast<float>(ms);
+	m_window[m_windowNext] = stored;
+	m_windowNext = (m_windowNext + 1) % kFrameStatsWindow;
+	m_histogram[bucketOf(stored)]++;
+	m_windowTotalMs += stored;
+
+	m_frameCount++;
+	m_intervalFrames++;
+
+	//Hitch detection
+	if (ms > m_budgetMs)
+	{
+		m_intervalHitches++;
+
+		if (m_hitchCallback)
+		{
+			m_hitchCallback(m_frameCount, ms, m_budgetMs);
+		}
+	}
+
+	//Periodic report
+	m_sinceReport += seconds;
+	if (m_reportInterval > 0.0 && m_sinceReport >= m_reportInterval)
+	{
+		report();
+	}
+}
+
+FrameReport FrameStats::getReport() const
+{
+	FrameReport r = {};
+	r.frameCount = m_frameCount;
+	r.windowFrames = m_windowCount;
+	r.budgetMs = m_budgetMs;
+	r.hitches = m_intervalHitches;
+	r.intervalFrames = m_intervalFrames;
+
+	if (m_windowCount == 0)
+	{
+		return r;
+	}
+
+	r.avgMs = m_windowTotalMs / m_windowCount;
+
+	//Exact max from the window, percentiles from the histogram
+	for (uint32_t i = 0; i < m_windowCount; i++)
+	{
+		r.maxMs = std::max(r.maxMs, static_cast<double>(m_window[i]));
+	}
+
+	const uint32_t p50Rank = (m_windowCount * 50 + 99) / 100;
+	const uint32_t p95Rank = (m_windowCount * 95 + 99) / 100;
+	const uint32_t p99Rank = (m_windowCount * 99 + 99) / 100;
+
+	uint32_t cumulative = 0;
+	for (uint32_t i = 0; i < kFrameStatsBucketCount; i++)
+	{
+		const uint32_t before = cumulative;
+		cumulative += m_histogram[i];
+
+		//Report the bucket's upper edge, clamped so it never exceeds the true max.
+		//The last bucket also holds every longer frame, it has no edge but the max.
+		const double edge = i == kFrameStatsBucketCount - 1 ? r.maxMs : std::min((i + 1) * kFrameStatsBucketMs, r.maxMs);
+		if (before < p50Rank && cumulative >= p50Rank) r.p50Ms = edge;
+		if (before < p95Rank && cumulative >= p95Rank) r.p95Ms = edge;
+		if (before < p99Rank && cumulative >= p99Rank) r.p99Ms = edge;
+
+		if (cumulative >= p99Rank) break;
+	}
+
+	return r;
+}
+
+void FrameStats::report()
+{
+	const FrameReport r = getReport();
+
+	if (m_reportCallback)
+	{
+		m_reportCallback(r);
+	}
+	else
+	{
+		debugF("Frame: avg %.2fms p50 %.2fms p95 %.2fms p99 %.2fms max %.2fms - %u/%u over %.2fms budget\n",
+			r.avgMs, r.p50Ms, r.p95Ms, r.p99Ms, r.maxMs, r.hitches, r.intervalFrames, r.budgetMs);
+	}
+
+	m_sinceReport = 0.0;
+	m_intervalHitches = 0;
+	m_intervalFrames = 0;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+
+//Histogram resolution - 0.1ms buckets up to 100ms, anything slower lands in the last bucket
+constexpr double kFrameStatsBucketMs = 0.1;
+constexpr uint32_t kFrameStatsBucketCount = 1000;
+
+//Frames in the rolling window percentiles are taken over
+constexpr uint32_t kFrameStatsWindow = 1024;
+
+struct FrameReport {
+	uint64_t frameCount;		//frames seen in total
+	uint32_t windowFrames;		//frames the percentiles cover
+
+	double avgMs;
+	double p50Ms;
+	double p95Ms;
+	double p99Ms;
+	double maxMs;
+
+	double budgetMs;
+	uint32_t hitches;			//frames over budget since the last report
+	uint32_t intervalFrames;	//frames since the last report
+};
+
+class FrameStats {
+public:
+	using ReportCallback = std::function<void(const FrameReport&)>;
+	using HitchCallback = std::function<void(uint64_t frame, double ms, double budgetMs)>;
+
+	FrameStats();
+	FrameStats(const FrameStats&) = delete;
+	FrameStats& operator=(const FrameStats&) = delete;
+
+	void setBudget(double ms);
+	void setReportInterval(double seconds);
+
+	//Without a report callback reports go to debugF
+	void setReportCallback(ReportCallback);
+	void setHitchCallback(HitchCallback);
+
+	void addFrame(double seconds);
+
+	FrameReport getReport() const;
+
+private:
+	void report();
+
+	std::array<uint32_t, kFrameStatsBucketCount> m_histogram;
+
+	//Ring of the frames in the window, so old ones can leave the histogram
+	std::array<float, kFrameStatsWindow> m_window;
+	uint32_t m_windowNext;
+	uint32_t m_windowCount;
+	double m_windowTotalMs;
+
+	uint64_t m_frameCount;
+
+	double m_budgetMs;
+	uint32_t m_intervalHitches;
+	uint32_t m_intervalFrames;
+
+	double m_reportInterval;
+	double m_sinceReport;
+
+	ReportCallback m_reportCallback;
+	HitchCallback m_hitchCallback;
+};
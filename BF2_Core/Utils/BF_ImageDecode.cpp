@@ -0,0 +1,580 @@
+#include "BF_ImageDecode.h"
+#include "BF_Error.h"
+#include "BF_Memory.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+	//Inflate (RFC 1951), just enough for PNG's zlib stream
+
+	constexpr uint32_t kMaxCodeBits = 15;
+
+	constexpr uint16_t kLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	constexpr uint8_t kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	constexpr uint16_t kDistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	constexpr uint8_t kDistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	constexpr uint8_t kCodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	struct BitReader {
+		const uint8_t* data;
+		size_t size;
+		size_t position;
+		uint32_t buffer;
+		uint32_t count;
+		bool overrun;
+
+		uint32_t bits(uint32_t needed)
+		{
+			while (count < needed) {
+				if (position >= size) {
+					overrun = true;
+					return 0;
+				}
+				buffer |= static_cast<uint32_t>(data[position++]) << count;
+				count += 8;
+			}
+
+			const uint32_t value = buffer & ((1u << needed) - 1);
+			buffer >>= needed;
+			count -= needed;
+			return value;
+		}
+
+		void alignToByte()
+		{
+			buffer = 0;
+			count = 0;
+		}
+	};
+
+	//Canonical code as symbol counts per length and symbols in code order
+	struct Huffman {
+		uint16_t counts[kMaxCodeBits + 1];
+		uint16_t symbols[288];
+	};
+
+	//0 if the lengths oversubscribe the code - incomplete codes are allowed,
+	//deflate uses them for a single distance code
+	int BuildHuffman(Huffman& code, const uint8_t* lengths, uint32_t count)
+	{
+		std::memset(code.counts, 0, sizeof(code.counts));
+		for (uint32_t symbol = 0; symbol < count; symbol++) {
+			code.counts[lengths[symbol]]++;
+		}
+
+		int left = 1;
+		for (uint32_t length = 1; length <= kMaxCodeBits; length++) {
+			left = left * 2 - code.counts[length];
+			if (left < 0) return 0;
+		}
+
+		uint16_t offsets[kMaxCodeBits + 1];
+		offsets[1] = 0;
+		for (uint32_t length = 1; length < kMaxCodeBits; length++) {
+			offsets[length + 1] = offsets[length] + code.counts[length];
+		}
+
+		for (uint32_t symbol = 0; symbol < count; symbol++) {
+			if (lengths[symbol] != 0) code.symbols[offsets[lengths[symbol]]++] = static_cast<uint16_t>(symbol);
+		}
+
+		return 1;
+	}
+
+	//A bit at a time, codes are stored most significant bit first
+	int DecodeSymbol(BitReader& reader, const Huffman& code)
+	{
+		int value = 0;
+		int first = 0;
+		int index = 0;
+		for (uint32_t length = 1; length <= kMaxCodeBits; length++) {
+			value |= static_cast<int>(reader.bits(1));
+			const int count = code.counts[length];
+			if (value - first < count) return code.symbols[index + value - first];
+
+			index += count;
+			first = (first + count) << 1;
+			value <<= 1;
+		}
+		return -1;
+	}
+
+	bool InflateCodes(BitReader& reader, const Huffman& lengthCode, const Huffman& distanceCode, std::vector<uint8_t>& out)
+	{
+		for (;;) {
+			const int symbol = DecodeSymbol(reader, lengthCode);
+			if (symbol < 0 || reader.overrun) return false;
+
+			if (symbol < 256) {
+				out.push_back(static_cast<uint8_t>(symbol));
+				continue;
+			}
+			if (symbol == 256) return true;
+
+			const int lengthIndex = symbol - 257;
+			if (lengthIndex >= 29) return false;
+			const size_t length = kLengthBase[lengthIndex] + reader.bits(kLengthExtra[lengthIndex]);
+
+			const int distanceIndex = DecodeSymbol(reader, distanceCode);
+			if (distanceIndex < 0 || distanceIndex >= 30) return false;
+			const size_t distance = kDistanceBase[distanceIndex] + reader.bits(kDistanceExtra[distanceIndex]);
+
+			if (reader.overrun || distance > out.size()) return false;
+
+			//Byte by byte, the copy may overlap what it writes
+			const size_t from = out.size() - distance;
+			for (size_t i = 0; i < length; i++) {
+				out.push_back(out[from + i]);
+			}
+		}
+	}
+
+	bool Inflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out)
+	{
+		BitReader reader = { data, size, 0, 0, 0, false };
+
+		Huffman lengthCode;
+		Huffman distanceCode;
+
+		uint32_t last = 0;
+		while (!last) {
+			last = reader.bits(1);
+			const uint32_t type = reader.bits(2);
+
+			if (type == 0) {
+				//Stored - LEN and its complement, then the bytes as they are
+				reader.alignToByte();
+				if (reader.position + 4 > size) return false;
+
+				const uint32_t length = data[reader.position] | (data[reader.position + 1] << 8);
+				const uint32_t complement = data[reader.position + 2] | (data[reader.position + 3] << 8);
+				reader.position += 4;
+
+				if ((length ^ 0xffff) != complement || reader.position + length > size) return false;
+				out.insert(out.end(), data + reader.position, data + reader.position + length);
+				reader.position += length;
+				continue;
+			}
+
+			uint8_t lengths[320];
+			if (type == 1) {
+				//Fixed codes
+				uint32_t symbol = 0;
+				for (; symbol < 144; symbol++) lengths[symbol] = 8;
+				for (; symbol < 256; symbol++) lengths[symbol] = 9;
+				for (; symbol < 280; symbol++) lengths[symbol] = 7;
+				for (; symbol < 288; symbol++) lengths[symbol] = 8;
+				BuildHuffman(lengthCode, lengths, 288);
+
+				for (symbol = 0; symbol < 30; symbol++) lengths[symbol] = 5;
+				BuildHuffman(distanceCode, lengths, 30);
+			}
+			else if (type == 2) {
+				//Dynamic codes, their lengths themselves huffman coded
+				const uint32_t lengthCount = reader.bits(5) + 257;
+				const uint32_t distanceCount = reader.bits(5) + 1;
+				const uint32_t codeLengthCount = reader.bits(4) + 4;
+				if (lengthCount > 286 || distanceCount > 30) return false;
+
+				std::memset(lengths, 0, 19);
+				for (uint32_t i = 0; i < codeLengthCount; i++) {
+					lengths[kCodeLengthOrder[i]] = static_cast<uint8_t>(reader.bits(3));
+				}
+
+				Huffman codeLengthCode;
+				if (!BuildHuffman(codeLengthCode, lengths, 19)) return false;
+
+				uint32_t index = 0;
+				while (index < lengthCount + distanceCount) {
+					const int symbol = DecodeSymbol(reader, codeLengthCode);
+					if (symbol < 0 || reader.overrun) return false;
+
+					if (symbol < 16) {
+						lengths[index++] = static_cast<uint8_t>(symbol);
+						continue;
+					}
+
+					uint8_t repeated = 0;
+					uint32_t repeat;
+					if (symbol == 16) {
+						if (index == 0) return false;
+						repeated = lengths[index - 1];
+						repeat = 3 + reader.bits(2);
+					}
+					else if (symbol == 17) {
+						repeat = 3 + reader.bits(3);
+					}
+					else {
+						repeat = 11 + reader.bits(7);
+					}
+
+					if (index + repeat > lengthCount + distanceCount) return false;
+					while (repeat--) lengths[index++] = repeated;
+				}
+
+				if (lengths[256] == 0) return false;
+				if (!BuildHuffman(lengthCode, lengths, lengthCount)) return false;
+				if (!BuildHuffman(distanceCode, lengths + lengthCount, distanceCount)) return false;
+			}
+			else {
+				return false;
+			}
+
+			if (!InflateCodes(reader, lengthCode, distanceCode, out)) return false;
+		}
+
+		return !reader.overrun;
+	}
+
+	uint32_t ReadBigEndian(const uint8_t* bytes)
+	{
+		return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) | (static_cast<uint32_t>(bytes[2]) << 8) | bytes[3];
+	}
+
+	uint8_t Paeth(uint8_t a, uint8_t b, uint8_t c)
+	{
+		const int p = a + b - c;
+		const int pa = std::abs(p - a);
+		const int pb = std::abs(p - b);
+		const int pc = std::abs(p - c);
+		if (pa <= pb && pa <= pc) return a;
+		return pb <= pc ? b : c;
+	}
+
+	constexpr uint8_t kPngSignature[8] = { 0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	constexpr uint8_t kPngGrey = 0;
+	constexpr uint8_t kPngRgb = 2;
+	constexpr uint8_t kPngPalette = 3;
+	constexpr uint8_t kPngGreyAlpha = 4;
+	constexpr uint8_t kPngRgbAlpha = 6;
+
+	constexpr uint8_t kTgaRgb = 2;
+	constexpr uint8_t kTgaGrey = 3;
+	constexpr uint8_t kTgaRleRgb = 10;
+	constexpr uint8_t kTgaRleGrey = 11;
+	constexpr uint8_t kTgaTopOrigin = 0x20;
+}
+
+bool img::DecodePng(const char* data, size_t size, Image& out)
+{
+	out = {};
+
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+	if (size < sizeof(kPngSignature) || std::memcmp(bytes, kPngSignature, sizeof(kPngSignature)) != 0) {
+		errorF("img::DecodePng() - not a PNG");
+		return false;
+	}
+
+	uint32_t width = 0, height = 0;
+	uint8_t bitDepth = 0, colourType = 0, interlace = 0;
+	uint8_t palette[256][4];
+	uint32_t paletteSize = 0;
+	uint16_t transparent[3] = {};
+	bool hasTransparent = false;
+	std::vector<uint8_t> compressed;
+
+	for (auto& entry : palette) {
+		entry[0] = entry[1] = entry[2] = 0;
+		entry[3] = 255;
+	}
+
+	//Chunks - length, type, data, CRC (not checked)
+	size_t position = sizeof(kPngSignature);
+	bool ended = false;
+	while (!ended && position + 12 <= size) {
+		const uint32_t length = ReadBigEndian(bytes + position);
+		const uint8_t* type = bytes + position + 4;
+		const uint8_t* chunk = bytes + position + 8;
+		if (length > size - position - 12) break;
+		position += 12 + length;
+
+		if (std::memcmp(type, "IHDR", 4) == 0 && length >= 13) {
+			width = ReadBigEndian(chunk);
+			height = ReadBigEndian(chunk + 4);
+			bitDepth = chunk[8];
+			colourType = chunk[9];
+			interlace = chunk[12];
+		}
+		else if (std::memcmp(type, "PLTE", 4) == 0) {
+			paletteSize = std::min(256u, length / 3);
+			for (uint32_t i = 0; i < paletteSize; i++) {
+				palette[i][0] = chunk[i * 3];
+				palette[i][1] = chunk[i * 3 + 1];
+				palette[i][2] = chunk[i * 3 + 2];
+			}
+		}
+		else if (std::memcmp(type, "tRNS", 4) == 0) {
+			if (colourType == kPngPalette) {
+				for (uint32_t i = 0; i < std::min(256u, length); i++) {
+					palette[i][3] = chunk[i];
+				}
+			}
+			else if (colourType == kPngGrey && length >= 2) {
+				transparent[0] = static_cast<uint16_t>((chunk[0] << 8) | chunk[1]);
+				hasTransparent = true;
+			}
+			else if (colourType == kPngRgb && length >= 6) {
+				for (int channel = 0; channel < 3; channel++) {
+					transparent[channel] = static_cast<uint16_t>((chunk[channel * 2] << 8) | chunk[channel * 2 + 1]);
+				}
+				hasTransparent = true;
+			}
+		}
+		else if (std::memcmp(type, "IDAT", 4) == 0) {
+			compressed.insert(compressed.end(), chunk, chunk + length);
+		}
+		else if (std::memcmp(type, "IEND", 4) == 0) {
+			ended = true;
+		}
+	}
+
+	uint32_t channels;
+	switch (colourType) {
+	case kPngGrey: channels = 1; break;
+	case kPngRgb: channels = 3; break;
+	case kPngPalette: channels = 1; break;
+	case kPngGreyAlpha: channels = 2; break;
+	case kPngRgbAlpha: channels = 4; break;
+	default:
+		errorF("img::DecodePng() - unknown colour type %u", colourType);
+		return false;
+	}
+
+	const bool validDepth = colourType == kPngPalette ? (bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8) :
+		colourType == kPngGrey ? (bitDepth == 1 || bitDepth == 2 || bitDepth == 4 || bitDepth == 8 || bitDepth == 16) :
+		(bitDepth == 8 || bitDepth == 16);
+
+	if (width == 0 || height == 0 || !validDepth) {
+		errorF("img::DecodePng() - bad header (%ux%u, %u bit)", width, height, bitDepth);
+		return false;
+	}
+	if (interlace != 0) {
+		errorF("img::DecodePng() - interlaced images are not supported");
+		return false;
+	}
+
+	//zlib wrapper - method 8, no preset dictionary, Adler-32 not checked
+	if (compressed.size() < 2 || (compressed[0] & 0x0f) != 8 || (compressed[1] & 0x20) || ((compressed[0] << 8) | compressed[1]) % 31 != 0) {
+		errorF("img::DecodePng() - bad zlib stream");
+		return false;
+	}
+
+	const size_t bitsPerPixel = static_cast<size_t>(channels) * bitDepth;
+	const size_t stride = (width * bitsPerPixel + 7) / 8;
+	const size_t filterStep = std::max<size_t>(1, bitsPerPixel / 8);
+
+	std::vector<uint8_t> raw;
+	raw.reserve((stride + 1) * height);
+	if (!Inflate(compressed.data() + 2, compressed.size() - 2, raw) || raw.size() < (stride + 1) * height) {
+		errorF("img::DecodePng() - corrupt image data");
+		return false;
+	}
+
+	//Undo the per row filters in place, each row led by its filter type
+	std::vector<uint8_t> previous(stride, 0);
+	std::vector<uint8_t> rows(stride * height);
+	for (uint32_t y = 0; y < height; y++) {
+		const uint8_t filter = raw[y * (stride + 1)];
+		const uint8_t* source = raw.data() + y * (stride + 1) + 1;
+		uint8_t* row = rows.data() + y * stride;
+
+		for (size_t x = 0; x < stride; x++) {
+			const uint8_t left = x >= filterStep ? row[x - filterStep] : 0;
+			const uint8_t up = previous[x];
+			const uint8_t upLeft = x >= filterStep ? previous[x - filterStep] : 0;
+
+			switch (filter) {
+			case 0: row[x] = source[x]; break;
+			case 1: row[x] = static_cast<uint8_t>(source[x] + left); break;
+			case 2: row[x] = static_cast<uint8_t>(source[x] + up); break;
+			case 3: row[x] = static_cast<uint8_t>(source[x] + ((left + up) >> 1)); break;
+			case 4: row[x] = static_cast<uint8_t>(source[x] + Paeth(left, up, upLeft)); break;
+			default:
+				errorF("img::DecodePng() - unknown filter %u on row %u", filter, y);
+				return false;
+			}
+		}
+		std::memcpy(previous.data(), row, stride);
+	}
+
+	out.width = width;
+	out.height = height;
+	out.rgba.resize(static_cast<size_t>(width) * height * 4);
+
+	//Samples as stored, before any scaling - what tRNS colour keys compare against
+	auto sample = [&](const uint8_t* row, size_t index) -> uint32_t {
+		if (bitDepth == 16) return (row[index * 2] << 8) | row[index * 2 + 1];
+		if (bitDepth == 8) return row[index];
+
+		const size_t bit = index * bitDepth;
+		return (row[bit / 8] >> (8 - bitDepth - bit % 8)) & ((1u << bitDepth) - 1);
+	};
+	auto to8 = [&](uint32_t value) -> uint8_t {
+		if (bitDepth == 16) return static_cast<uint8_t>(value >> 8);
+		return static_cast<uint8_t>(value * 255 / ((1u << bitDepth) - 1));
+	};
+
+	for (uint32_t y = 0; y < height; y++) {
+		const uint8_t* row = rows.data() + y * stride;
+		uint8_t* texel = out.rgba.data() + static_cast<size_t>(y) * width * 4;
+
+		for (uint32_t x = 0; x < width; x++, texel += 4) {
+			const size_t first = static_cast<size_t>(x) * channels;
+
+			switch (colourType) {
+			case kPngGrey: {
+				const uint32_t grey = sample(row, first);
+				texel[0] = texel[1] = texel[2] = to8(grey);
+				texel[3] = hasTransparent && grey == transparent[0] ? 0 : 255;
+				break;
+			}
+			case kPngRgb: {
+				const uint32_t r = sample(row, first), g = sample(row, first + 1), b = sample(row, first + 2);
+				texel[0] = to8(r);
+				texel[1] = to8(g);
+				texel[2] = to8(b);
+				texel[3] = hasTransparent && r == transparent[0] && g == transparent[1] && b == transparent[2] ? 0 : 255;
+				break;
+			}
+			case kPngPalette:
+				std::memcpy(texel, palette[sample(row, first)], 4);
+				break;
+			case kPngGreyAlpha:
+				texel[0] = texel[1] = texel[2] = to8(sample(row, first));
+				texel[3] = to8(sample(row, first + 1));
+				break;
+			default:
+				for (uint32_t channel = 0; channel < 4; channel++) {
+					texel[channel] = to8(sample(row, first + channel));
+				}
+				break;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool img::DecodeTga(const char* data, size_t size, Image& out)
+{
+	out = {};
+
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+	if (size < 18) {
+		errorF("img::DecodeTga() - too small to be a TGA");
+		return false;
+	}
+
+	const uint8_t idLength = bytes[0];
+	const uint8_t colourMapType = bytes[1];
+	const uint8_t imageType = bytes[2];
+	const uint32_t colourMapLength = bytes[5] | (bytes[6] << 8);
+	const uint32_t colourMapEntryBits = bytes[7];
+	const uint32_t width = bytes[12] | (bytes[13] << 8);
+	const uint32_t height = bytes[14] | (bytes[15] << 8);
+	const uint32_t pixelBits = bytes[16];
+	const uint8_t descriptor = bytes[17];
+
+	const bool grey = imageType == kTgaGrey || imageType == kTgaRleGrey;
+	const bool rle = imageType == kTgaRleRgb || imageType == kTgaRleGrey;
+	if ((imageType != kTgaRgb && imageType != kTgaGrey && !rle) ||
+		(grey && pixelBits != 8) || (!grey && pixelBits != 24 && pixelBits != 32)) {
+		errorF("img::DecodeTga() - unsupported image type %u at %u bits", imageType, pixelBits);
+		return false;
+	}
+	if (width == 0 || height == 0) {
+		errorF("img::DecodeTga() - image has no size");
+		return false;
+	}
+
+	//Any colour map is skipped, true colour images don't use it
+	size_t position = 18 + idLength + (colourMapType == 1 ? colourMapLength * ((colourMapEntryBits + 7) / 8) : 0);
+	const uint32_t pixelBytes = pixelBits / 8;
+
+	out.width = width;
+	out.height = height;
+	out.rgba.resize(static_cast<size_t>(width) * height * 4);
+
+	//Stored BGR(A), bottom row first unless the descriptor says otherwise
+	auto store = [&](size_t index, const uint8_t* pixel) {
+		const size_t x = index % width;
+		const size_t y = descriptor & kTgaTopOrigin ? index / width : height - 1 - index / width;
+		uint8_t* texel = out.rgba.data() + (y * width + x) * 4;
+
+		if (grey) {
+			texel[0] = texel[1] = texel[2] = pixel[0];
+			texel[3] = 255;
+		}
+		else {
+			texel[0] = pixel[2];
+			texel[1] = pixel[1];
+			texel[2] = pixel[0];
+			texel[3] = pixelBytes == 4 ? pixel[3] : 255;
+		}
+	};
+
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+	size_t index = 0;
+	while (index < pixelCount) {
+		if (!rle) {
+			if (position + pixelBytes > size) break;
+			store(index++, bytes + position);
+			position += pixelBytes;
+			continue;
+		}
+
+		//Packets - a repeated pixel or a run of raw ones
+		if (position >= size) break;
+		const uint8_t header = bytes[position++];
+		const size_t count = std::min<size_t>((header & 0x7f) + 1, pixelCount - index);
+
+		if (header & 0x80) {
+			if (position + pixelBytes > size) break;
+			for (size_t i = 0; i < count; i++) store(index++, bytes + position);
+			position += pixelBytes;
+		}
+		else {
+			if (position + count * pixelBytes > size) break;
+			for (size_t i = 0; i < count; i++, position += pixelBytes) store(index++, bytes + position);
+		}
+	}
+
+	if (index < pixelCount) {
+		errorF("img::DecodeTga() - truncated at pixel %zu of %zu", index, pixelCount);
+		out = {};
+		return false;
+	}
+
+	return true;
+}
+
+bool img::Load(const std::string& filename, Image& out)
+{
+	auto endsWith = [&](const char* extension) {
+		const size_t length = std::strlen(extension);
+		if (filename.size() < length) return false;
+
+		for (size_t i = 0; i < length; i++) {
+			const char c = filename[filename.size() - length + i];
+			if ((c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c) != extension[i]) return false;
+		}
+		return true;
+	};
+
+	const bool png = endsWith(".png");
+	if (!png && !endsWith(".tga")) {
+		errorF("img::Load() - %s is neither a .png nor a .tga", filename.c_str());
+		return false;
+	}
+
+	mem::MappedFile file;
+	if (!file.open(filename)) {
+		errorF("img::Load() - failed to read %s", filename.c_str());
+		return false;
+	}
+
+	return png ? DecodePng(file.data(), file.size(), out) : DecodeTga(file.data(), file.size(), out);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//8 bit RGBA texels, rows top to bottom
+struct Image {
+	uint32_t width;
+	uint32_t height;
+	std::vector<uint8_t> rgba;
+};
+
+//Source image decoding for the offline tools - nothing at runtime loads these
+namespace img {
+	//Non-interlaced PNG of any colour type, 16 bit samples cut to 8
+	bool DecodePng(const char* data, size_t size, Image& out);
+
+	//Uncompressed or RLE TGA, 24/32 bit colour or 8 bit greyscale
+	bool DecodeTga(const char* data, size_t size, Image& out);
+
+	//Picks the decoder by extension, .png or .tga
+	bool Load(const std::string& filename, Image& out);
+}
@@ -0,0 +1,255 @@
+#include "BF_MemTrack.h"
+#include "BF_Error.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace {
+	constexpr size_t kTagCount = static_cast<size_t>(mem::Tag::Count);
+
+	const char* const kTagNames[kTagCount] = {
+		"General",
+		"Graphics",
+		"Scene",
+		"Assets",
+		"IO",
+	};
+
+	//Written from any thread, so relaxed atomics only
+	struct TagCounters {
+		std::atomic<size_t> live{ 0 };
+		std::atomic<size_t> peak{ 0 };
+		std::atomic<size_t> count{ 0 };
+		std::atomic<uint64_t> frameAllocations{ 0 };
+		std::atomic<uint64_t> frameBytes{ 0 };
+	};
+
+	//Main thread only - rolled and checked in BeginMemoryFrame
+	struct TagFrame {
+		uint64_t allocations;
+		uint64_t bytes;
+		size_t budget;
+		bool overBudget;
+	};
+
+	TagCounters s_counters[kTagCount];
+	TagFrame s_frames[kTagCount];
+	mem::BudgetCallback s_budgetCallback;
+
+	thread_local mem::Tag t_tag = mem::Tag::General;
+
+	void defaultBudgetCallback(mem::Tag tag, const mem::MemoryStats& stats)
+	{
+		errorF("mem - %s is over budget: %.2f MB of %.2f MB", mem::GetTagName(tag),
+			stats.liveBytes / (1024.0 * 1024.0), stats.budget / (1024.0 * 1024.0));
+	}
+}
+
+const char * mem::GetTagName(Tag tag)
+{
+	return static_cast<size_t>(tag) < kTagCount ? kTagNames[static_cast<size_t>(tag)] : "Unknown";
+}
+
+mem::Tag mem::GetCurrentTag()
+{
+	return t_tag;
+}
+
+void mem::SetCurrentTag(Tag tag)
+{
+	t_tag = tag;
+}
+
+mem::MemoryStats mem::GetMemoryStats(Tag tag)
+{
+	const size_t i = static_cast<size_t>(tag);
+
+	MemoryStats stats = {};
+	stats.liveBytes = s_counters[i].live.load(std::memory_order_relaxed);
+	stats.peakBytes = s_counters[i].peak.load(std::memory_order_relaxed);
+	stats.liveAllocations = s_counters[i].count.load(std::memory_order_relaxed);
+	stats.frameAllocations = s_frames[i].allocations;
+	stats.frameBytes = s_frames[i].bytes;
+	stats.budget = s_frames[i].budget;
+
+	return stats;
+}
+
+void mem::SetMemoryBudget(Tag tag, size_t bytes)
+{
+	s_frames[static_cast<size_t>(tag)].budget = bytes;
+	s_frames[static_cast<size_t>(tag)].overBudget = false;
+}
+
+void mem::SetBudgetCallback(BudgetCallback callback)
+{
+	s_budgetCallback = std::move(callback);
+}
+
+void mem::BeginMemoryFrame()
+{
+	for (size_t i = 0; i < kTagCount; i++)
+	{
+		TagFrame& frame = s_frames[i];
+		frame.allocations = s_counters[i].frameAllocations.exchange(0, std::memory_order_relaxed);
+		frame.bytes = s_counters[i].frameBytes.exchange(0, std::memory_order_relaxed);
+
+		if (frame.budget == 0) continue;
+
+		//Only report when crossing, not every frame spent over
+		const bool over = s_counters[i].live.load(std::memory_order_relaxed) > frame.budget;
+		if (over && !frame.overBudget)
+		{
+			const Tag tag = static_cast<Tag>(i);
+			const MemoryStats stats = GetMemoryStats(tag);
+
+			if (s_budgetCallback)
+			{
+				s_budgetCallback(tag, stats);
+			}
+			else
+			{
+				defaultBudgetCallback(tag, stats);
+			}
+		}
+		frame.overBudget = over;
+	}
+}
+
+void mem::ReportMemory()
+{
+	debugF("%-10s %12s %12s %10s %12s %12s", "Tag", "Live KB", "Peak KB", "Allocs", "Allocs/frame", "Budget KB");
+
+	for (size_t i = 0; i < kTagCount; i++)
+	{
+		const MemoryStats stats = GetMemoryStats(static_cast<Tag>(i));
+
+		debugF("%-10s %12.1f %12.1f %10llu %12llu %12.1f", kTagNames[i],
+			stats.liveBytes / 1024.0, stats.peakBytes / 1024.0,
+			static_cast<unsigned long long>(stats.liveAllocations),
+			static_cast<unsigned long long>(stats.frameAllocations),
+			stats.budget / 1024.0);
+	}
+}
+
+bool mem::ReportLeaks()
+{
+	bool clean = true;
+
+	//General holds statics and singletons that legitimately outlive shutdown
+	for (size_t i = static_cast<size_t>(Tag::General) + 1; i < kTagCount; i++)
+	{
+		const size_t count = s_counters[i].count.load(std::memory_order_relaxed);
+		if (count == 0) continue;
+
+		errorF("mem - %s leaked %llu bytes in %llu allocations", kTagNames[i],
+			static_cast<unsigned long long>(s_counters[i].live.load(std::memory_order_relaxed)),
+			static_cast<unsigned long long>(count));
+		clean = false;
+	}
+
+	return clean;
+}
+
+#ifndef BF_MEMTRACK_DISABLED
+
+//--- Global operator new/delete ---
+
+namespace {
+	//Sits directly in front of every tracked block. 16 bytes keeps the
+	//default new alignment; offset leads back to what malloc returned.
+	struct AllocHeader {
+		uint64_t size;
+		uint32_t offset;
+		uint8_t tag;
+		uint8_t pad[3];
+	};
+
+	static_assert(sizeof(AllocHeader) == 16, "AllocHeader must preserve 16 byte alignment");
+
+	void* trackedAlloc(size_t size, size_t alignment)
+	{
+		if (alignment < sizeof(AllocHeader)) alignment = sizeof(AllocHeader);
+
+		//A request this close to SIZE_MAX would wrap the padded size to a small
+		//block - fail it instead, so operator new throws bad_alloc
+		if (size > SIZE_MAX - alignment - sizeof(AllocHeader)) return nullptr;
+
+		//Room for the header in front of an aligned block
+		char* raw = static_cast<char*>(std::malloc(size + alignment + sizeof(AllocHeader)));
+		if (!raw) return nullptr;
+
+		const uintptr_t first = reinterpret_cast<uintptr_t>(raw) + sizeof(AllocHeader);
+		char* user = reinterpret_cast<char*>((first + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1));
+
+		const uint8_t tag = static_cast<uint8_t>(t_tag);
+
+		AllocHeader* header = reinterpret_cast<AllocHeader*>(user) - 1;
+		header->size = size;
+		header->offset = static_cast<uint32_t>(user - raw);
+		header->tag = tag;
+
+		TagCounters& counters = s_counters[tag];
+		const size_t live = counters.live.fetch_add(size, std::memory_order_relaxed) + size;
+		counters.count.fetch_add(1, std::memory_order_relaxed);
+		counters.frameAllocations.fetch_add(1, std::memory_order_relaxed);
+		counters.frameBytes.fetch_add(size, std::memory_order_relaxed);
+
+		size_t peak = counters.peak.load(std::memory_order_relaxed);
+		while (live > peak && !counters.peak.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+		{
+		}
+
+		return user;
+	}
+
+	void trackedFree(void* p)
+	{
+		if (!p) return;
+
+		//Charged back to the tag it was allocated under, whichever thread frees it
+		const AllocHeader* header = static_cast<const AllocHeader*>(p) - 1;
+		TagCounters& counters = s_counters[header->tag];
+		counters.live.fetch_sub(static_cast<size_t>(header->size), std::memory_order_relaxed);
+		counters.count.fetch_sub(1, std::memory_order_relaxed);
+
+		std::free(static_cast<char*>(p) - header->offset);
+	}
+
+	void* trackedNew(size_t size, size_t alignment)
+	{
+		void* p = trackedAlloc(size, alignment);
+		if (!p)
+		{
+			throw std::bad_alloc();
+		}
+		return p;
+	}
+}
+
+void* operator new(size_t size) { return trackedNew(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void* operator new[](size_t size) { return trackedNew(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void* operator new(size_t size, std::align_val_t alignment) { return trackedNew(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return trackedNew(size, static_cast<size_t>(alignment)); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return trackedAlloc(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return trackedAlloc(size, static_cast<size_t>(alignment)); }
+
+void operator delete(void* p) noexcept { trackedFree(p); }
+void operator delete[](void* p) noexcept { trackedFree(p); }
+void operator delete(void* p, size_t) noexcept { trackedFree(p); }
+void operator delete[](void* p, size_t) noexcept { trackedFree(p); }
+void operator delete(void* p, std::align_val_t) noexcept { trackedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { trackedFree(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { trackedFree(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { trackedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { trackedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { trackedFree(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { trackedFree(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { trackedFree(p); }
+
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+//Heap tracking by subsystem. Global operator new/delete are replaced (in
+//BF_MemTrack.cpp) so every allocation is charged to the calling thread's
+//current tag - a 16 byte header and a few relaxed atomics per call, cheap
+//enough to leave on in release. Define BF_MEMTRACK_DISABLED to compile it out.
+
+namespace mem {
+	enum class Tag : uint8_t {
+		General = 0,	//anything outside a TagScope, engine singletons
+		Graphics,
+		Scene,
+		Assets,
+		IO,
+		Count
+	};
+
+	const char* GetTagName(Tag);
+
+	//Tag charged for new allocations on this thread
+	Tag GetCurrentTag();
+	void SetCurrentTag(Tag);
+
+	//Charges allocations in the enclosing block to a tag
+	class TagScope {
+	public:
+		explicit TagScope(Tag tag) : m_previous(GetCurrentTag())
+		{
+			SetCurrentTag(tag);
+		}
+
+		~TagScope()
+		{
+			SetCurrentTag(m_previous);
+		}
+
+		TagScope(const TagScope&) = delete;
+		TagScope& operator=(const TagScope&) = delete;
+
+	private:
+		Tag m_previous;
+	};
+
+	struct MemoryStats {
+		size_t liveBytes;
+		size_t peakBytes;
+		size_t liveAllocations;
+
+		//Over the last completed frame
+		uint64_t frameAllocations;
+		uint64_t frameBytes;
+
+		size_t budget;			//0 for none
+	};
+
+	MemoryStats GetMemoryStats(Tag);
+
+	//Live bytes allowed for a tag, 0 to remove. Checked once per frame.
+	void SetMemoryBudget(Tag, size_t bytes);
+
+	//Called when a tag goes over budget (once per crossing). Default logs an error.
+	using BudgetCallback = std::function<void(Tag, const MemoryStats&)>;
+	void SetBudgetCallback(BudgetCallback);
+
+	//Call once at the top of every frame - rolls the per-frame counters and checks budgets
+	void BeginMemoryFrame();
+
+	//Per-tag table through debugF
+	void ReportMemory();
+
+	//Errors for every tag (other than General) still holding memory.
+	//Call once subsystems are torn down. Returns true if nothing leaked.
+	bool ReportLeaks();
+}
@@ -1,7 +1,21 @@
 #include "BF_Memory.h"
 #include <fstream>
+#include <utility>
+#include <algorithm>
 #include "BF_Error.h"
 
+#ifdef _WIN32
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
 std::vector<char> mem::ReadFile(const std::string & filename)
 {
 	std::ifstream file(filename, std::ios::ate | std::ios::binary);
@@ -19,3 +33,422 @@ std::vector<char> mem::ReadFile(const std::string & filename)
 
 	return buffer;
 }
+
+mem::MappedFile::MappedFile() : m_data(nullptr), m_size(0), m_open(false)
+#ifdef _WIN32
+	, m_file(nullptr), m_mapping(nullptr)
+#endif
+{
+}
+
+mem::MappedFile::MappedFile(const std::string & filename) : MappedFile()
+{
+	open(filename);
+}
+
+mem::MappedFile::~MappedFile()
+{
+	close();
+}
+
+mem::MappedFile::MappedFile(MappedFile&& other) noexcept : MappedFile()
+{
+	*this = std::move(other);
+}
+
+mem::MappedFile& mem::MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		close();
+
+		std::swap(m_data, other.m_data);
+		std::swap(m_size, other.m_size);
+		std::swap(m_open, other.m_open);
+#ifdef _WIN32
+		std::swap(m_file, other.m_file);
+		std::swap(m_mapping, other.m_mapping);
+#endif
+	}
+
+	return *this;
+}
+
+bool mem::MappedFile::open(const std::string & filename)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	m_file = file;
+	m_size = static_cast<size_t>(fileSize.QuadPart);
+
+	//Empty files can't be mapped, but are still a valid (empty) view
+	if (m_size > 0)
+	{
+		m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m_mapping)
+		{
+			close();
+			return false;
+		}
+
+		m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+		if (!m_data)
+		{
+			close();
+			return false;
+		}
+	}
+#else
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	m_size = static_cast<size_t>(st.st_size);
+
+	if (m_size > 0)
+	{
+		void* mapped = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped == MAP_FAILED)
+		{
+			::close(fd);
+			m_size = 0;
+			return false;
+		}
+
+		m_data = static_cast<const char*>(mapped);
+	}
+
+	//The mapping keeps its own reference to the file
+	::close(fd);
+#endif
+
+	m_open = true;
+	return true;
+}
+
+void mem::MappedFile::close()
+{
+#ifdef _WIN32
+	if (m_data)
+	{
+		UnmapViewOfFile(m_data);
+	}
+	if (m_mapping)
+	{
+		CloseHandle(m_mapping);
+	}
+	if (m_file)
+	{
+		CloseHandle(m_file);
+	}
+	m_file = nullptr;
+	m_mapping = nullptr;
+#else
+	if (m_data)
+	{
+		munmap(const_cast<char*>(m_data), m_size);
+	}
+#endif
+
+	m_data = nullptr;
+	m_size = 0;
+	m_open = false;
+}
+
+const bool mem::MappedFile::isOpen() const
+{
+	return m_open;
+}
+
+const char * mem::MappedFile::data() const
+{
+	return m_data;
+}
+
+const size_t mem::MappedFile::size() const
+{
+	return m_size;
+}
+
+mem::MappedFile mem::MapFile(const std::string & filename)
+{
+	MappedFile file;
+
+	if (!file.open(filename)) {
+		panicF("mem::MapFile() - failed to map file %s!", filename.c_str());
+	}
+
+	return file;
+}
+
+//--- Arena ---
+
+static uintptr_t alignUp(uintptr_t value, size_t alignment)
+{
+	return (value + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+}
+
+mem::Arena::Arena(size_t blockSize, Tag tag) : m_current(0), m_offset(0), m_blockSize(blockSize), m_tag(tag)
+{
+}
+
+mem::Arena::~Arena()
+{
+	release();
+}
+
+void * mem::Arena::allocate(size_t size, size_t alignment)
+{
+	if (size == 0) size = 1;
+
+	while (true)
+	{
+		//Bump within the current block, moving on to kept blocks as they fill
+		while (m_current < m_blocks.size())
+		{
+			const Block& block = m_blocks[m_current];
+			const uintptr_t start = reinterpret_cast<uintptr_t>(block.data);
+			const uintptr_t aligned = alignUp(start + m_offset, alignment);
+
+			if (aligned + size <= start + block.size)
+			{
+				m_offset = static_cast<size_t>(aligned + size - start);
+				return reinterpret_cast<void*>(aligned);
+			}
+
+			m_current++;
+			m_offset = 0;
+		}
+
+		//Out of blocks - oversized requests get a block to themselves
+		TagScope scope(m_tag);
+
+		Block block;
+		block.size = std::max(m_blockSize, size + alignment);
+		block.data = static_cast<char*>(::operator new(block.size, std::nothrow));
+
+		if (!block.data)
+		{
+			panicF("mem::Arena::allocate() - out of memory (%llu bytes)", static_cast<unsigned long long>(block.size));
+		}
+
+		m_blocks.push_back(block);
+		m_current = m_blocks.size() - 1;
+		m_offset = 0;
+	}
+}
+
+void mem::Arena::reset()
+{
+	m_current = 0;
+	m_offset = 0;
+}
+
+void mem::Arena::release()
+{
+	for (auto& block : m_blocks)
+	{
+		::operator delete(block.data);
+	}
+
+	m_blocks.clear();
+	reset();
+}
+
+mem::Arena::Marker mem::Arena::mark() const
+{
+	return { m_current, m_offset };
+}
+
+void mem::Arena::rewind(const Marker & marker)
+{
+	m_current = marker.block;
+	m_offset = marker.offset;
+}
+
+const size_t mem::Arena::getUsed() const
+{
+	size_t used = m_offset;
+	for (size_t i = 0; i < m_current && i < m_blocks.size(); i++)
+	{
+		used += m_blocks[i].size;
+	}
+	return used;
+}
+
+const size_t mem::Arena::getCapacity() const
+{
+	size_t capacity = 0;
+	for (const auto& block : m_blocks)
+	{
+		capacity += block.size;
+	}
+	return capacity;
+}
+
+//--- FrameAllocator ---
+
+mem::FrameAllocator::FrameAllocator(size_t blockSize) : m_arenas{ Arena(blockSize, Tag::General), Arena(blockSize, Tag::General) }, m_current(0)
+{
+}
+
+void mem::FrameAllocator::beginFrame()
+{
+	//The other arena held the frame before last - safe to recycle now
+	m_current ^= 1;
+	m_arenas[m_current].reset();
+}
+
+void * mem::FrameAllocator::allocate(size_t size, size_t alignment)
+{
+	return m_arenas[m_current].allocate(size, alignment);
+}
+
+const size_t mem::FrameAllocator::getUsed() const
+{
+	return m_arenas[m_current].getUsed();
+}
+
+//--- Pool ---
+
+mem::Pool::Pool(size_t elementSize, size_t elementsPerChunk, size_t alignment) :
+	m_freeList(nullptr), m_elementsPerChunk(elementsPerChunk > 0 ? elementsPerChunk : 1), m_alignment(alignment), m_live(0)
+{
+	//Every element must be able to hold the free list link and stay aligned
+	m_elementSize = alignUp(std::max(elementSize, sizeof(void*)), alignment);
+}
+
+mem::Pool::~Pool()
+{
+	for (char* chunk : m_chunks)
+	{
+		::operator delete(chunk);
+	}
+}
+
+void mem::Pool::grow()
+{
+	char* chunk = static_cast<char*>(::operator new(m_elementSize * m_elementsPerChunk + m_alignment, std::nothrow));
+	if (!chunk)
+	{
+		panicF("mem::Pool::grow() - out of memory");
+	}
+	m_chunks.push_back(chunk);
+
+	//Thread the new elements onto the free list
+	char* first = reinterpret_cast<char*>(alignUp(reinterpret_cast<uintptr_t>(chunk), m_alignment));
+	for (size_t i = m_elementsPerChunk; i > 0; i--)
+	{
+		void* element = first + (i - 1) * m_elementSize;
+		*static_cast<void**>(element) = m_freeList;
+		m_freeList = element;
+	}
+}
+
+void * mem::Pool::allocate()
+{
+	if (!m_freeList)
+	{
+		grow();
+	}
+
+	void* element = m_freeList;
+	m_freeList = *static_cast<void**>(element);
+	m_live++;
+
+	return element;
+}
+
+void mem::Pool::free(void * element)
+{
+	if (!element) return;
+
+	*static_cast<void**>(element) = m_freeList;
+	m_freeList = element;
+	m_live--;
+}
+
+void * mem::Pool::allocate(size_t size, size_t alignment)
+{
+	if (size <= m_elementSize && alignment <= m_alignment)
+	{
+		return allocate();
+	}
+
+	return ::operator new(size, std::align_val_t(alignment));
+}
+
+void mem::Pool::deallocate(void * p, size_t size, size_t alignment)
+{
+	if (size <= m_elementSize && alignment <= m_alignment)
+	{
+		free(p);
+		return;
+	}
+
+	::operator delete(p, std::align_val_t(alignment));
+}
+
+const size_t mem::Pool::getElementSize() const
+{
+	return m_elementSize;
+}
+
+const size_t mem::Pool::getLiveCount() const
+{
+	return m_live;
+}
+
+const size_t mem::Pool::getReservedBytes() const
+{
+	return m_chunks.size() * m_elementsPerChunk * m_elementSize;
+}
+
+//--- Shared instances ---
+
+mem::FrameAllocator & mem::GetFrameAllocator()
+{
+	static FrameAllocator s_frameAllocator;
+	return s_frameAllocator;
+}
+
+std::pmr::memory_resource * mem::GetFrameResource()
+{
+	static Resource<FrameAllocator> s_frameResource(GetFrameAllocator());
+	return &s_frameResource;
+}
+
+mem::Arena & mem::GetScratchArena()
+{
+	thread_local Arena t_scratch(256 * 1024, Tag::General);
+	return t_scratch;
+}
+
+std::pmr::memory_resource * mem::GetScratchResource()
+{
+	thread_local Resource<Arena> t_scratchResource(GetScratchArena());
+	return &t_scratchResource;
+}
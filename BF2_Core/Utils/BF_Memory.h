@@ -1,7 +1,203 @@
 #pragma once
 #include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <memory_resource>
+#include "BF_MemTrack.h"
 
 namespace mem {
 	//Basic memory reading for now
 	std::vector<char> ReadFile(const std::string & filename);
-}
\ No newline at end of file
+
+	//Read-only view of a memory mapped file - pages load on first touch,
+	//nothing is copied. Unmapped when the view is destroyed.
+	class MappedFile {
+	public:
+		MappedFile();
+		explicit MappedFile(const std::string & filename);
+		~MappedFile();
+
+		MappedFile(MappedFile&&) noexcept;
+		MappedFile& operator=(MappedFile&&) noexcept;
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool open(const std::string & filename);
+		void close();
+
+		const bool isOpen() const;
+
+		//Page aligned, so safe to hand to APIs wanting aligned data (SPIR-V)
+		const char* data() const;
+		const size_t size() const;
+
+	private:
+		const char* m_data;
+		size_t m_size;
+		bool m_open;
+
+#ifdef _WIN32
+		void* m_file;
+		void* m_mapping;
+#endif
+	};
+
+	//Map a whole file - panics on failure like ReadFile
+	MappedFile MapFile(const std::string & filename);
+
+	//--- Allocators ---
+	//None of these are thread safe; each thread gets its own ScratchArena.
+
+	//Bump allocator over a chain of blocks - individual frees are no-ops,
+	//everything goes at once on reset(). Blocks are kept for reuse and are
+	//charged to the tag the arena was created under.
+	class Arena {
+	public:
+		struct Marker {
+			size_t block;
+			size_t offset;
+		};
+
+		explicit Arena(size_t blockSize = 64 * 1024, Tag tag = GetCurrentTag());
+		~Arena();
+
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+
+		void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+		void deallocate(void*, size_t, size_t) {}
+
+		//Placement-construct, destructors are never run
+		template<typename T, typename... Args>
+		T* create(Args&&... args) {
+			return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+		}
+
+		//Rewind to empty, keeping the blocks
+		void reset();
+		//Give the blocks back to the heap
+		void release();
+
+		//Scoped rewinds for scratch use
+		Marker mark() const;
+		void rewind(const Marker&);
+
+		const size_t getUsed() const;
+		const size_t getCapacity() const;
+
+	private:
+		struct Block {
+			char* data;
+			size_t size;
+		};
+
+		std::vector<Block> m_blocks;
+		size_t m_current;
+		size_t m_offset;
+		size_t m_blockSize;
+		Tag m_tag;
+	};
+
+	//Linear allocator for per-frame temporaries. Double buffered: memory from
+	//a frame stays valid through the following frame, then is recycled.
+	//Blocks are shared by every subsystem, so they are charged to General.
+	class FrameAllocator {
+	public:
+		explicit FrameAllocator(size_t blockSize = 1024 * 1024);
+
+		FrameAllocator(const FrameAllocator&) = delete;
+		FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+		//Call once at the top of every frame
+		void beginFrame();
+
+		void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+		void deallocate(void*, size_t, size_t) {}
+
+		const size_t getUsed() const;
+
+	private:
+		Arena m_arenas[2];
+		uint32_t m_current;
+	};
+
+	//Fixed-size blocks from a free list - O(1) alloc/free, no fragmentation
+	class Pool {
+	public:
+		Pool(size_t elementSize, size_t elementsPerChunk = 256, size_t alignment = alignof(std::max_align_t));
+		~Pool();
+
+		Pool(const Pool&) = delete;
+		Pool& operator=(const Pool&) = delete;
+
+		void* allocate();
+		void free(void*);
+
+		//Larger or more aligned requests than the pool serves go to the heap
+		void* allocate(size_t size, size_t alignment);
+		void deallocate(void*, size_t size, size_t alignment);
+
+		const size_t getElementSize() const;
+		const size_t getLiveCount() const;
+		const size_t getReservedBytes() const;
+
+	private:
+		void grow();
+
+		std::vector<char*> m_chunks;
+		void* m_freeList;
+		size_t m_elementSize;
+		size_t m_elementsPerChunk;
+		size_t m_alignment;
+		size_t m_live;
+	};
+
+	//std::pmr adaptor over any of the above, so std::pmr containers can use them:
+	//  mem::Resource<mem::FrameAllocator> res(mem::GetFrameAllocator());
+	//  std::pmr::vector<int> temp(&res);
+	template<typename Allocator>
+	class Resource : public std::pmr::memory_resource {
+	public:
+		explicit Resource(Allocator& allocator) : m_allocator(allocator) {}
+
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override {
+			return m_allocator.allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+			m_allocator.deallocate(p, bytes, alignment);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+			return this == &other;
+		}
+
+		Allocator& m_allocator;
+	};
+
+	//Engine-wide per-frame allocator (main thread) and its pmr resource
+	FrameAllocator& GetFrameAllocator();
+	std::pmr::memory_resource* GetFrameResource();
+
+	//Per-thread scratch space - pair with ScratchScope so it unwinds
+	Arena& GetScratchArena();
+	std::pmr::memory_resource* GetScratchResource();
+
+	class ScratchScope {
+	public:
+		ScratchScope() : m_arena(GetScratchArena()), m_marker(m_arena.mark()) {}
+		~ScratchScope() { m_arena.rewind(m_marker); }
+
+		ScratchScope(const ScratchScope&) = delete;
+		ScratchScope& operator=(const ScratchScope&) = delete;
+
+	private:
+		Arena& m_arena;
+		Arena::Marker m_marker;
+	};
+}
@@ -0,0 +1,419 @@
+#include "BF_MeshOptimizer.h"
+#include "BF_Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+//Vertex cache scoring, after Forsyth's "Linear-Speed Vertex Cache Optimisation".
+//The modelled cache is larger than kVertexCacheSize - the scoring only needs a
+//window for recency, and a wider one keeps the order good on bigger caches too.
+static constexpr uint32_t kForsythCacheSize = 32;
+static constexpr float kCacheDecayPower = 1.5f;
+static constexpr float kLastTriScore = 0.75f;
+static constexpr float kValenceBoostScale = 2.0f;
+static constexpr float kValenceBoostPower = 0.5f;
+
+namespace {
+	struct VertexHash {
+		size_t operator()(const Vertex_Pos3Col3Uv2& v) const
+		{
+			//FNV-1a over the raw floats - identical bits are identical vertices
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&v);
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < sizeof(v); i++) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+			return static_cast<size_t>(hash);
+		}
+	};
+
+	struct VertexEqual {
+		bool operator()(const Vertex_Pos3Col3Uv2& a, const Vertex_Pos3Col3Uv2& b) const
+		{
+			return std::memcmp(&a, &b, sizeof(a)) == 0;
+		}
+	};
+
+	float vertexScore(int cachePosition, uint32_t liveTriangles)
+	{
+		//Nothing left to draw with it
+		if (liveTriangles == 0) return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0) {
+			//Vertices of the last triangle get a fixed score, so the next one
+			//doesn't just reuse the same edge over and over
+			if (cachePosition < 3) {
+				score = kLastTriScore;
+			}
+			else {
+				const float scale = 1.0f / (kForsythCacheSize - 3);
+				score = std::pow(1.0f - (cachePosition - 3) * scale, kCacheDecayPower);
+			}
+		}
+
+		//Favour finishing off vertices with few triangles left
+		score += kValenceBoostScale * std::pow(static_cast<float>(liveTriangles), -kValenceBoostPower);
+
+		return score;
+	}
+
+	//FIFO cache simulation - true for a miss
+	struct CacheSim {
+		std::vector<uint32_t> timestamps;
+		uint32_t time;
+		uint32_t size;
+
+		CacheSim(size_t vertexCount, uint32_t cacheSize) : timestamps(vertexCount, 0), time(cacheSize + 1), size(cacheSize) {}
+
+		bool access(uint32_t v)
+		{
+			if (time - timestamps[v] > size) {
+				timestamps[v] = time++;
+				return true;
+			}
+			return false;
+		}
+
+		void flush()
+		{
+			time += size + 1;
+		}
+	};
+}
+
+MeshData mesh::Deduplicate(const Vertex_Pos3Col3Uv2* vertices, size_t vertexCount, const uint32_t* indices, size_t indexCount)
+{
+	BF_PROFILE_ZONE("mesh::Deduplicate");
+
+	const size_t count = indices ? indexCount : vertexCount;
+
+	MeshData result;
+	result.indices.reserve(count);
+
+	std::unordered_map<Vertex_Pos3Col3Uv2, uint32_t, VertexHash, VertexEqual> unique;
+	unique.reserve(vertexCount);
+
+	for (size_t i = 0; i < count; i++) {
+		const Vertex_Pos3Col3Uv2& v = vertices[indices ? indices[i] : i];
+
+		auto inserted = unique.emplace(v, static_cast<uint32_t>(result.vertices.size()));
+		if (inserted.second) {
+			result.vertices.push_back(v);
+		}
+
+		result.indices.push_back(inserted.first->second);
+	}
+
+	return result;
+}
+
+void mesh::OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+	BF_PROFILE_ZONE("mesh::OptimizeVertexCache");
+
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) return;
+
+	//Triangles using each vertex, packed per vertex
+	std::vector<uint32_t> liveTriangles(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++) {
+		liveTriangles[indices[i]]++;
+	}
+
+	std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++) {
+		adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+	}
+
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++) {
+			for (size_t k = 0; k < 3; k++) {
+				const uint32_t v = indices[t * 3 + k];
+				adjacency[fill[v]++] = static_cast<uint32_t>(t);
+			}
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> score(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++) {
+		score[v] = vertexScore(-1, liveTriangles[v]);
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+
+	//Cache plus room for the three vertices pushed in each step
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> nextCache;
+	cache.reserve(kForsythCacheSize + 3);
+	nextCache.reserve(kForsythCacheSize + 3);
+
+	size_t cursor = 0;
+	int64_t best = -1;
+
+	while (output.size() < triangleCount * 3) {
+		//Cache ran dry - carry on from the next triangle not yet drawn
+		if (best < 0) {
+			while (emitted[cursor]) cursor++;
+			best = static_cast<int64_t>(cursor);
+		}
+
+		const size_t t = static_cast<size_t>(best);
+		const uint32_t tri[3] = { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] };
+
+		output.insert(output.end(), tri, tri + 3);
+		emitted[t] = true;
+
+		//Drop the triangle from its vertices' lists
+		for (uint32_t v : tri) {
+			uint32_t* begin = adjacency.data() + adjacencyOffset[v];
+			uint32_t* end = begin + liveTriangles[v];
+			uint32_t* it = std::find(begin, end, static_cast<uint32_t>(t));
+			*it = *(end - 1);
+			liveTriangles[v]--;
+		}
+
+		//Triangle's vertices to the front, the rest shuffle back
+		nextCache.assign(tri, tri + 3);
+		for (uint32_t v : cache) {
+			if (v != tri[0] && v != tri[1] && v != tri[2]) {
+				nextCache.push_back(v);
+			}
+		}
+
+		for (size_t i = kForsythCacheSize; i < nextCache.size(); i++) {
+			cachePosition[nextCache[i]] = -1;
+			score[nextCache[i]] = vertexScore(-1, liveTriangles[nextCache[i]]);
+		}
+		if (nextCache.size() > kForsythCacheSize) {
+			nextCache.resize(kForsythCacheSize);
+		}
+		cache.swap(nextCache);
+
+		for (size_t i = 0; i < cache.size(); i++) {
+			cachePosition[cache[i]] = static_cast<int>(i);
+			score[cache[i]] = vertexScore(static_cast<int>(i), liveTriangles[cache[i]]);
+		}
+
+		//Only triangles touching the cache changed score - best of them goes next
+		best = -1;
+		float bestScore = -1.0f;
+		for (uint32_t v : cache) {
+			const uint32_t* begin = adjacency.data() + adjacencyOffset[v];
+			for (uint32_t i = 0; i < liveTriangles[v]; i++) {
+				const uint32_t other = begin[i];
+				const float s = score[indices[other * 3]] + score[indices[other * 3 + 1]] + score[indices[other * 3 + 2]];
+				if (s > bestScore) {
+					bestScore = s;
+					best = other;
+				}
+			}
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void mesh::OptimizeOverdraw(uint32_t* indices, size_t indexCount, const Vertex_Pos3Col3Uv2* vertices, size_t vertexCount, float threshold)
+{
+	BF_PROFILE_ZONE("mesh::OptimizeOverdraw");
+
+	const size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) return;
+
+	//Hard boundaries - triangles where the cache starts from scratch anyway
+	std::vector<size_t> hard;
+	{
+		CacheSim cache(vertexCount, kVertexCacheSize);
+		for (size_t t = 0; t < triangleCount; t++) {
+			const bool a = cache.access(indices[t * 3]);
+			const bool b = cache.access(indices[t * 3 + 1]);
+			const bool c = cache.access(indices[t * 3 + 2]);
+
+			if (t == 0 || (a && b && c)) {
+				hard.push_back(t);
+			}
+		}
+		hard.push_back(triangleCount);
+	}
+
+	//Soft boundaries - split a run once its cache ratio so far is within
+	//threshold of the whole run's, so sorting costs little cache efficiency
+	std::vector<size_t> clusters;
+	{
+		CacheSim cache(vertexCount, kVertexCacheSize);
+		for (size_t h = 0; h + 1 < hard.size(); h++) {
+			const size_t start = hard[h];
+			const size_t end = hard[h + 1];
+
+			cache.flush();
+			uint32_t misses = 0;
+			for (size_t i = start * 3; i < end * 3; i++) {
+				misses += cache.access(indices[i]) ? 1 : 0;
+			}
+			const float runAcmr = static_cast<float>(misses) / (end - start);
+
+			cache.flush();
+			clusters.push_back(start);
+			size_t clusterStart = start;
+			misses = 0;
+
+			for (size_t t = start; t < end; t++) {
+				misses += cache.access(indices[t * 3]) ? 1 : 0;
+				misses += cache.access(indices[t * 3 + 1]) ? 1 : 0;
+				misses += cache.access(indices[t * 3 + 2]) ? 1 : 0;
+
+				const float acmr = static_cast<float>(misses) / (t + 1 - clusterStart);
+				if (t + 1 < end && acmr <= runAcmr * threshold) {
+					clusters.push_back(t + 1);
+					clusterStart = t + 1;
+					misses = 0;
+					cache.flush();
+				}
+			}
+		}
+		clusters.push_back(triangleCount);
+	}
+
+	//Mesh centre from the vertices actually drawn
+	glm::vec3 centre(0.0f);
+	for (size_t i = 0; i < triangleCount * 3; i++) {
+		centre += vertices[indices[i]].pos;
+	}
+	centre /= static_cast<float>(triangleCount * 3);
+
+	//Clusters far out along their own facing direction are likely occluders - draw those first
+	const size_t clusterCount = clusters.size() - 1;
+	std::vector<float> sortKey(clusterCount);
+	for (size_t c = 0; c < clusterCount; c++) {
+		glm::vec3 clusterCentre(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+
+		for (size_t t = clusters[c]; t < clusters[c + 1]; t++) {
+			const glm::vec3& p0 = vertices[indices[t * 3]].pos;
+			const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+			const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+
+			//Length is twice the area, so normals and centroids are area weighted
+			const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+			const float a = glm::length(n);
+
+			clusterCentre += (p0 + p1 + p2) * (a / 3.0f);
+			normal += n;
+			area += a;
+		}
+
+		const float normalLength = glm::length(normal);
+		if (area <= 0.0f || normalLength <= 0.0f) {
+			sortKey[c] = 0.0f;
+			continue;
+		}
+
+		clusterCentre /= area;
+		normal /= normalLength;
+		sortKey[c] = glm::dot(clusterCentre - centre, normal);
+	}
+
+	std::vector<size_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&sortKey](size_t a, size_t b) { return sortKey[a] > sortKey[b]; });
+
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+	for (size_t c : order) {
+		output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+size_t mesh::OptimizeVertexFetch(Vertex_Pos3Col3Uv2* vertices, size_t vertexCount, uint32_t* indices, size_t indexCount)
+{
+	BF_PROFILE_ZONE("mesh::OptimizeVertexFetch");
+
+	constexpr uint32_t kUnused = ~0u;
+	std::vector<uint32_t> remap(vertexCount, kUnused);
+	std::vector<Vertex_Pos3Col3Uv2> ordered;
+	ordered.reserve(vertexCount);
+
+	for (size_t i = 0; i < indexCount; i++) {
+		uint32_t& slot = remap[indices[i]];
+		if (slot == kUnused) {
+			slot = static_cast<uint32_t>(ordered.size());
+			ordered.push_back(vertices[indices[i]]);
+		}
+		indices[i] = slot;
+	}
+
+	std::copy(ordered.begin(), ordered.end(), vertices);
+	return ordered.size();
+}
+
+VertexCacheStats mesh::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStats stats = { 0.0f, 0.0f };
+	if (indexCount < 3 || vertexCount == 0) return stats;
+
+	CacheSim cache(vertexCount, cacheSize);
+	uint32_t misses = 0;
+	for (size_t i = 0; i < indexCount; i++) {
+		misses += cache.access(indices[i]) ? 1 : 0;
+	}
+
+	stats.acmr = static_cast<float>(misses) / (indexCount / 3);
+	stats.atvr = static_cast<float>(misses) / vertexCount;
+
+	return stats;
+}
+
+IndexData mesh::PackIndices(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+{
+	IndexData data;
+	data.count = indexCount;
+
+	//0xFFFF is kept clear for primitive restart
+	if (vertexCount < 0xFFFF) {
+		data.indexSize = sizeof(uint16_t);
+		data.bytes.resize(indexCount * sizeof(uint16_t));
+
+		uint16_t* out = reinterpret_cast<uint16_t*>(data.bytes.data());
+		for (size_t i = 0; i < indexCount; i++) {
+			out[i] = static_cast<uint16_t>(indices[i]);
+		}
+	}
+	else {
+		data.indexSize = sizeof(uint32_t);
+		data.bytes.resize(indexCount * sizeof(uint32_t));
+		std::memcpy(data.bytes.data(), indices, data.bytes.size());
+	}
+
+	return data;
+}
+
+void mesh::Optimize(MeshData& mesh)
+{
+	BF_PROFILE_ZONE("mesh::Optimize");
+
+	//Unindexed input gets its index buffer here
+	MeshData unique = Deduplicate(mesh.vertices.data(), mesh.vertices.size(),
+		mesh.indices.empty() ? nullptr : mesh.indices.data(), mesh.indices.size());
+
+	OptimizeVertexCache(unique.indices.data(), unique.indices.size(), unique.vertices.size());
+	OptimizeOverdraw(unique.indices.data(), unique.indices.size(), unique.vertices.data(), unique.vertices.size());
+
+	const size_t used = OptimizeVertexFetch(unique.vertices.data(), unique.vertices.size(), unique.indices.data(), unique.indices.size());
+	unique.vertices.resize(used);
+
+	mesh = std::move(unique);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "BF_Vertex_Pos3Col3Uv2.h"
+
+//FIFO size the cache statistics assume - the lower end of current hardware
+constexpr uint32_t kVertexCacheSize = 16;
+
+//Indexed triangle list
+struct MeshData {
+	std::vector<Vertex_Pos3Col3Uv2> vertices;
+	std::vector<uint32_t> indices;
+};
+
+//Index buffer ready for upload - 16 bit whenever the vertex count allows
+struct IndexData {
+	std::vector<uint8_t> bytes;
+	uint32_t indexSize;		//2 or 4
+	size_t count;
+};
+
+//Average cache miss ratio (transformed vertices per triangle, 0.5 - 3) and
+//average transform ratio (transformed vertices per vertex, 1 is ideal)
+struct VertexCacheStats {
+	float acmr;
+	float atvr;
+};
+
+//Post-transform cache, overdraw and fetch ordering for triangle lists. Run in
+//the order Optimize() does - each later pass keeps most of the earlier ones' gains.
+namespace mesh {
+	//Merges identical vertices. indices may be null for an unindexed list.
+	MeshData Deduplicate(const Vertex_Pos3Col3Uv2* vertices, size_t vertexCount, const uint32_t* indices = nullptr, size_t indexCount = 0);
+
+	//Reorders triangles so vertices are reused while still in the post-transform cache
+	void OptimizeVertexCache(uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+	//Reorders runs of triangles so outward facing ones draw first. threshold caps
+	//how much worse a run's cache ratio may get to allow finer sorting.
+	void OptimizeOverdraw(uint32_t* indices, size_t indexCount, const Vertex_Pos3Col3Uv2* vertices, size_t vertexCount, float threshold = 1.05f);
+
+	//Renumbers vertices in first use order and packs them to match, dropping
+	//any unreferenced. Returns the vertex count kept.
+	size_t OptimizeVertexFetch(Vertex_Pos3Col3Uv2* vertices, size_t vertexCount, uint32_t* indices, size_t indexCount);
+
+	VertexCacheStats AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = kVertexCacheSize);
+
+	IndexData PackIndices(const uint32_t* indices, size_t indexCount, size_t vertexCount);
+
+	//Every pass above, in order
+	void Optimize(MeshData&);
+}
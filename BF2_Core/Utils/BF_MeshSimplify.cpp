@@ -0,0 +1,367 @@
+#include "BF_MeshSimplify.h"
+#include "BF_Profiler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+//Border planes count this many times a triangle of the edge's length squared -
+//enough that pulling a border inwards always costs more than sliding along it
+static constexpr double kBorderWeight = 10.0;
+
+//Cosine of the furthest a surviving triangle's normal may turn in one collapse -
+//also rejects collapses that leave slivers with no real facing
+static constexpr float kMinNormalDot = 0.25f;
+
+//A level removing less than this fraction of the one before is not worth keeping
+static constexpr float kMinLodProgress = 0.1f;
+
+namespace {
+	//Sum of squared distances to a set of planes, area weighted. Only the upper
+	//triangle of the symmetric 4x4 is kept.
+	struct Quadric {
+		double a00, a11, a22, a01, a02, a12;
+		double b0, b1, b2;
+		double c;
+		double w;
+	};
+
+	void addPlane(Quadric& q, const glm::vec3& n, float d, double weight)
+	{
+		const double x = n.x, y = n.y, z = n.z, dd = d;
+
+		q.a00 += weight * x * x;
+		q.a11 += weight * y * y;
+		q.a22 += weight * z * z;
+		q.a01 += weight * x * y;
+		q.a02 += weight * x * z;
+		q.a12 += weight * y * z;
+		q.b0 += weight * x * dd;
+		q.b1 += weight * y * dd;
+		q.b2 += weight * z * dd;
+		q.c += weight * dd * dd;
+		q.w += weight;
+	}
+
+	void addQuadric(Quadric& q, const Quadric& o)
+	{
+		q.a00 += o.a00; q.a11 += o.a11; q.a22 += o.a22;
+		q.a01 += o.a01; q.a02 += o.a02; q.a12 += o.a12;
+		q.b0 += o.b0; q.b1 += o.b1; q.b2 += o.b2;
+		q.c += o.c;
+		q.w += o.w;
+	}
+
+	//Mean squared distance from p to the planes
+	double evaluate(const Quadric& q, const glm::vec3& p)
+	{
+		const double x = p.x, y = p.y, z = p.z;
+
+		const double rx = q.a00 * x + q.a01 * y + q.a02 * z;
+		const double ry = q.a01 * x + q.a11 * y + q.a12 * z;
+		const double rz = q.a02 * x + q.a12 * y + q.a22 * z;
+
+		const double error = rx * x + ry * y + rz * z + 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+
+		return q.w > 0.0 ? std::fabs(error) / q.w : 0.0;
+	}
+
+	struct Collapse {
+		uint32_t from;
+		uint32_t to;
+		double cost;
+	};
+
+	struct PositionHash {
+		size_t operator()(const glm::vec3& p) const
+		{
+			uint32_t bits[3];
+			std::memcpy(bits, &p, sizeof(bits));
+			return static_cast<size_t>((bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u));
+		}
+	};
+
+	struct PositionEqual {
+		bool operator()(const glm::vec3& a, const glm::vec3& b) const
+		{
+			return std::memcmp(&a, &b, sizeof(a)) == 0;
+		}
+	};
+
+	uint64_t edgeKey(uint32_t a, uint32_t b)
+	{
+		return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+	}
+}
+
+size_t mesh::Simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount, const Vertex_Pos3Col3Uv2* vertices, size_t vertexCount,
+	size_t targetIndexCount, float targetError, float* resultError)
+{
+	BF_PROFILE_ZONE("mesh::Simplify");
+
+	std::vector<uint32_t> result(indices, indices + indexCount);
+
+	//Vertices split only by colour or UV share a position - one position id each
+	std::vector<uint32_t> positionId(vertexCount);
+	std::vector<uint32_t> positionUses(vertexCount, 0);
+	{
+		std::unordered_map<glm::vec3, uint32_t, PositionHash, PositionEqual> firstAt;
+		firstAt.reserve(vertexCount);
+
+		for (size_t i = 0; i < vertexCount; i++) {
+			const auto it = firstAt.emplace(vertices[i].pos, static_cast<uint32_t>(i)).first;
+			positionId[i] = it->second;
+			positionUses[it->second]++;
+		}
+	}
+
+	//Moving one side of a seam would tear it open
+	std::vector<uint8_t> locked(vertexCount, 0);
+	for (size_t i = 0; i < vertexCount; i++) {
+		locked[i] = positionUses[positionId[i]] > 1 ? 1 : 0;
+	}
+
+	//Edges used by one triangle only are open borders
+	std::unordered_map<uint64_t, uint32_t> edgeUses;
+	edgeUses.reserve(indexCount);
+	for (size_t i = 0; i + 2 < indexCount; i += 3) {
+		for (size_t k = 0; k < 3; k++) {
+			edgeUses[edgeKey(positionId[result[i + k]], positionId[result[i + (k + 1) % 3]])]++;
+		}
+	}
+
+	auto isBorderEdge = [&](uint32_t a, uint32_t b) {
+		const auto it = edgeUses.find(edgeKey(positionId[a], positionId[b]));
+		return it != edgeUses.end() && it->second == 1;
+	};
+
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	std::vector<uint8_t> border(vertexCount, 0);
+
+	for (size_t i = 0; i + 2 < indexCount; i += 3) {
+		const uint32_t tri[3] = { result[i], result[i + 1], result[i + 2] };
+		const glm::vec3& p0 = vertices[tri[0]].pos;
+
+		glm::vec3 normal = glm::cross(vertices[tri[1]].pos - p0, vertices[tri[2]].pos - p0);
+		const float length = glm::length(normal);
+		if (length <= 0.0f) continue;
+		normal /= length;
+
+		const float d = -glm::dot(normal, p0);
+		const double area = length * 0.5;
+		for (size_t k = 0; k < 3; k++) {
+			addPlane(quadrics[tri[k]], normal, d, area);
+		}
+
+		//A plane through each border edge, upright to the triangle, holds the border in place
+		for (size_t k = 0; k < 3; k++) {
+			const uint32_t a = tri[k], b = tri[(k + 1) % 3];
+			if (!isBorderEdge(a, b)) continue;
+
+			const glm::vec3 edge = vertices[b].pos - vertices[a].pos;
+			const float edgeLength = glm::length(edge);
+			if (edgeLength <= 0.0f) continue;
+
+			const glm::vec3 planeNormal = glm::normalize(glm::cross(edge / edgeLength, normal));
+			const float planeD = -glm::dot(planeNormal, vertices[a].pos);
+			const double weight = kBorderWeight * edgeLength * edgeLength;
+
+			addPlane(quadrics[a], planeNormal, planeD, weight);
+			addPlane(quadrics[b], planeNormal, planeD, weight);
+			border[a] = 1;
+			border[b] = 1;
+		}
+	}
+
+	const double maxCost = static_cast<double>(targetError) * targetError;
+	double error = 0.0;
+
+	std::vector<uint32_t> triangleStart(vertexCount + 1);
+	std::vector<uint32_t> vertexTriangles;
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> collapseTo(vertexCount);
+	std::vector<uint8_t> touched(vertexCount);
+
+	//Each pass collapses the cheapest edges that don't share triangles, then rebuilds
+	while (result.size() > targetIndexCount) {
+		const size_t triangleCount = result.size() / 3;
+
+		//Triangles around each vertex
+		std::fill(triangleStart.begin(), triangleStart.end(), 0);
+		for (uint32_t index : result) {
+			triangleStart[index + 1]++;
+		}
+		for (size_t i = 0; i < vertexCount; i++) {
+			triangleStart[i + 1] += triangleStart[i];
+		}
+
+		vertexTriangles.resize(result.size());
+		std::vector<uint32_t> fill(triangleStart.begin(), triangleStart.end() - 1);
+		for (size_t t = 0; t < triangleCount; t++) {
+			for (size_t k = 0; k < 3; k++) {
+				vertexTriangles[fill[result[t * 3 + k]]++] = static_cast<uint32_t>(t);
+			}
+		}
+
+		//Cheaper direction of every edge that may collapse at all
+		collapses.clear();
+		for (size_t t = 0; t < triangleCount; t++) {
+			for (size_t k = 0; k < 3; k++) {
+				const uint32_t a = result[t * 3 + k], b = result[t * 3 + (k + 1) % 3];
+
+				Quadric q = quadrics[a];
+				addQuadric(q, quadrics[b]);
+
+				const bool borderEdge = isBorderEdge(a, b);
+				const bool canA = !locked[a] && (!border[a] || borderEdge);
+				const bool canB = !locked[b] && (!border[b] || borderEdge);
+
+				const double costA = canA ? evaluate(q, vertices[b].pos) : DBL_MAX;
+				const double costB = canB ? evaluate(q, vertices[a].pos) : DBL_MAX;
+
+				if (costA == DBL_MAX && costB == DBL_MAX) continue;
+				collapses.push_back(costA <= costB ? Collapse{ a, b, costA } : Collapse{ b, a, costB });
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+		//Each collapse takes out about two triangles - don't overshoot the target by much
+		const size_t collapseLimit = (result.size() - targetIndexCount) / 6 + 1;
+
+		for (size_t i = 0; i < vertexCount; i++) {
+			collapseTo[i] = static_cast<uint32_t>(i);
+		}
+		std::fill(touched.begin(), touched.end(), 0);
+
+		size_t applied = 0;
+		for (const auto& c : collapses) {
+			if (applied >= collapseLimit || c.cost > maxCost) break;
+			if (touched[c.from] || touched[c.to]) continue;
+
+			//Reject collapses that would turn a surviving triangle over, or nearly
+			bool flips = false;
+			for (uint32_t j = triangleStart[c.from]; j < triangleStart[c.from + 1] && !flips; j++) {
+				const uint32_t* tri = &result[vertexTriangles[j] * 3];
+				if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) continue;
+
+				glm::vec3 p[3];
+				for (size_t k = 0; k < 3; k++) {
+					p[k] = vertices[tri[k]].pos;
+				}
+				const glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+				for (size_t k = 0; k < 3; k++) {
+					if (tri[k] == c.from) p[k] = vertices[c.to].pos;
+				}
+				const glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+
+				flips = glm::dot(before, after) <= kMinNormalDot * glm::length(before) * glm::length(after);
+			}
+			if (flips) continue;
+
+			//Everything sharing a triangle with from changes - leave it for the next pass
+			for (uint32_t j = triangleStart[c.from]; j < triangleStart[c.from + 1]; j++) {
+				const uint32_t* tri = &result[vertexTriangles[j] * 3];
+				touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = 1;
+			}
+			touched[c.to] = 1;
+
+			collapseTo[c.from] = c.to;
+			addQuadric(quadrics[c.to], quadrics[c.from]);
+			error = std::max(error, c.cost);
+			applied++;
+		}
+
+		if (applied == 0) break;
+
+		//Remap and drop the triangles that collapsed to lines
+		size_t write = 0;
+		for (size_t t = 0; t < triangleCount; t++) {
+			const uint32_t a = collapseTo[result[t * 3]];
+			const uint32_t b = collapseTo[result[t * 3 + 1]];
+			const uint32_t c = collapseTo[result[t * 3 + 2]];
+			if (a == b || b == c || a == c) continue;
+
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+
+	std::copy(result.begin(), result.end(), destination);
+
+	if (resultError != nullptr) {
+		*resultError = static_cast<float>(std::sqrt(error));
+	}
+
+	return result.size();
+}
+
+LodChain mesh::BuildLodChain(const MeshData& source, float reduction)
+{
+	BF_PROFILE_ZONE("mesh::BuildLodChain");
+
+	LodChain chain = {};
+	chain.mesh.vertices = source.vertices;
+
+	std::vector<std::vector<uint32_t>> levels;
+	std::vector<float> errors;
+	levels.push_back(source.indices);
+	errors.push_back(0.0f);
+
+	//Each level simplified from LOD 0, so its error is measured against the original
+	std::vector<uint32_t> lod(source.indices.size());
+	while (levels.size() < kMaxLodLevels) {
+		const size_t previous = levels.back().size();
+		const size_t target = static_cast<size_t>(previous / 3 * reduction) * 3;
+		if (target < 3) break;
+
+		float error = 0.0f;
+		const size_t count = Simplify(lod.data(), source.indices.data(), source.indices.size(),
+			source.vertices.data(), source.vertices.size(), target, FLT_MAX, &error);
+
+		//Stalled on locked seams and borders
+		if (count == 0 || count > previous * (1.0f - kMinLodProgress)) break;
+
+		levels.emplace_back(lod.begin(), lod.begin() + count);
+		errors.push_back(std::max(error, errors.back()));
+	}
+
+	for (size_t i = 0; i < levels.size(); i++) {
+		auto& level = levels[i];
+		OptimizeVertexCache(level.data(), level.size(), chain.mesh.vertices.size());
+
+		MeshLod meshLod = {};
+		meshLod.firstIndex = static_cast<uint32_t>(chain.mesh.indices.size());
+		meshLod.indexCount = static_cast<uint32_t>(level.size());
+		meshLod.error = errors[i];
+		chain.lods.push_back(meshLod);
+
+		chain.mesh.indices.insert(chain.mesh.indices.end(), level.begin(), level.end());
+	}
+
+	//LOD 0 comes first, so fetch order follows the level drawn most up close
+	const size_t kept = OptimizeVertexFetch(chain.mesh.vertices.data(), chain.mesh.vertices.size(),
+		chain.mesh.indices.data(), chain.mesh.indices.size());
+	chain.mesh.vertices.resize(kept);
+
+	//Bounding sphere about the box centre, for distance to the camera
+	if (!chain.mesh.vertices.empty()) {
+		glm::vec3 lo = chain.mesh.vertices[0].pos, hi = lo;
+		for (const auto& v : chain.mesh.vertices) {
+			lo = glm::min(lo, v.pos);
+			hi = glm::max(hi, v.pos);
+		}
+
+		chain.centre = (lo + hi) * 0.5f;
+		for (const auto& v : chain.mesh.vertices) {
+			chain.radius = std::max(chain.radius, glm::length(v.pos - chain.centre));
+		}
+	}
+
+	return chain;
+}
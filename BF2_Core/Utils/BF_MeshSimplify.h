@@ -0,0 +1,42 @@
+#pragma once
+
+#define GLM_FORCE_CTOR_INIT
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "BF_MeshOptimizer.h"
+
+//Most levels a chain holds (LOD 0 included) and the triangle ratio between levels
+constexpr uint32_t kMaxLodLevels = 6;
+constexpr float kLodReduction = 0.5f;
+
+//One level of detail - a range of LodChain::mesh.indices
+struct MeshLod {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float error;		//how far the surface strays from LOD 0, in mesh units
+};
+
+//Every level indexes the one vertex buffer, finest first
+struct LodChain {
+	MeshData mesh;
+	std::vector<MeshLod> lods;
+	glm::vec3 centre;
+	float radius;
+};
+
+namespace mesh {
+	//Quadric error edge collapse onto existing vertices, so the result indexes the
+	//same vertex buffer. Stops at targetIndexCount, or once the cheapest collapse left
+	//would move the surface further than targetError. Vertices on colour or UV seams
+	//stay put and open borders only shorten along themselves.
+	//destination may alias indices. Returns the index count written, resultError
+	//receives the error reached in mesh units.
+	size_t Simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount, const Vertex_Pos3Col3Uv2* vertices, size_t vertexCount,
+		size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+	//Import time - simplifies source by kLodReduction per level until kMaxLodLevels
+	//or the simplifier stalls. Levels are cache optimized, the vertices fetch optimized.
+	LodChain BuildLodChain(const MeshData& source, float reduction = kLodReduction);
+}
@@ -0,0 +1,177 @@
+#include "BF_Meshlet.h"
+#include "BF_Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+//Normal cones wider than this (dot with the axis) are never culled - too few
+//viewpoints would see every triangle's back to be worth testing
+static constexpr float kMinConeSpread = 0.1f;
+
+std::vector<Meshlet> mesh::BuildMeshlets(const uint32_t* indices, size_t indexCount, const Vertex_Pos3Col3Uv2* vertices, size_t vertexCount,
+	uint32_t maxVertices, uint32_t maxTriangles)
+{
+	BF_PROFILE_ZONE("mesh::BuildMeshlets");
+
+	std::vector<Meshlet> meshlets;
+
+	//Last meshlet each vertex was counted in
+	constexpr uint32_t kNone = ~0u;
+	std::vector<uint32_t> owner(vertexCount, kNone);
+
+	Meshlet current = {};
+	uint32_t meshletId = 0;
+
+	auto finish = [&]() {
+		if (current.indexCount == 0) return;
+		current.bounds = ComputeMeshletBounds(indices + current.firstIndex, current.indexCount, vertices);
+		meshlets.push_back(current);
+
+		current = {};
+		meshletId++;
+	};
+
+	//Vertices of triangle t not yet in the current meshlet
+	auto countNew = [&](size_t t) {
+		const uint32_t a = indices[t], b = indices[t + 1], c = indices[t + 2];
+		uint32_t count = owner[a] != meshletId ? 1 : 0;
+		count += (owner[b] != meshletId && b != a) ? 1 : 0;
+		count += (owner[c] != meshletId && c != a && c != b) ? 1 : 0;
+		return count;
+	};
+
+	for (size_t t = 0; t + 2 < indexCount; t += 3) {
+		uint32_t added = countNew(t);
+
+		//Full - start the next one at this triangle
+		if (current.vertexCount + added > maxVertices || current.indexCount / 3 + 1 > maxTriangles) {
+			finish();
+			added = countNew(t);
+		}
+
+		if (current.indexCount == 0) {
+			current.firstIndex = static_cast<uint32_t>(t);
+		}
+
+		for (size_t k = 0; k < 3; k++) {
+			owner[indices[t + k]] = meshletId;
+		}
+		current.vertexCount += added;
+		current.indexCount += 3;
+	}
+
+	finish();
+
+	return meshlets;
+}
+
+MeshletBounds mesh::ComputeMeshletBounds(const uint32_t* indices, size_t indexCount, const Vertex_Pos3Col3Uv2* vertices)
+{
+	MeshletBounds bounds = {};
+	bounds.coneCutoff = 1.0f;
+	if (indexCount < 3) return bounds;
+
+	//Ritter's sphere - start from the points furthest apart along one sweep, then grow
+	const glm::vec3& first = vertices[indices[0]].pos;
+	glm::vec3 a = first;
+	float best = -1.0f;
+	for (size_t i = 0; i < indexCount; i++) {
+		const glm::vec3& p = vertices[indices[i]].pos;
+		const glm::vec3 d = p - first;
+		if (glm::dot(d, d) > best) { best = glm::dot(d, d); a = p; }
+	}
+
+	glm::vec3 b = a;
+	best = -1.0f;
+	for (size_t i = 0; i < indexCount; i++) {
+		const glm::vec3& p = vertices[indices[i]].pos;
+		const glm::vec3 d = p - a;
+		if (glm::dot(d, d) > best) { best = glm::dot(d, d); b = p; }
+	}
+
+	glm::vec3 centre = (a + b) * 0.5f;
+	float radius = glm::length(b - a) * 0.5f;
+
+	for (size_t i = 0; i < indexCount; i++) {
+		const glm::vec3& p = vertices[indices[i]].pos;
+		const float d = glm::length(p - centre);
+		if (d > radius) {
+			const float grown = (radius + d) * 0.5f;
+			centre += (p - centre) * ((grown - radius) / d);
+			radius = grown;
+		}
+	}
+
+	bounds.centre = centre;
+	bounds.radius = radius;
+
+	//Cone axis - average of the unit triangle normals
+	const size_t triangleCount = indexCount / 3;
+	std::vector<glm::vec3> normals;
+	normals.reserve(triangleCount);
+
+	glm::vec3 axis(0.0f);
+	for (size_t t = 0; t < triangleCount; t++) {
+		const glm::vec3& p0 = vertices[indices[t * 3]].pos;
+		const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+		const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+
+		const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+		const float length = glm::length(n);
+
+		//Degenerate triangles face nowhere, leave them out
+		if (length <= 0.0f) continue;
+
+		normals.push_back(n / length);
+		axis += normals.back();
+	}
+
+	const float axisLength = glm::length(axis);
+	if (normals.empty() || axisLength <= 0.0f) {
+		bounds.coneApex = centre;
+		return bounds;
+	}
+	axis /= axisLength;
+
+	float minDot = 1.0f;
+	for (const auto& n : normals) {
+		minDot = std::min(minDot, glm::dot(n, axis));
+	}
+
+	bounds.coneAxis = axis;
+
+	if (minDot <= kMinConeSpread) {
+		bounds.coneApex = centre;
+		return bounds;
+	}
+
+	//Apex where the axis, moved back from the centre, is behind every triangle's plane
+	float maxT = 0.0f;
+	size_t n = 0;
+	for (size_t t = 0; t < triangleCount; t++) {
+		const glm::vec3& p0 = vertices[indices[t * 3]].pos;
+		const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+		const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+		if (glm::length(glm::cross(p1 - p0, p2 - p0)) <= 0.0f) continue;
+
+		const glm::vec3& normal = normals[n++];
+		const float denom = glm::dot(axis, normal);
+		maxT = std::max(maxT, glm::dot(centre - p0, normal) / denom);
+	}
+
+	bounds.coneApex = centre - axis * maxT;
+	bounds.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+
+	return bounds;
+}
+
+bool mesh::IsMeshletBackfacing(const MeshletBounds& bounds, const glm::vec3& cameraPosition)
+{
+	if (bounds.coneCutoff >= 1.0f) return false;
+
+	const glm::vec3 view = bounds.coneApex - cameraPosition;
+	const float length = glm::length(view);
+	if (length <= 0.0f) return false;
+
+	return glm::dot(view, bounds.coneAxis) >= bounds.coneCutoff * length;
+}
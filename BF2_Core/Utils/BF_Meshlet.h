@@ -0,0 +1,44 @@
+#pragma once
+
+#define GLM_FORCE_CTOR_INIT
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "BF_Vertex_Pos3Col3Uv2.h"
+
+//Cluster size limits - small enough to cull finely, big enough that the
+//per-cluster draw and cull cost stays well below the triangles saved
+constexpr uint32_t kMeshletMaxVertices = 64;
+constexpr uint32_t kMeshletMaxTriangles = 124;
+
+//Bounding sphere plus a normal cone - every triangle faces away from any
+//viewpoint inside the cone behind coneApex, so the cluster can be skipped
+struct MeshletBounds {
+	glm::vec3 centre;
+	float radius;
+
+	glm::vec3 coneApex;
+	glm::vec3 coneAxis;
+	float coneCutoff;		//sin of the normals' spread from the axis, 1 when it can never be culled
+};
+
+//A contiguous run of the mesh's index buffer
+struct Meshlet {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t vertexCount;	//unique vertices referenced
+	MeshletBounds bounds;
+};
+
+namespace mesh {
+	//Splits an index buffer into meshlets in order - run mesh::Optimize first,
+	//the cache ordering is what keeps neighbouring triangles together
+	std::vector<Meshlet> BuildMeshlets(const uint32_t* indices, size_t indexCount, const Vertex_Pos3Col3Uv2* vertices, size_t vertexCount,
+		uint32_t maxVertices = kMeshletMaxVertices, uint32_t maxTriangles = kMeshletMaxTriangles);
+
+	MeshletBounds ComputeMeshletBounds(const uint32_t* indices, size_t indexCount, const Vertex_Pos3Col3Uv2* vertices);
+
+	//CPU side of the cone test, cameraPosition in mesh space
+	bool IsMeshletBackfacing(const MeshletBounds&, const glm::vec3& cameraPosition);
+}
@@ -0,0 +1,319 @@
+#include "BF_Pak.h"
+#include "BF_Error.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef BF_PAK_LZ4
+	#include <lz4.h>
+#endif
+#ifdef BF_PAK_ZSTD
+	#include <zstd.h>
+#endif
+
+PakArchive::PakArchive() : m_header(nullptr), m_entries(nullptr), m_names(nullptr), m_namesSize(0)
+{
+}
+
+bool PakArchive::open(const std::string & filename)
+{
+	close();
+
+	if (!m_file.open(filename)) {
+		return false;
+	}
+
+	const char* base = m_file.data();
+	const size_t size = m_file.size();
+
+	//Validate everything up front so lookups can trust the tables
+	if (size < sizeof(PakHeader)) {
+		errorF("PakArchive - %s is too small to be a pak", filename.c_str());
+		close();
+		return false;
+	}
+
+	const PakHeader* header = reinterpret_cast<const PakHeader*>(base);
+	if (header->magic != kPakMagic || header->version != kPakVersion) {
+		errorF("PakArchive - %s is not a version %u pak", filename.c_str(), kPakVersion);
+		close();
+		return false;
+	}
+
+	const uint64_t tocEnd = header->tocOffset + static_cast<uint64_t>(header->entryCount) * sizeof(PakEntry);
+	if (header->tocOffset % alignof(PakEntry) != 0 || tocEnd > size || header->namesOffset < tocEnd || header->namesOffset > size) {
+		errorF("PakArchive - %s has a corrupt table of contents", filename.c_str());
+		close();
+		return false;
+	}
+
+	const PakEntry* entries = reinterpret_cast<const PakEntry*>(base + header->tocOffset);
+	for (uint32_t i = 0; i < header->entryCount; i++) {
+		if (entries[i].offset + entries[i].storedSize > header->tocOffset || entries[i].nameOffset >= size - header->namesOffset) {
+			errorF("PakArchive - %s entry %u is out of bounds", filename.c_str(), i);
+			close();
+			return false;
+		}
+	}
+
+	m_header = header;
+	m_entries = entries;
+	m_names = base + header->namesOffset;
+	m_namesSize = size - header->namesOffset;
+
+	return true;
+}
+
+void PakArchive::close()
+{
+	m_file.close();
+
+	m_header = nullptr;
+	m_entries = nullptr;
+	m_names = nullptr;
+	m_namesSize = 0;
+}
+
+const bool PakArchive::isOpen() const
+{
+	return m_header != nullptr;
+}
+
+const PakEntry * PakArchive::find(const std::string & name) const
+{
+	if (!m_header) return nullptr;
+
+	//TOC is sorted by hash
+	const uint64_t hash = pak::Hash(name);
+	const PakEntry* end = m_entries + m_header->entryCount;
+	const PakEntry* it = std::lower_bound(m_entries, end, hash, [](const PakEntry& e, uint64_t h) { return e.hash < h; });
+
+	if (it == end || it->hash != hash) {
+		return nullptr;
+	}
+
+	return it;
+}
+
+const char * PakArchive::view(const PakEntry & entry) const
+{
+	if (static_cast<PakCompression>(entry.compression) != PakCompression::None) {
+		return nullptr;
+	}
+
+	return m_file.data() + entry.offset;
+}
+
+bool PakArchive::read(const PakEntry & entry, void * dst, size_t dstSize) const
+{
+	if (dstSize < entry.size) {
+		errorF("PakArchive::read() - %s needs %llu bytes, given %llu", getEntryName(entry),
+			static_cast<unsigned long long>(entry.size), static_cast<unsigned long long>(dstSize));
+		return false;
+	}
+
+	const char* src = m_file.data() + entry.offset;
+
+	switch (static_cast<PakCompression>(entry.compression)) {
+	case PakCompression::None:
+		std::memcpy(dst, src, static_cast<size_t>(entry.size));
+		return true;
+
+#ifdef BF_PAK_LZ4
+	case PakCompression::LZ4:
+		return LZ4_decompress_safe(src, static_cast<char*>(dst), static_cast<int>(entry.storedSize), static_cast<int>(dstSize)) == static_cast<int>(entry.size);
+#endif
+
+#ifdef BF_PAK_ZSTD
+	case PakCompression::Zstd:
+		return ZSTD_decompress(dst, dstSize, src, static_cast<size_t>(entry.storedSize)) == entry.size;
+#endif
+
+	default:
+		errorF("PakArchive::read() - %s uses a compression this build doesn't support (%u)", getEntryName(entry), entry.compression);
+		return false;
+	}
+}
+
+std::vector<char> PakArchive::readAll(const std::string & name) const
+{
+	const PakEntry* entry = find(name);
+	if (!entry) {
+		return {};
+	}
+
+	std::vector<char> data(static_cast<size_t>(entry->size));
+	if (!read(*entry, data.data(), data.size())) {
+		return {};
+	}
+
+	return data;
+}
+
+const uint32_t PakArchive::getEntryCount() const
+{
+	return m_header ? m_header->entryCount : 0;
+}
+
+const char * PakArchive::getEntryName(const PakEntry & entry) const
+{
+	return m_names ? m_names + entry.nameOffset : "";
+}
+
+uint64_t pak::Hash(const std::string & name)
+{
+	uint64_t hash = 14695981039346656037ull;
+
+	for (char c : name) {
+		hash ^= static_cast<uint8_t>(c == '\\' ? '/' : c);
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+//--- Packer ---
+
+namespace {
+	struct PackItem {
+		std::string name;
+		std::filesystem::path path;
+		uint64_t hash;
+	};
+
+	std::vector<char> compress(const std::vector<char>& data, PakCompression& compression)
+	{
+		compression = PakCompression::None;
+		std::vector<char> out;
+
+#if defined(BF_PAK_ZSTD)
+		out.resize(ZSTD_compressBound(data.size()));
+		const size_t packed = ZSTD_compress(out.data(), out.size(), data.data(), data.size(), 19);
+		if (ZSTD_isError(packed)) return {};
+		out.resize(packed);
+		compression = PakCompression::Zstd;
+#elif defined(BF_PAK_LZ4)
+		out.resize(LZ4_compressBound(static_cast<int>(data.size())));
+		const int packed = LZ4_compress_default(data.data(), out.data(), static_cast<int>(data.size()), static_cast<int>(out.size()));
+		if (packed <= 0) return {};
+		out.resize(packed);
+		compression = PakCompression::LZ4;
+#else
+		(void)data;
+#endif
+
+		return out;
+	}
+
+	void pad(std::ofstream& file, uint64_t alignment)
+	{
+		static const char zeros[kPakAlignment] = {};
+
+		uint64_t remainder = static_cast<uint64_t>(file.tellp()) % alignment;
+		uint64_t padding = remainder ? alignment - remainder : 0;
+
+		while (padding > 0) {
+			const uint64_t chunk = std::min<uint64_t>(padding, sizeof(zeros));
+			file.write(zeros, chunk);
+			padding -= chunk;
+		}
+	}
+}
+
+bool pak::Build(const std::string & sourceDir, const std::string & outFile, const std::string & extension)
+{
+	namespace fs = std::filesystem;
+
+	std::error_code ec;
+	if (!fs::is_directory(sourceDir, ec)) {
+		errorF("pak::Build() - %s is not a directory", sourceDir.c_str());
+		return false;
+	}
+
+	//Gather files, named by their path relative to the source dir
+	std::vector<PackItem> items;
+	for (const auto& file : fs::recursive_directory_iterator(sourceDir)) {
+		if (!file.is_regular_file()) continue;
+
+		const std::string name = fs::relative(file.path(), sourceDir).generic_string();
+		if (!extension.empty() && (name.size() < extension.size() || name.compare(name.size() - extension.size(), extension.size(), extension) != 0)) {
+			continue;
+		}
+
+		items.push_back({ name, file.path(), Hash(name) });
+	}
+
+	std::sort(items.begin(), items.end(), [](const PackItem& a, const PackItem& b) { return a.hash < b.hash; });
+
+	for (size_t i = 1; i < items.size(); i++) {
+		if (items[i].hash == items[i - 1].hash) {
+			errorF("pak::Build() - hash collision between %s and %s", items[i].name.c_str(), items[i - 1].name.c_str());
+			return false;
+		}
+	}
+
+	std::ofstream out(outFile, std::ios::binary | std::ios::trunc);
+	if (!out.is_open()) {
+		errorF("pak::Build() - failed to open %s for writing", outFile.c_str());
+		return false;
+	}
+
+	//Header is rewritten once the table offsets are known
+	PakHeader header = {};
+	header.magic = kPakMagic;
+	header.version = kPakVersion;
+	header.entryCount = static_cast<uint32_t>(items.size());
+	header.alignment = kPakAlignment;
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	std::vector<PakEntry> entries;
+	std::string names;
+
+	for (const auto& item : items) {
+		std::ifstream in(item.path, std::ios::binary | std::ios::ate);
+		if (!in.is_open()) {
+			errorF("pak::Build() - failed to read %s", item.path.string().c_str());
+			return false;
+		}
+
+		std::vector<char> data(static_cast<size_t>(in.tellg()));
+		in.seekg(0);
+		in.read(data.data(), data.size());
+
+		//Only keep compressed data if it actually saves something worthwhile
+		PakCompression compression;
+		std::vector<char> packed = compress(data, compression);
+		const bool usePacked = compression != PakCompression::None && !packed.empty() && packed.size() < data.size() - data.size() / 10;
+		const std::vector<char>& stored = usePacked ? packed : data;
+
+		pad(out, kPakAlignment);
+
+		PakEntry entry = {};
+		entry.hash = item.hash;
+		entry.offset = static_cast<uint64_t>(out.tellp());
+		entry.storedSize = stored.size();
+		entry.size = data.size();
+		entry.compression = static_cast<uint32_t>(usePacked ? compression : PakCompression::None);
+		entry.nameOffset = static_cast<uint32_t>(names.size());
+		entries.push_back(entry);
+
+		names += item.name;
+		names.push_back('\0');
+
+		out.write(stored.data(), stored.size());
+	}
+
+	pad(out, alignof(PakEntry));
+	header.tocOffset = static_cast<uint64_t>(out.tellp());
+	out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(PakEntry));
+
+	header.namesOffset = static_cast<uint64_t>(out.tellp());
+	out.write(names.data(), names.size());
+
+	out.seekp(0);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	return out.good();
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BF_Memory.h"
+
+//Pak layout (little endian):
+//  PakHeader
+//  entry data, each entry starting on a PakHeader::alignment boundary
+//  PakEntry table sorted by name hash
+//  name string table (for collision checks and debugging)
+
+constexpr uint32_t kPakMagic = 0x4B504642;	//"BFPK"
+constexpr uint32_t kPakVersion = 1;
+
+//Default entry alignment - covers SPIR-V and typical GPU copy offset alignment
+constexpr uint32_t kPakAlignment = 256;
+
+enum class PakCompression : uint32_t {
+	None = 0,
+	LZ4 = 1,	//needs BF_PAK_LZ4 (lz4)
+	Zstd = 2,	//needs BF_PAK_ZSTD (zstd)
+};
+
+struct PakHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t alignment;
+	uint64_t tocOffset;
+	uint64_t namesOffset;
+};
+
+struct PakEntry {
+	uint64_t hash;
+	uint64_t offset;
+	uint64_t storedSize;
+	uint64_t size;			//size once decompressed
+	uint32_t compression;
+	uint32_t nameOffset;	//into the name table, null terminated
+};
+
+static_assert(sizeof(PakHeader) == 32, "PakHeader layout is part of the file format");
+static_assert(sizeof(PakEntry) == 40, "PakEntry layout is part of the file format");
+
+class PakArchive {
+public:
+	PakArchive();
+	PakArchive(const PakArchive&) = delete;
+	PakArchive& operator=(const PakArchive&) = delete;
+
+	bool open(const std::string& filename);
+	void close();
+
+	const bool isOpen() const;
+
+	//nullptr if the archive doesn't contain name
+	const PakEntry* find(const std::string& name) const;
+
+	//Straight into the mapping for uncompressed entries, nullptr if compressed
+	const char* view(const PakEntry&) const;
+
+	//Copy/decompress an entry into caller memory, e.g. a mapped staging buffer.
+	//dstSize must be at least entry.size.
+	bool read(const PakEntry&, void* dst, size_t dstSize) const;
+
+	//Convenience copy of a whole entry, empty if missing
+	std::vector<char> readAll(const std::string& name) const;
+
+	const uint32_t getEntryCount() const;
+	const char* getEntryName(const PakEntry&) const;
+
+private:
+	mem::MappedFile m_file;
+
+	const PakHeader* m_header;
+	const PakEntry* m_entries;
+	const char* m_names;
+	size_t m_namesSize;
+};
+
+namespace pak {
+	//FNV-1a over the name with '\' normalised to '/'
+	uint64_t Hash(const std::string& name);
+
+	//Pack every file under sourceDir (optionally only those ending in extension)
+	//into outFile. Entries are compressed when a codec is built in and it helps -
+	//that takes BF_PAK_ZSTD or BF_PAK_LZ4 defined and the library linked, without
+	//either every entry is stored uncompressed.
+	bool Build(const std::string& sourceDir, const std::string& outFile, const std::string& extension = "");
+}
@@ -0,0 +1,160 @@
+#include "BF_Profiler.h"
+#include "BF_Error.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+	struct Event {
+		const char* name;
+		uint64_t start;
+		uint64_t end;
+	};
+
+	//Written only by its owning thread, so recording needs no lock -
+	//the mutex below is only taken once per thread to register the buffer
+	struct ThreadBuffer {
+		uint32_t threadId;
+		const char* threadName;
+		std::unique_ptr<Event[]> events;
+		std::atomic<uint64_t> writeIndex;
+	};
+
+	std::mutex s_registryMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> s_buffers;
+
+	thread_local ThreadBuffer* t_buffer = nullptr;
+
+	//Calibration points for converting raw ticks to time
+	uint64_t s_startTicks = 0;
+	std::chrono::steady_clock::time_point s_startTime;
+
+	ThreadBuffer* getThreadBuffer()
+	{
+		if (!t_buffer)
+		{
+			auto buffer = std::make_unique<ThreadBuffer>();
+			buffer->threadName = nullptr;
+			buffer->events = std::make_unique<Event[]>(kProfilerEventsPerThread);
+			buffer->writeIndex.store(0, std::memory_order_relaxed);
+
+			std::lock_guard<std::mutex> lock(s_registryMutex);
+			buffer->threadId = static_cast<uint32_t>(s_buffers.size());
+			t_buffer = buffer.get();
+			s_buffers.push_back(std::move(buffer));
+		}
+
+		return t_buffer;
+	}
+
+	void writeEscaped(FILE* file, const char* str)
+	{
+		for (; *str; ++str)
+		{
+			if (*str == '"' || *str == '\\')
+			{
+				std::fputc('\\', file);
+			}
+			std::fputc(*str, file);
+		}
+	}
+}
+
+void prof::Init()
+{
+	s_startTicks = Now();
+	s_startTime = std::chrono::steady_clock::now();
+
+	//register the main thread
+	SetThreadName("Main");
+}
+
+void prof::Shutdown()
+{
+	//Buffers stay registered to their threads; just forget what was recorded
+	std::lock_guard<std::mutex> lock(s_registryMutex);
+	for (auto& buffer : s_buffers)
+	{
+		buffer->writeIndex.store(0, std::memory_order_relaxed);
+	}
+}
+
+void prof::SetThreadName(const char* name)
+{
+	getThreadBuffer()->threadName = name;
+}
+
+void prof::Record(const char* name, uint64_t start, uint64_t end)
+{
+	ThreadBuffer* buffer = getThreadBuffer();
+
+	const uint64_t index = buffer->writeIndex.load(std::memory_order_relaxed);
+	Event& e = buffer->events[index & (kProfilerEventsPerThread - 1)];
+	e.name = name;
+	e.start = start;
+	e.end = end;
+
+	//publish the event to the exporter
+	buffer->writeIndex.store(index + 1, std::memory_order_release);
+}
+
+bool prof::ExportChromeTrace(const std::string & filename)
+{
+	//Calibrate ticks against the steady clock over the whole run
+	const uint64_t endTicks = Now();
+	const auto endTime = std::chrono::steady_clock::now();
+
+	const double elapsedUs = std::chrono::duration<double, std::micro>(endTime - s_startTime).count();
+	const double ticksPerUs = elapsedUs > 0.0 ? static_cast<double>(endTicks - s_startTicks) / elapsedUs : 1.0;
+
+	FILE* file = std::fopen(filename.c_str(), "w");
+	if (!file)
+	{
+		errorF("prof::ExportChromeTrace() - failed to open %s", filename.c_str());
+		return false;
+	}
+
+	std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+	bool first = true;
+
+	std::lock_guard<std::mutex> lock(s_registryMutex);
+	for (const auto& buffer : s_buffers)
+	{
+		//Thread label metadata
+		if (buffer->threadName)
+		{
+			std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", first ? "" : ",\n", buffer->threadId);
+			writeEscaped(file, buffer->threadName);
+			std::fprintf(file, "\"}}");
+			first = false;
+		}
+
+		//Threads still running may overwrite the oldest events while we read -
+		//acceptable for a capture, the newest events are always intact
+		const uint64_t count = buffer->writeIndex.load(std::memory_order_acquire);
+		const uint64_t oldest = count > kProfilerEventsPerThread ? count - kProfilerEventsPerThread : 0;
+
+		for (uint64_t i = oldest; i < count; i++)
+		{
+			const Event& e = buffer->events[i & (kProfilerEventsPerThread - 1)];
+
+			const double ts = static_cast<double>(static_cast<int64_t>(e.start - s_startTicks)) / ticksPerUs;
+			const double dur = static_cast<double>(e.end - e.start) / ticksPerUs;
+
+			std::fprintf(file, "%s{\"name\":\"", first ? "" : ",\n");
+			writeEscaped(file, e.name);
+			std::fprintf(file, "\",\"cat\":\"cpu\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}", ts, dur, buffer->threadId);
+			first = false;
+		}
+	}
+
+	std::fprintf(file, "\n]}\n");
+	std::fclose(file);
+
+	return true;
+}
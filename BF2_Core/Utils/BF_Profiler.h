@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h>
+#else
+	#include <chrono>
+#endif
+
+//Events kept per thread (ring buffer, oldest overwritten) - must be a power of 2
+constexpr uint32_t kProfilerEventsPerThread = 1 << 16;
+
+namespace prof {
+	//Raw timestamp - rdtsc where available, converted to time at export
+	inline uint64_t Now()
+	{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+	}
+
+	//Call once at startup, before any zones are recorded
+	void Init();
+	void Shutdown();
+
+	//Label for the calling thread in the trace (string must outlive the profiler)
+	void SetThreadName(const char* name);
+
+	//Record a finished zone on the calling thread's buffer - no locks taken
+	void Record(const char* name, uint64_t start, uint64_t end);
+
+	//Write all recorded zones as Chrome trace JSON (chrome://tracing, ui.perfetto.dev)
+	bool ExportChromeTrace(const std::string& filename);
+
+	//Times the enclosing block
+	class ScopedZone {
+	public:
+		explicit ScopedZone(const char* name) : m_name(name), m_start(Now())
+		{
+		}
+
+		~ScopedZone()
+		{
+			Record(m_name, m_start, Now());
+		}
+
+		ScopedZone(const ScopedZone&) = delete;
+		ScopedZone& operator=(const ScopedZone&) = delete;
+
+	private:
+		const char* m_name;
+		uint64_t m_start;
+	};
+}
+
+#define BF_PROFILE_CONCAT_INNER(a, b) a##b
+#define BF_PROFILE_CONCAT(a, b) BF_PROFILE_CONCAT_INNER(a, b)
+
+#ifndef BF_PROFILER_DISABLED
+	#define BF_PROFILE_ZONE(name) prof::ScopedZone BF_PROFILE_CONCAT(bfProfileZone, __LINE__)(name)
+#else
+	#define BF_PROFILE_ZONE(name)
+#endif
@@ -0,0 +1,361 @@
+#include "BF_SpatialGrid.h"
+#include "BF_Consts.h"
+#include "BF_Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+//Cell coordinates are packed 21 bits an axis into the key, so the grid spans
+//this many cells either side of the origin. Positions past it clamp into the
+//edge cells, where loose bounds no longer cover them.
+static constexpr int32_t kGridCellRange = (1 << 20) - 1;
+
+//Fewer ids than this a thread aren't worth the thread
+static constexpr size_t kGridMinPerThread = 4096;
+
+static int32_t CellCoord(float position, float inverseCellSize)
+{
+	const float coord = std::floor(position * inverseCellSize);
+	return static_cast<int32_t>(std::max(-static_cast<float>(kGridCellRange), std::min(static_cast<float>(kGridCellRange), coord)));
+}
+
+static uint64_t PackKey(int32_t x, int32_t y, int32_t z)
+{
+	constexpr uint64_t kMask = (1u << 21) - 1;
+	return (static_cast<uint64_t>(x + kGridCellRange + 1) & kMask) |
+		((static_cast<uint64_t>(y + kGridCellRange + 1) & kMask) << 21) |
+		((static_cast<uint64_t>(z + kGridCellRange + 1) & kMask) << 42);
+}
+
+SpatialGrid::SpatialGrid() : m_cellSize(1.0f), m_inverseCellSize(1.0f), m_maxExtent(0.0f),
+	m_task(nullptr), m_taskCount(0), m_generation(0), m_pending(0), m_exit(false)
+{
+}
+
+SpatialGrid::~SpatialGrid()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_exit = true;
+	}
+	m_wake.notify_all();
+
+	for (auto& worker : m_workers) {
+		worker.join();
+	}
+}
+
+void SpatialGrid::init(float cellSize)
+{
+	m_cellSize = cellSize;
+	m_inverseCellSize = 1.0f / cellSize;
+}
+
+void SpatialGrid::clear()
+{
+	m_maxExtent = glm::vec3(0.0f);
+	m_cells.clear();
+	m_freeCells.clear();
+	m_cellOf.clear();
+	m_boxes.clear();
+	m_cell.clear();
+	m_slot.clear();
+}
+
+void SpatialGrid::rebuild(const Aabb* boxes, size_t count)
+{
+	BF_PROFILE_ZONE("SpatialGrid::rebuild");
+
+	clear();
+	m_boxes.assign(boxes, boxes + count);
+	m_cell.assign(count, kNone);
+	m_slot.assign(count, 0);
+	if (count == 0) return;
+
+	uint32_t threads = kGridRebuildThreads > 0 ? kGridRebuildThreads : std::max(1u, std::thread::hardware_concurrency());
+	threads = static_cast<uint32_t>(std::max<size_t>(1, std::min<size_t>(threads, count / kGridMinPerThread)));
+
+	//Keys and widest extent per chunk, each chunk then sorted by key
+	std::vector<std::pair<uint64_t, uint32_t>> keyed(count);
+	std::vector<glm::vec3> extents(threads, glm::vec3(0.0f));
+	const size_t chunk = (count + threads - 1) / threads;
+
+	runParallel(threads, [&](uint32_t thread) {
+		BF_PROFILE_ZONE("SpatialGrid::key");
+
+		const size_t begin = std::min(count, thread * chunk);
+		const size_t end = std::min(count, begin + chunk);
+		for (size_t i = begin; i < end; i++) {
+			keyed[i] = { keyOf(boxes[i].centre()), static_cast<uint32_t>(i) };
+			extents[thread] = glm::max(extents[thread], boxes[i].extent());
+		}
+		std::sort(keyed.begin() + begin, keyed.begin() + end);
+	});
+
+	//Sorted chunks merged pairwise, every merge of a round on its own thread
+	for (size_t width = chunk; width < count; width *= 2) {
+		const uint32_t merges = static_cast<uint32_t>((count + width * 2 - 1) / (width * 2));
+
+		runParallel(merges, [&](uint32_t merge) {
+			const size_t begin = merge * width * 2;
+			const size_t middle = std::min(count, begin + width);
+			const size_t end = std::min(count, begin + width * 2);
+			if (middle < end) {
+				std::inplace_merge(keyed.begin() + begin, keyed.begin() + middle, keyed.begin() + end);
+			}
+		});
+	}
+
+	for (const auto& extent : extents) {
+		m_maxExtent = glm::max(m_maxExtent, extent);
+	}
+
+	//Every run of one key is a cell, ids already in order
+	for (size_t i = 0; i < count;) {
+		const uint64_t key = keyed[i].first;
+		const uint32_t cell = findOrAddCell(key, boxes[keyed[i].second].centre());
+
+		for (; i < count && keyed[i].first == key; i++) {
+			addToCell(keyed[i].second, cell);
+		}
+	}
+}
+
+void SpatialGrid::insert(uint32_t id, const Aabb& box)
+{
+	if (id >= m_boxes.size()) {
+		m_boxes.resize(id + 1);
+		m_cell.resize(id + 1, kNone);
+		m_slot.resize(id + 1, 0);
+	}
+
+	m_boxes[id] = box;
+	m_maxExtent = glm::max(m_maxExtent, box.extent());
+
+	const glm::vec3 centre = box.centre();
+	addToCell(id, findOrAddCell(keyOf(centre), centre));
+}
+
+void SpatialGrid::update(uint32_t id, const Aabb& box)
+{
+	m_boxes[id] = box;
+	m_maxExtent = glm::max(m_maxExtent, box.extent());
+
+	//Still in the same cell - the usual case for a frame's movement
+	const glm::vec3 centre = box.centre();
+	const uint64_t key = keyOf(centre);
+	if (m_cells[m_cell[id]].key == key) return;
+
+	removeFromCell(id);
+	addToCell(id, findOrAddCell(key, centre));
+}
+
+void SpatialGrid::queryBox(const Aabb& box, std::vector<uint32_t>& out) const
+{
+	if (m_cellOf.empty()) return;
+
+	auto visit = [&](const Cell& cell) {
+		for (uint32_t id : cell.ids) {
+			if (m_boxes[id].overlaps(box)) out.push_back(id);
+		}
+	};
+
+	//Any id overlapping has its centre within the widest extent of the box
+	const glm::vec3 low = box.min - m_maxExtent;
+	const glm::vec3 high = box.max + m_maxExtent;
+
+	int32_t from[3], to[3];
+	double cellsCovered = 1.0;
+	for (int axis = 0; axis < 3; axis++) {
+		from[axis] = CellCoord(low[axis], m_inverseCellSize);
+		to[axis] = CellCoord(high[axis], m_inverseCellSize);
+		cellsCovered *= static_cast<double>(to[axis]) - from[axis] + 1.0;
+	}
+
+	//Big queries walk the occupied cells instead of hashing every covered one
+	if (cellsCovered > static_cast<double>(m_cellOf.size())) {
+		for (const auto& cell : m_cells) {
+			if (!cell.ids.empty() && looseBounds(cell).overlaps(box)) visit(cell);
+		}
+		return;
+	}
+
+	for (int32_t z = from[2]; z <= to[2]; z++) {
+		for (int32_t y = from[1]; y <= to[1]; y++) {
+			for (int32_t x = from[0]; x <= to[0]; x++) {
+				const auto found = m_cellOf.find(PackKey(x, y, z));
+				if (found != m_cellOf.end()) visit(m_cells[found->second]);
+			}
+		}
+	}
+}
+
+void SpatialGrid::queryFrustum(const glm::vec4 planes[6], std::vector<uint32_t>& out) const
+{
+	for (const auto& cell : m_cells) {
+		if (cell.ids.empty()) continue;
+
+		const int side = looseBounds(cell).classify(planes);
+		if (side < 0) continue;
+
+		//Loose bounds inside - so is every box in the cell
+		if (side > 0) {
+			out.insert(out.end(), cell.ids.begin(), cell.ids.end());
+			continue;
+		}
+
+		for (uint32_t id : cell.ids) {
+			if (m_boxes[id].classify(planes) >= 0) out.push_back(id);
+		}
+	}
+}
+
+bool SpatialGrid::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, uint32_t& id, float& distance) const
+{
+	const glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	bool hit = false;
+	float nearest = maxDistance;
+
+	for (const auto& cell : m_cells) {
+		float t;
+		if (cell.ids.empty() || !looseBounds(cell).intersectRay(origin, inverseDirection, nearest, t)) continue;
+
+		for (uint32_t item : cell.ids) {
+			if (m_boxes[item].intersectRay(origin, inverseDirection, nearest, t) && (!hit || t < nearest)) {
+				hit = true;
+				nearest = t;
+				id = item;
+			}
+		}
+	}
+
+	if (hit) distance = nearest;
+	return hit;
+}
+
+const Aabb& SpatialGrid::getBox(uint32_t id) const
+{
+	return m_boxes[id];
+}
+
+const size_t SpatialGrid::getCellCount() const
+{
+	return m_cellOf.size();
+}
+
+uint64_t SpatialGrid::keyOf(const glm::vec3& position) const
+{
+	return PackKey(CellCoord(position.x, m_inverseCellSize), CellCoord(position.y, m_inverseCellSize), CellCoord(position.z, m_inverseCellSize));
+}
+
+uint32_t SpatialGrid::findOrAddCell(uint64_t key, const glm::vec3& position)
+{
+	const auto found = m_cellOf.find(key);
+	if (found != m_cellOf.end()) return found->second;
+
+	//Emptied cells are reused, keeping their id storage
+	uint32_t cell;
+	if (!m_freeCells.empty()) {
+		cell = m_freeCells.back();
+		m_freeCells.pop_back();
+	}
+	else {
+		cell = static_cast<uint32_t>(m_cells.size());
+		m_cells.emplace_back();
+	}
+
+	m_cells[cell].key = key;
+	m_cells[cell].min = glm::vec3(
+		static_cast<float>(CellCoord(position.x, m_inverseCellSize)),
+		static_cast<float>(CellCoord(position.y, m_inverseCellSize)),
+		static_cast<float>(CellCoord(position.z, m_inverseCellSize))) * m_cellSize;
+
+	m_cellOf.emplace(key, cell);
+	return cell;
+}
+
+void SpatialGrid::addToCell(uint32_t id, uint32_t cell)
+{
+	m_cell[id] = cell;
+	m_slot[id] = static_cast<uint32_t>(m_cells[cell].ids.size());
+	m_cells[cell].ids.push_back(id);
+}
+
+void SpatialGrid::removeFromCell(uint32_t id)
+{
+	const uint32_t cell = m_cell[id];
+	std::vector<uint32_t>& ids = m_cells[cell].ids;
+
+	//Swap with the last so the removal is O(1)
+	const uint32_t last = ids.back();
+	ids[m_slot[id]] = last;
+	m_slot[last] = m_slot[id];
+	ids.pop_back();
+
+	if (ids.empty()) {
+		m_cellOf.erase(m_cells[cell].key);
+		m_freeCells.push_back(cell);
+	}
+
+	m_cell[id] = kNone;
+}
+
+Aabb SpatialGrid::looseBounds(const Cell& cell) const
+{
+	Aabb bounds;
+	bounds.min = cell.min - m_maxExtent;
+	bounds.max = cell.min + glm::vec3(m_cellSize) + m_maxExtent;
+	return bounds;
+}
+
+void SpatialGrid::runParallel(uint32_t count, const std::function<void(uint32_t)>& task)
+{
+	if (count == 0) return;
+
+	//Kept between rebuilds - a thread a rebuild would also leave a profiler buffer behind each time
+	while (m_workers.size() + 1 < count) {
+		m_workers.emplace_back(&SpatialGrid::workerThread, this, static_cast<uint32_t>(m_workers.size()), m_generation);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = &task;
+		m_taskCount = count;
+		m_pending = static_cast<uint32_t>(m_workers.size());
+		m_generation++;
+	}
+	m_wake.notify_all();
+
+	task(0);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this]() { return m_pending == 0; });
+	m_task = nullptr;
+}
+
+void SpatialGrid::workerThread(uint32_t index, uint64_t generation)
+{
+	prof::SetThreadName("Grid Worker");
+
+	while (true) {
+		const std::function<void(uint32_t)>* task;
+		uint32_t count;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [&]() { return m_exit || m_generation != generation; });
+
+			if (m_exit) return;
+
+			generation = m_generation;
+			task = m_task;
+			count = m_taskCount;
+		}
+
+		if (index + 1 < count) (*task)(index + 1);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_pending == 0) m_done.notify_one();
+	}
+}
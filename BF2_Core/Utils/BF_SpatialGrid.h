@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "BF_Aabb.h"
+
+//Hashed uniform grid over dense ids (Scene entities), an alternative to Bvh for
+//scenes where nearly everything moves every frame. Each id lives in the one cell
+//holding its box centre; cells are loose, queries widen by the largest half
+//extent seen, so a move is a compare or an O(1) swap between two cells.
+class SpatialGrid {
+public:
+	SpatialGrid();
+	~SpatialGrid();
+	SpatialGrid(const SpatialGrid&) = delete;
+	SpatialGrid& operator=(const SpatialGrid&) = delete;
+
+	void init(float cellSize);
+	void clear();
+
+	//Bulk placement of every id, boxes[i] is id i. Cell keys are computed and sorted
+	//across threads (kGridRebuildThreads), only the cell list is built serially.
+	//The threads are started by the first rebuild needing them and kept.
+	void rebuild(const Aabb* boxes, size_t count);
+
+	void insert(uint32_t id, const Aabb&);
+	void update(uint32_t id, const Aabb&);
+
+	//Appends every id whose box overlaps
+	void queryBox(const Aabb&, std::vector<uint32_t>& out) const;
+
+	//Appends every id whose box is at least partly inside, planes normalized and facing inwards
+	void queryFrustum(const glm::vec4 planes[6], std::vector<uint32_t>& out) const;
+
+	//Nearest box along the ray, direction normalized. Visits every occupied cell,
+	//the BVH is the better index for ray heavy use.
+	bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, uint32_t& id, float& distance) const;
+
+	const Aabb& getBox(uint32_t id) const;
+	const size_t getCellCount() const;
+
+private:
+	struct Cell {
+		uint64_t key;
+		glm::vec3 min;					//corner of the cell proper, loose bounds add m_maxExtent
+		std::vector<uint32_t> ids;
+	};
+
+	static constexpr uint32_t kNone = ~0u;
+
+	uint64_t keyOf(const glm::vec3& position) const;
+	uint32_t findOrAddCell(uint64_t key, const glm::vec3& position);
+	void addToCell(uint32_t id, uint32_t cell);
+	void removeFromCell(uint32_t id);
+	Aabb looseBounds(const Cell&) const;
+
+	//Runs task(0 .. count - 1) across the workers, the caller taking task 0
+	void runParallel(uint32_t count, const std::function<void(uint32_t)>& task);
+	void workerThread(uint32_t index, uint64_t generation);
+
+	float m_cellSize;
+	float m_inverseCellSize;
+
+	//Widest half extent of any box placed since the last rebuild
+	glm::vec3 m_maxExtent;
+
+	std::vector<Cell> m_cells;
+	std::vector<uint32_t> m_freeCells;
+	std::unordered_map<uint64_t, uint32_t> m_cellOf;	//by key
+
+	//Per id - its box, cell and slot in that cell's ids
+	std::vector<Aabb> m_boxes;
+	std::vector<uint32_t> m_cell;
+	std::vector<uint32_t> m_slot;
+
+	//Rebuild workers - worker i runs task i + 1 of each generation
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_done;
+	const std::function<void(uint32_t)>* m_task;
+	uint32_t m_taskCount;
+	uint64_t m_generation;
+	uint32_t m_pending;				//workers yet to finish this generation
+	bool m_exit;
+};
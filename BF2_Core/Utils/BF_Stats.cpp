@@ -0,0 +1,69 @@
+#include "BF_Stats.h"
+
+#include <algorithm>
+
+SampleWindow::SampleWindow(size_t capacity) : m_capacity(capacity > 0 ? capacity : 1), m_next(0)
+{
+	m_samples.reserve(m_capacity);
+}
+
+void SampleWindow::add(double sample)
+{
+	//fill up first, then overwrite the oldest
+	if (m_samples.size() < m_capacity)
+	{
+		m_samples.push_back(sample);
+	}
+	else
+	{
+		m_samples[m_next] = sample;
+	}
+
+	m_next = (m_next + 1) % m_capacity;
+}
+
+void SampleWindow::clear()
+{
+	m_samples.clear();
+	m_next = 0;
+}
+
+size_t SampleWindow::size() const
+{
+	return m_samples.size();
+}
+
+TimingStats SampleWindow::compute() const
+{
+	TimingStats stats = {};
+
+	if (m_samples.empty())
+	{
+		return stats;
+	}
+
+	std::vector<double> sorted(m_samples);
+	std::sort(sorted.begin(), sorted.end());
+
+	double total = 0.0;
+	for (double s : sorted)
+	{
+		total += s;
+	}
+
+	//nearest-rank percentiles
+	auto percentile = [&sorted](double p) {
+		size_t rank = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+		return sorted[rank];
+	};
+
+	stats.min = sorted.front();
+	stats.max = sorted.back();
+	stats.avg = total / static_cast<double>(sorted.size());
+	stats.p50 = percentile(0.50);
+	stats.p95 = percentile(0.95);
+	stats.p99 = percentile(0.99);
+	stats.count = static_cast<uint32_t>(sorted.size());
+
+	return stats;
+}
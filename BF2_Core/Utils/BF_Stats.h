@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+//Summary of a set of timing samples (units are whatever was added)
+struct TimingStats {
+	double min;
+	double avg;
+	double max;
+	double p50;
+	double p95;
+	double p99;
+	uint32_t count;
+};
+
+//Rolling window over the last N samples
+class SampleWindow {
+public:
+	explicit SampleWindow(size_t capacity = 256);
+
+	void add(double sample);
+	void clear();
+
+	size_t size() const;
+
+	TimingStats compute() const;
+
+private:
+	std::vector<double> m_samples;
+	size_t m_capacity;
+	size_t m_next;
+};
@@ -0,0 +1,26 @@
+#pragma once
+#define GLM_FORCE_CTOR_INIT
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+struct Transform {
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+	glm::vec3 scale = glm::vec3(1.0f);
+
+	glm::mat4 toMatrix() const {
+		glm::mat4 m = glm::translate(glm::mat4(1.0f), position);
+		m = m * glm::mat4_cast(rotation);
+		return glm::scale(m, scale);
+	}
+
+	//Blend between two simulation states - t = 0 gives a, t = 1 gives b
+	static Transform interpolate(const Transform& a, const Transform& b, float t) {
+		Transform result;
+		result.position = glm::mix(a.position, b.position, t);
+		result.rotation = glm::slerp(a.rotation, b.rotation, t);
+		result.scale = glm::mix(a.scale, b.scale, t);
+		return result;
+	}
+};
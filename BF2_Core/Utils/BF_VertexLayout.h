@@ -0,0 +1,136 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+//Vertex input described once as a list of attributes - offsets, stride, formats
+//and locations are all worked out at compile time. Attributes are tightly packed
+//in the order listed, which must be the struct's member order:
+//
+//	struct Vertex_Example {
+//		glm::vec3 pos;
+//		uint8_t colour[4];
+//
+//		using Layout = VertexLayout<
+//			VertexAttribute<0, vtx::Float32, 3>,
+//			VertexAttribute<1, vtx::Unorm8, 4>>;
+//	};
+//
+//with a static_assert per member that offsetof matches Layout::kOffsets.
+
+//Component types - size in bytes and whether the shader sees integers
+namespace vtx {
+	struct Float32	{ static constexpr uint32_t size = 4; static constexpr bool integer = false; };
+	struct Float16	{ static constexpr uint32_t size = 2; static constexpr bool integer = false; };
+	struct Snorm16	{ static constexpr uint32_t size = 2; static constexpr bool integer = false; };
+	struct Unorm16	{ static constexpr uint32_t size = 2; static constexpr bool integer = false; };
+	struct Snorm8	{ static constexpr uint32_t size = 1; static constexpr bool integer = false; };
+	struct Unorm8	{ static constexpr uint32_t size = 1; static constexpr bool integer = false; };
+	struct Uint32	{ static constexpr uint32_t size = 4; static constexpr bool integer = true; };
+	struct Sint32	{ static constexpr uint32_t size = 4; static constexpr bool integer = true; };
+	struct Uint8	{ static constexpr uint32_t size = 1; static constexpr bool integer = true; };
+
+	//VkFormat for Count components of Type, only the combinations vertex fetch supports
+	template<typename Type, uint32_t Count> struct Format;
+
+	template<> struct Format<Float32, 1> { static constexpr VkFormat value = VK_FORMAT_R32_SFLOAT; };
+	template<> struct Format<Float32, 2> { static constexpr VkFormat value = VK_FORMAT_R32G32_SFLOAT; };
+	template<> struct Format<Float32, 3> { static constexpr VkFormat value = VK_FORMAT_R32G32B32_SFLOAT; };
+	template<> struct Format<Float32, 4> { static constexpr VkFormat value = VK_FORMAT_R32G32B32A32_SFLOAT; };
+	template<> struct Format<Float16, 2> { static constexpr VkFormat value = VK_FORMAT_R16G16_SFLOAT; };
+	template<> struct Format<Float16, 4> { static constexpr VkFormat value = VK_FORMAT_R16G16B16A16_SFLOAT; };
+	template<> struct Format<Snorm16, 2> { static constexpr VkFormat value = VK_FORMAT_R16G16_SNORM; };
+	template<> struct Format<Snorm16, 4> { static constexpr VkFormat value = VK_FORMAT_R16G16B16A16_SNORM; };
+	template<> struct Format<Unorm16, 4> { static constexpr VkFormat value = VK_FORMAT_R16G16B16A16_UNORM; };
+	template<> struct Format<Snorm8, 4> { static constexpr VkFormat value = VK_FORMAT_R8G8B8A8_SNORM; };
+	template<> struct Format<Unorm8, 2> { static constexpr VkFormat value = VK_FORMAT_R8G8_UNORM; };
+	template<> struct Format<Unorm8, 4> { static constexpr VkFormat value = VK_FORMAT_R8G8B8A8_UNORM; };
+	template<> struct Format<Uint32, 1> { static constexpr VkFormat value = VK_FORMAT_R32_UINT; };
+	template<> struct Format<Sint32, 1> { static constexpr VkFormat value = VK_FORMAT_R32_SINT; };
+	template<> struct Format<Uint8, 4> { static constexpr VkFormat value = VK_FORMAT_R8G8B8A8_UINT; };
+}
+
+template<uint32_t Location, typename Type, uint32_t Count>
+struct VertexAttribute {
+	static constexpr uint32_t location = Location;
+	static constexpr VkFormat format = vtx::Format<Type, Count>::value;
+	static constexpr uint32_t size = Type::size * Count;
+	static constexpr uint32_t alignment = Type::size;
+	static constexpr bool integer = Type::integer;
+};
+
+namespace vtx {
+	constexpr uint32_t AlignUp(uint32_t value, uint32_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	template<size_t N>
+	constexpr std::array<uint32_t, N> PackOffsets(const std::array<uint32_t, N>& sizes, const std::array<uint32_t, N>& alignments)
+	{
+		std::array<uint32_t, N> offsets = {};
+		uint32_t offset = 0;
+		for (size_t i = 0; i < N; i++) {
+			offset = AlignUp(offset, alignments[i]);
+			offsets[i] = offset;
+			offset += sizes[i];
+		}
+		return offsets;
+	}
+
+	//Padded to the widest component, as the struct would be
+	template<size_t N>
+	constexpr uint32_t PackStride(const std::array<uint32_t, N>& sizes, const std::array<uint32_t, N>& alignments)
+	{
+		const std::array<uint32_t, N> offsets = PackOffsets(sizes, alignments);
+
+		uint32_t alignment = 1;
+		for (size_t i = 0; i < N; i++) {
+			alignment = alignments[i] > alignment ? alignments[i] : alignment;
+		}
+		return AlignUp(offsets[N - 1] + sizes[N - 1], alignment);
+	}
+
+	template<size_t N>
+	constexpr bool UniqueLocations(const std::array<uint32_t, N>& locations)
+	{
+		for (size_t i = 0; i < N; i++) {
+			for (size_t j = i + 1; j < N; j++) {
+				if (locations[i] == locations[j]) return false;
+			}
+		}
+		return true;
+	}
+}
+
+template<typename... Attributes>
+struct VertexLayout {
+	static constexpr size_t kCount = sizeof...(Attributes);
+	static_assert(kCount > 0, "a vertex layout needs at least one attribute");
+
+	static constexpr std::array<uint32_t, kCount> kLocations = { Attributes::location... };
+	static constexpr std::array<VkFormat, kCount> kFormats = { Attributes::format... };
+	static constexpr std::array<bool, kCount> kInteger = { Attributes::integer... };
+	static constexpr std::array<uint32_t, kCount> kSizes = { Attributes::size... };
+	static constexpr std::array<uint32_t, kCount> kAlignments = { Attributes::alignment... };
+
+	static constexpr std::array<uint32_t, kCount> kOffsets = vtx::PackOffsets(kSizes, kAlignments);
+	static constexpr uint32_t kStride = vtx::PackStride(kSizes, kAlignments);
+
+	static_assert(vtx::UniqueLocations(kLocations), "vertex layout uses a location twice");
+
+	static constexpr VkVertexInputBindingDescription getBinding(uint32_t binding = 0)
+	{
+		return { binding, kStride, VK_VERTEX_INPUT_RATE_VERTEX };
+	}
+
+	static constexpr std::array<VkVertexInputAttributeDescription, kCount> getAttributes(uint32_t binding = 0)
+	{
+		std::array<VkVertexInputAttributeDescription, kCount> attributes = {};
+		for (size_t i = 0; i < kCount; i++) {
+			attributes[i] = { kLocations[i], binding, kFormats[i], kOffsets[i] };
+		}
+		return attributes;
+	}
+};
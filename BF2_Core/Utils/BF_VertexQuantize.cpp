@@ -0,0 +1,114 @@
+#include "BF_VertexQuantize.h"
+
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+
+//Smallest half extent kept, stops flat meshes dividing by zero
+static constexpr float kMinQuantizeExtent = 1e-6f;
+
+QuantizationBounds QuantizationBounds::FromPositions(const glm::vec3* positions, size_t count)
+{
+	QuantizationBounds bounds;
+	if (count == 0) return bounds;
+
+	glm::vec3 lo = positions[0];
+	glm::vec3 hi = positions[0];
+	for (size_t i = 1; i < count; i++) {
+		lo = glm::min(lo, positions[i]);
+		hi = glm::max(hi, positions[i]);
+	}
+
+	bounds.centre = (lo + hi) * 0.5f;
+	bounds.extent = glm::max((hi - lo) * 0.5f, glm::vec3(kMinQuantizeExtent));
+
+	return bounds;
+}
+
+glm::mat4 QuantizationBounds::getDequantizeMatrix() const
+{
+	//scale then translate, written out rather than composed
+	glm::mat4 m(1.0f);
+	m[0][0] = extent.x;
+	m[1][1] = extent.y;
+	m[2][2] = extent.z;
+	m[3] = glm::vec4(centre, 1.0f);
+
+	return m;
+}
+
+glm::vec2 vertex::OctEncode(const glm::vec3& normal)
+{
+	//Project onto the octahedron, fold the lower half over the upper
+	const float l1 = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+	if (l1 <= 0.0f) return glm::vec2(0.0f, 0.0f);
+
+	float x = normal.x / l1;
+	float y = normal.y / l1;
+
+	if (normal.z < 0.0f) {
+		const float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		const float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = fx;
+		y = fy;
+	}
+
+	return glm::vec2(x, y);
+}
+
+glm::vec3 vertex::OctDecode(const glm::vec2& oct)
+{
+	glm::vec3 n(oct.x, oct.y, 1.0f - std::fabs(oct.x) - std::fabs(oct.y));
+
+	//Unfold the lower half
+	const float t = std::max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+
+	return glm::normalize(n);
+}
+
+void vertex::Compact(const Vertex_Pos3Col3Uv2* in, size_t count, Vertex_Pos4hCol4Uv2h* out)
+{
+	for (size_t i = 0; i < count; i++) {
+		const Vertex_Pos3Col3Uv2& v = in[i];
+		Vertex_Pos4hCol4Uv2h& c = out[i];
+
+		c.pos[0] = glm::packHalf1x16(v.pos.x);
+		c.pos[1] = glm::packHalf1x16(v.pos.y);
+		c.pos[2] = glm::packHalf1x16(v.pos.z);
+		c.pos[3] = 0;
+
+		c.colour[0] = glm::packUnorm1x8(v.colour.x);
+		c.colour[1] = glm::packUnorm1x8(v.colour.y);
+		c.colour[2] = glm::packUnorm1x8(v.colour.z);
+		c.colour[3] = 255;
+
+		c.texCoord[0] = glm::packHalf1x16(v.texCoord.x);
+		c.texCoord[1] = glm::packHalf1x16(v.texCoord.y);
+	}
+}
+
+QuantizationBounds vertex::Compact(const glm::vec3* positions, const glm::vec3* normals, const glm::vec2* texCoords, size_t count, Vertex_Pos4sNrm2sUv2h* out)
+{
+	const QuantizationBounds bounds = QuantizationBounds::FromPositions(positions, count);
+
+	for (size_t i = 0; i < count; i++) {
+		Vertex_Pos4sNrm2sUv2h& c = out[i];
+
+		const glm::vec3 p = (positions[i] - bounds.centre) / bounds.extent;
+		c.pos[0] = static_cast<int16_t>(glm::packSnorm1x16(p.x));
+		c.pos[1] = static_cast<int16_t>(glm::packSnorm1x16(p.y));
+		c.pos[2] = static_cast<int16_t>(glm::packSnorm1x16(p.z));
+		c.pos[3] = 0;
+
+		const glm::vec2 n = OctEncode(normals[i]);
+		c.normal[0] = static_cast<int16_t>(glm::packSnorm1x16(n.x));
+		c.normal[1] = static_cast<int16_t>(glm::packSnorm1x16(n.y));
+
+		c.texCoord[0] = glm::packHalf1x16(texCoords[i].x);
+		c.texCoord[1] = glm::packHalf1x16(texCoords[i].y);
+	}
+
+	return bounds;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#define GLM_FORCE_CTOR_INIT
+#include <glm/glm.hpp>
+#include <cstddef>
+#include "BF_Vertex_Pos3Col3Uv2.h"
+#include "BF_Vertex_Pos4hCol4Uv2h.h"
+#include "BF_Vertex_Pos4sNrm2sUv2h.h"
+
+//Box a mesh's snorm positions are relative to
+struct QuantizationBounds {
+	glm::vec3 centre = glm::vec3(0.0f);
+	glm::vec3 extent = glm::vec3(1.0f);		//half size, never zero
+
+	static QuantizationBounds FromPositions(const glm::vec3* positions, size_t count);
+
+	//Maps [-1, 1] snorm positions back to mesh space - draw with model * this
+	glm::mat4 getDequantizeMatrix() const;
+};
+
+namespace vertex {
+	//Unit vector to octahedral coordinates in [-1, 1] and back
+	glm::vec2 OctEncode(const glm::vec3& normal);
+	glm::vec3 OctDecode(const glm::vec2& oct);
+
+	void Compact(const Vertex_Pos3Col3Uv2* in, size_t count, Vertex_Pos4hCol4Uv2h* out);
+
+	//Positions quantized to their bounds, which are returned for the model matrix
+	QuantizationBounds Compact(const glm::vec3* positions, const glm::vec3* normals, const glm::vec2* texCoords, size_t count, Vertex_Pos4sNrm2sUv2h* out);
+}
@@ -1,39 +1,21 @@
 #pragma once
 #define GLM_FORCE_CTOR_INIT
 #include <glm/glm.hpp>
-#include <vulkan/vulkan.h>
-#include <array>
+#include "BF_VertexLayout.h"
 
+//Full precision vertex, all float - see VertexFormat for the compact ones
 struct Vertex_Pos3Col3Uv2 {
 	glm::vec3 pos;
 	glm::vec3 colour;
 	glm::vec2 texCoord;
 
-	static VkVertexInputBindingDescription getBindingDescription() {
-		VkVertexInputBindingDescription bindingDescription = {};
-		bindingDescription.binding = 0;
-		bindingDescription.stride = sizeof(Vertex_Pos3Col3Uv2);
-		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-		return bindingDescription;
-	}
-	static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
-		std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions = {};
-		//Position
-		attributeDescriptions[0].binding = 0;
-		attributeDescriptions[0].location = 0;
-		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[0].offset = offsetof(Vertex_Pos3Col3Uv2, pos);
-		//Colour
-		attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset = offsetof(Vertex_Pos3Col3Uv2, colour);
+	using Layout = VertexLayout<
+		VertexAttribute<0, vtx::Float32, 3>,
+		VertexAttribute<1, vtx::Float32, 3>,
+		VertexAttribute<2, vtx::Float32, 2>>;
+};
 
-		attributeDescriptions[2].binding = 0;
-		attributeDescriptions[2].location = 2;
-		attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-		attributeDescriptions[2].offset = offsetof(Vertex_Pos3Col3Uv2, texCoord);
-
-		return attributeDescriptions;
-	}
-};
\ No newline at end of file
+static_assert(sizeof(Vertex_Pos3Col3Uv2) == Vertex_Pos3Col3Uv2::Layout::kStride, "Vertex_Pos3Col3Uv2 doesn't match its layout");
+static_assert(offsetof(Vertex_Pos3Col3Uv2, pos) == Vertex_Pos3Col3Uv2::Layout::kOffsets[0], "Vertex_Pos3Col3Uv2::pos misplaced");
+static_assert(offsetof(Vertex_Pos3Col3Uv2, colour) == Vertex_Pos3Col3Uv2::Layout::kOffsets[1], "Vertex_Pos3Col3Uv2::colour misplaced");
+static_assert(offsetof(Vertex_Pos3Col3Uv2, texCoord) == Vertex_Pos3Col3Uv2::Layout::kOffsets[2], "Vertex_Pos3Col3Uv2::texCoord misplaced");
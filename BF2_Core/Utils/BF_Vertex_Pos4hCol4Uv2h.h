@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "BF_VertexLayout.h"
+
+//16 byte counterpart of Vertex_Pos3Col3Uv2 - half float position (w unused,
+//3 component 16 bit formats are rarely supported for vertex fetch), RGBA8 unorm
+//colour, half float uv. Half positions hold ~3 significant digits, so keep
+//meshes near their origin; Vertex_Pos4sNrm2sUv2h is more precise for large ones.
+struct Vertex_Pos4hCol4Uv2h {
+	uint16_t pos[4];
+	uint8_t colour[4];
+	uint16_t texCoord[2];
+
+	using Layout = VertexLayout<
+		VertexAttribute<0, vtx::Float16, 4>,
+		VertexAttribute<1, vtx::Unorm8, 4>,
+		VertexAttribute<2, vtx::Float16, 2>>;
+};
+
+static_assert(sizeof(Vertex_Pos4hCol4Uv2h) == 16, "Vertex_Pos4hCol4Uv2h must stay tightly packed");
+static_assert(sizeof(Vertex_Pos4hCol4Uv2h) == Vertex_Pos4hCol4Uv2h::Layout::kStride, "Vertex_Pos4hCol4Uv2h doesn't match its layout");
+static_assert(offsetof(Vertex_Pos4hCol4Uv2h, pos) == Vertex_Pos4hCol4Uv2h::Layout::kOffsets[0], "Vertex_Pos4hCol4Uv2h::pos misplaced");
+static_assert(offsetof(Vertex_Pos4hCol4Uv2h, colour) == Vertex_Pos4hCol4Uv2h::Layout::kOffsets[1], "Vertex_Pos4hCol4Uv2h::colour misplaced");
+static_assert(offsetof(Vertex_Pos4hCol4Uv2h, texCoord) == Vertex_Pos4hCol4Uv2h::Layout::kOffsets[2], "Vertex_Pos4hCol4Uv2h::texCoord misplaced");
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "BF_VertexLayout.h"
+
+//16 byte lit vertex - snorm16 position relative to the mesh bounds (w unused),
+//octahedral snorm16 normal, half float uv. Positions are dequantized by the
+//matrix from QuantizationBounds, folded into the model matrix, so the vertex
+//shader does no extra work. No vertex colour.
+struct Vertex_Pos4sNrm2sUv2h {
+	int16_t pos[4];
+	int16_t normal[2];
+	uint16_t texCoord[2];
+
+	using Layout = VertexLayout<
+		VertexAttribute<0, vtx::Snorm16, 4>,
+		VertexAttribute<3, vtx::Snorm16, 2>,
+		VertexAttribute<2, vtx::Float16, 2>>;
+};
+
+static_assert(sizeof(Vertex_Pos4sNrm2sUv2h) == 16, "Vertex_Pos4sNrm2sUv2h must stay tightly packed");
+static_assert(sizeof(Vertex_Pos4sNrm2sUv2h) == Vertex_Pos4sNrm2sUv2h::Layout::kStride, "Vertex_Pos4sNrm2sUv2h doesn't match its layout");
+static_assert(offsetof(Vertex_Pos4sNrm2sUv2h, pos) == Vertex_Pos4sNrm2sUv2h::Layout::kOffsets[0], "Vertex_Pos4sNrm2sUv2h::pos misplaced");
+static_assert(offsetof(Vertex_Pos4sNrm2sUv2h, normal) == Vertex_Pos4sNrm2sUv2h::Layout::kOffsets[1], "Vertex_Pos4sNrm2sUv2h::normal misplaced");
+static_assert(offsetof(Vertex_Pos4sNrm2sUv2h, texCoord) == Vertex_Pos4sNrm2sUv2h::Layout::kOffsets[2], "Vertex_Pos4sNrm2sUv2h::texCoord misplaced");
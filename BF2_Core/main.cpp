@@ -1,7 +1,29 @@
 #include "CORE/BF_Core.h"
+#include "Graphics & Window/BF_TextureConvert.h"
+#include "Utils/BF_Pak.h"
 
-int main()
+#include <cstring>
+
+int main(int argc, char** argv)
 {
+	//Build-time tools share the engine binary
+	//  --pack <sourceDir> <out.pak> [extension]
+	//  --texconv <in.png|in.tga> <out.dds> [auto|rgba8|bc1|bc3|bc4|bc5] [linear]
+	if (argc >= 4 && std::strcmp(argv[1], "--pack") == 0)
+	{
+		return pak::Build(argv[2], argv[3], argc >= 5 ? argv[4] : "") ? 0 : 1;
+	}
+	if (argc >= 4 && std::strcmp(argv[1], "--texconv") == 0)
+	{
+		TextureEncoding encoding = TextureEncoding::Auto;
+		if (argc >= 5 && !tex::EncodingFromName(argv[4], encoding))
+		{
+			return 1;
+		}
+		const bool srgb = !(argc >= 6 && std::strcmp(argv[5], "linear") == 0);
+		return tex::Convert(argv[2], argv[3], encoding, srgb) ? 0 : 1;
+	}
+
 	Core engine;
 
 	engine.init();
@@ -1,3 +1,10 @@
-C:/VulkanSDK/1.1.97.0/Bin32/glslangValidator.exe -V shader.vert
-C:/VulkanSDK/1.1.97.0/Bin32/glslangValidator.exe -V shader.frag
+cd /d "%~dp0"
+set GLSLANG=%VULKAN_SDK%/Bin/glslangValidator.exe
+"%GLSLANG%" -V shader.vert -o vert.spv
+"%GLSLANG%" -V -DNO_VERTEX_COLOUR shader.vert -o vert_NO_VERTEX_COLOUR.spv
+"%GLSLANG%" -V shader.frag -o frag.spv
+"%GLSLANG%" -V -DALPHA_TEST shader.frag -o frag_ALPHA_TEST.spv
+"%GLSLANG%" -V meshlet_cull.comp -o meshlet_cull.spv
+"%GLSLANG%" -V depth_reduce.comp -o depth_reduce.spv
+"%GLSLANG%" -V occlusion_cull.comp -o occlusion_cull.spv
 pause
\ No newline at end of file
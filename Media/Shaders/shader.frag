@@ -1,6 +1,12 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+//Feature toggles, set per pipeline (ShaderFeature in BF_ShaderPermutation.h) -
+//the driver folds them at pipeline creation, no branches are left at runtime
+layout(constant_id = 0) const bool kTextured = true;
+layout(constant_id = 1) const bool kVertexColour = true;
+layout(constant_id = 3) const float kAlphaCutoff = 0.5;
+
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
 
@@ -9,5 +15,22 @@ layout(location = 0) out vec4 outColor;
 layout(binding = 1) uniform sampler2D texSampler;
 
 void main() {
-    outColor = vec4(fragColor * texture(texSampler, fragTexCoord).rgb, 1.0f);
+    vec4 colour = vec4(1.0);
+
+    if (kTextured) {
+        colour = texture(texSampler, fragTexCoord);
+    }
+    if (kVertexColour) {
+        colour.rgb *= fragColor;
+    }
+
+//Alpha test is a define permutation (frag_ALPHA_TEST.spv) - discard anywhere in
+//a module can cost early depth on some drivers even when it is never reached
+#ifdef ALPHA_TEST
+    if (colour.a < kAlphaCutoff) {
+        discard;
+    }
+#endif
+
+    outColor = vec4(colour.rgb, 1.0f);
 }
\ No newline at end of file
@@ -7,8 +7,12 @@ layout(binding = 0) uniform UniformBufferObject {
     mat4 proj;
 } ubo;
 
+//Locations are fixed per attribute (VertexFormat) - compact formats are
+//converted to float by vertex fetch, the shader doesn't change
 layout(location = 0) in vec3 inPosition;
+#ifndef NO_VERTEX_COLOUR
 layout(location = 1) in vec3 inColor;
+#endif
 layout(location = 2) in vec2 inTexCoord;
 
 layout(location = 0) out vec3 fragColor;
@@ -16,6 +20,10 @@ layout(location = 1) out vec2 fragTexCoord;
 
 void main() {
     gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+#ifndef NO_VERTEX_COLOUR
     fragColor = inColor;
+#else
+    fragColor = vec3(1.0);
+#endif
 	fragTexCoord = inTexCoord;
 }
\ No newline at end of file
@@ -0,0 +1,2 @@
+..\BF2_Core\x64\Release\BF2_Core.exe --pack Shaders Shaders.pak .spv
+pause
\ No newline at end of file